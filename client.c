@@ -0,0 +1,300 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+
+/* Feature test macros */
+#define _POSIX_C_SOURCE 200809L
+
+/* C library */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX */
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum size of request source in bytes.
+ */
+#ifndef MAX_REQUEST_SIZE
+#define MAX_REQUEST_SIZE 1048576
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads exactly given number of bytes.
+ *
+ * @param fd   File descriptor.
+ * @param buf  Destination buffer.
+ * @param size Number of bytes.
+ *
+ * @return 0 on success, -1 on error or end of file.
+ */
+static int read_full(int fd, void *buf, size_t size)
+{
+    char *ptr = buf;
+
+    while (size > 0)
+    {
+        ssize_t res = read(fd, ptr, size);
+
+        if (res <= 0)
+            return -1;
+
+        ptr += res;
+        size -= res;
+    }
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Writes exactly given number of bytes.
+ *
+ * @param fd   File descriptor.
+ * @param buf  Source buffer.
+ * @param size Number of bytes.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int write_full(int fd, const void *buf, size_t size)
+{
+    const char *ptr = buf;
+
+    while (size > 0)
+    {
+        ssize_t res = write(fd, ptr, size);
+
+        if (res <= 0)
+            return -1;
+
+        ptr += res;
+        size -= res;
+    }
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores 32 bit number in big-endian order.
+ *
+ * @param buf   Destination buffer.
+ * @param value Number.
+ */
+static void put_uint32(unsigned char *buf, unsigned long value)
+{
+    buf[0] = (value >> 24) & 0xFF;
+    buf[1] = (value >> 16) & 0xFF;
+    buf[2] = (value >> 8) & 0xFF;
+    buf[3] = value & 0xFF;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Loads 32 bit number stored in big-endian order.
+ *
+ * @param buf Source buffer.
+ *
+ * @return Number.
+ */
+static unsigned long get_uint32(const unsigned char *buf)
+{
+    return ((unsigned long) buf[0] << 24) | ((unsigned long) buf[1] << 16) |
+        ((unsigned long) buf[2] << 8) | buf[3];
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads whole file into memory.
+ *
+ * @param file Source file.
+ * @param size Number of read bytes.
+ *
+ * @return Allocated buffer or NULL.
+ */
+static char *read_source(FILE *file, size_t *size)
+{
+    char *source = malloc(MAX_REQUEST_SIZE);
+
+    if (source == NULL)
+        return NULL;
+
+    *size = fread(source, 1, MAX_REQUEST_SIZE, file);
+
+    if (ferror(file) || !feof(file))
+    {
+        fprintf(stderr, "Unable to read request\n");
+        free(source);
+        return NULL;
+    }
+
+    return source;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Sends request and prints response.
+ *
+ * @param sock   Connected socket.
+ * @param source Request source.
+ * @param size   Source length.
+ *
+ * @return Number of errors or -1 on communication error.
+ */
+static long send_request(int sock, const char *source, size_t size)
+{
+    unsigned char header[8];
+    unsigned long length;
+    unsigned long errors;
+    char *result;
+
+    put_uint32(header, size);
+
+    if (write_full(sock, header, 4) || write_full(sock, source, size))
+        return -1;
+
+    if (read_full(sock, header, 8))
+        return -1;
+
+    length = get_uint32(header);
+    errors = get_uint32(header + 4);
+
+    result = malloc(length + 1);
+
+    if (result == NULL || read_full(sock, result, length))
+    {
+        free(result);
+        return -1;
+    }
+
+    fwrite(result, 1, length, stdout);
+    free(result);
+
+    return errors;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Client for evaluation server.
+ *
+ * Usage: lisp-client socket [file...]
+ *
+ * Every file (or standard input) is sent as one request over the same
+ * connection and the response is printed to stdout.
+ *
+ * @param argc Argument count.
+ * @param argv Argument values.
+ */
+int main(int argc, char **argv)
+{
+    struct sockaddr_un addr;
+    int sock;
+    int i;
+    int result = EXIT_SUCCESS;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s socket [file...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (strlen(argv[1]) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Socket path is too long\n");
+        return EXIT_FAILURE;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, argv[1]);
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (sock < 0 || connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+    {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 2; i < argc || i == 2; ++i)
+    {
+        FILE *file = (i < argc) ? fopen(argv[i], "r") : stdin;
+        char *source;
+        size_t size;
+        long errors;
+
+        if (file == NULL)
+        {
+            perror(argv[i]);
+            result = EXIT_FAILURE;
+            break;
+        }
+
+        source = read_source(file, &size);
+
+        if (file != stdin)
+            fclose(file);
+
+        if (source == NULL)
+        {
+            result = EXIT_FAILURE;
+            break;
+        }
+
+        errors = send_request(sock, source, size);
+        free(source);
+
+        if (errors < 0)
+        {
+            fprintf(stderr, "Connection closed\n");
+            result = EXIT_FAILURE;
+            break;
+        }
+
+        if (errors > 0)
+            result = EXIT_FAILURE;
+    }
+
+    close(sock);
+
+    return result;
+}
+
+/* ************************************************************************ */
@@ -0,0 +1,801 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+/* Feature test macros */
+#define _DEFAULT_SOURCE
+
+/* Declaration */
+#include "csv.h"
+
+/* C library */
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX */
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* LISP */
+#include "interpret.h"
+#include "vector.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum length of floating point number in cell.
+ */
+#define CSV_MAX_NUMBER_LENGTH 64
+
+/* ************************************************************************ */
+
+/**
+ * @brief Type of parsed cell.
+ */
+enum CellType
+{
+    CELL_INTEGER,
+    CELL_FLOAT,
+    CELL_EMPTY,
+    CELL_INVALID
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Content of CSV file in memory.
+ */
+struct CsvFile
+{
+    /** File text, NULL for empty file. */
+    char *text;
+
+    /** Text size. */
+    size_t size;
+
+    /** If text is mapped file, otherwise it's allocated. */
+    int mapped;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Part of CSV file parsed by one thread.
+ *
+ * Rows are counted first, so each part is parsed directly into its place
+ * in column vectors.
+ */
+struct CsvChunk
+{
+    /** The first character, it starts a line. */
+    const char *begin;
+
+    /** End of text, it's after new line. */
+    const char *end;
+
+    /** Number of lines which are not empty. */
+    unsigned long rows;
+
+    /** Number of lines. */
+    unsigned long lines;
+
+    /** Index of the first row in column vectors. */
+    unsigned long first;
+
+    /** Number of the first line in file. */
+    unsigned long line;
+
+    /** Number of columns. */
+    unsigned int columns;
+
+    /** Items of column vectors. */
+    union VectorItem **items;
+
+    /** If columns of this part are stored as floating point numbers. */
+    unsigned char *floats;
+
+    /** Error message with line number, NULL on success. */
+    const char *error;
+
+    /** Line with error. */
+    unsigned long error_line;
+
+    /** Worker thread. */
+    pthread_t thread;
+
+    /** If the worker thread is running or not joined. */
+    int running;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Type of function which processes chunk.
+ */
+typedef void *(*chunk_func_t)(void *chunk);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns end of line.
+ *
+ * @param line Line start.
+ * @param end  End of text.
+ *
+ * @return New line character or end of text.
+ */
+static const char *line_end(const char *line, const char *end)
+{
+    const char *res = memchr(line, '\n', (size_t) (end - line));
+
+    return res ? res : end;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns start of the next line.
+ *
+ * @param line Line start.
+ * @param end  End of text.
+ *
+ * @return The next line or end of text.
+ */
+static const char *next_line(const char *line, const char *end)
+{
+    line = line_end(line, end);
+
+    return (line < end) ? line + 1 : line;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks if line has only white space.
+ *
+ * @param line Line start.
+ * @param end  Line end.
+ *
+ * @return If line is empty.
+ */
+static int is_blank(const char *line, const char *end)
+{
+    for (; line < end; ++line)
+    {
+        if (*line != ' ' && *line != '\t' && *line != '\r')
+            return 0;
+    }
+
+    return 1;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Parses number in cell.
+ *
+ * Integers are parsed without copying, other numbers by `strtod`.
+ *
+ * @param text Cell text.
+ * @param end  End of cell.
+ * @param item Parsed number.
+ *
+ * @return Number type, CELL_EMPTY or CELL_INVALID.
+ */
+static enum CellType parse_cell(const char *text, const char *end,
+    union VectorItem *item)
+{
+    char number[CSV_MAX_NUMBER_LENGTH];
+    unsigned long limit = LONG_MAX;
+    unsigned long value = 0;
+    const char *digits;
+    const char *c;
+    char *last;
+    int negative = 0;
+
+    /* Surrounding white space and quotes */
+    while (text < end && (*text == ' ' || *text == '\t'))
+        ++text;
+
+    while (end > text && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+        --end;
+
+    if (end - text >= 2 && *text == '"' && end[-1] == '"')
+    {
+        ++text;
+        --end;
+    }
+
+    if (text == end)
+        return CELL_EMPTY;
+
+    digits = text;
+
+    if (*digits == '-' || *digits == '+')
+    {
+        negative = (*digits++ == '-');
+
+        if (negative)
+            limit = (unsigned long) LONG_MAX + 1;
+    }
+
+    for (c = digits; c < end && *c >= '0' && *c <= '9'; ++c)
+    {
+        unsigned int digit = (unsigned int) (*c - '0');
+
+        /* Too big integer is stored as floating point number */
+        if (value > (limit - digit) / 10)
+            break;
+
+        value = value * 10 + digit;
+    }
+
+    if (c == end && c != digits)
+    {
+        if (negative && value > 0)
+            item->integer = -(long) (value - 1) - 1;
+        else
+            item->integer = (long) value;
+
+        return CELL_INTEGER;
+    }
+
+    if (end - text >= CSV_MAX_NUMBER_LENGTH)
+        return CELL_INVALID;
+
+    /* Hexadecimal, infinite and NaN numbers are not supported by reader */
+    for (c = text; c < end; ++c)
+    {
+        if ((*c < '0' || *c > '9') && *c != '+' && *c != '-' && *c != '.' &&
+            *c != 'e' && *c != 'E')
+            return CELL_INVALID;
+    }
+
+    memcpy(number, text, (size_t) (end - text));
+    number[end - text] = '\0';
+    item->real = strtod(number, &last);
+
+    if (last != number + (end - text))
+        return CELL_INVALID;
+
+    return CELL_FLOAT;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores cell into column vector.
+ *
+ * The first floating point number in column converts previous integers
+ * of the chunk.
+ *
+ * @param chunk  Chunk.
+ * @param column Column index.
+ * @param row    Row index.
+ * @param item   Parsed number.
+ * @param type   Number type.
+ */
+static void store_cell(struct CsvChunk *chunk, unsigned int column,
+    unsigned long row, const union VectorItem *item, enum CellType type)
+{
+    union VectorItem *items = chunk->items[column];
+
+    if (type == CELL_FLOAT && !chunk->floats[column])
+    {
+        unsigned long i;
+
+        for (i = chunk->first; i < row; ++i)
+            items[i].real = (double) items[i].integer;
+
+        chunk->floats[column] = 1;
+    }
+
+    if (!chunk->floats[column])
+        items[row].integer = item->integer;
+    else if (type == CELL_FLOAT)
+        items[row].real = item->real;
+    else
+        items[row].real = (double) item->integer;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Counts lines of chunk, it's the body of worker thread.
+ *
+ * @param arg Chunk.
+ *
+ * @return NULL.
+ */
+static void *count_rows(void *arg)
+{
+    struct CsvChunk *chunk = (struct CsvChunk *) arg;
+    const char *line;
+
+    chunk->rows = 0;
+    chunk->lines = 0;
+
+    for (line = chunk->begin; line < chunk->end;
+        line = next_line(line, chunk->end))
+    {
+        ++chunk->lines;
+
+        if (!is_blank(line, line_end(line, chunk->end)))
+            ++chunk->rows;
+    }
+
+    return NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Parses rows of chunk into column vectors, it's the body of worker
+ * thread.
+ *
+ * @param arg Chunk.
+ *
+ * @return NULL.
+ */
+static void *parse_rows(void *arg)
+{
+    struct CsvChunk *chunk = (struct CsvChunk *) arg;
+    unsigned long row = chunk->first;
+    unsigned long number = chunk->line;
+    const char *line;
+
+    for (line = chunk->begin; line < chunk->end; ++number)
+    {
+        const char *end = line_end(line, chunk->end);
+        const char *cell = line;
+        unsigned int column = 0;
+
+        line = next_line(line, chunk->end);
+
+        if (is_blank(cell, end))
+            continue;
+
+        while (1)
+        {
+            const char *next = memchr(cell, ',', (size_t) (end - cell));
+            union VectorItem item;
+            enum CellType type;
+
+            if (next == NULL)
+                next = end;
+
+            if (column == chunk->columns)
+            {
+                chunk->error = "Inconsistent number of columns in CSV file "
+                    "at line %lu";
+                chunk->error_line = number;
+                return NULL;
+            }
+
+            type = parse_cell(cell, next, &item);
+
+            if (type == CELL_EMPTY || type == CELL_INVALID)
+            {
+                chunk->error = (type == CELL_EMPTY) ?
+                    "Empty cell in CSV file at line %lu" :
+                    "Invalid number in CSV file at line %lu";
+                chunk->error_line = number;
+                return NULL;
+            }
+
+            store_cell(chunk, column++, row, &item, type);
+
+            if (next == end)
+                break;
+
+            cell = next + 1;
+        }
+
+        if (column != chunk->columns)
+        {
+            chunk->error = "Inconsistent number of columns in CSV file "
+                "at line %lu";
+            chunk->error_line = number;
+            return NULL;
+        }
+
+        ++row;
+    }
+
+    return NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Processes chunks by worker threads, the first one in this thread.
+ *
+ * @param chunks Chunks.
+ * @param count  Number of chunks.
+ * @param func   Function which processes chunk.
+ */
+static void run_chunks(struct CsvChunk *chunks, unsigned int count,
+    chunk_func_t func)
+{
+    unsigned int i;
+
+    for (i = 1; i < count; ++i)
+    {
+        /* Without thread the chunk is processed immediately */
+        chunks[i].running = (pthread_create(&chunks[i].thread, NULL, func,
+            &chunks[i]) == 0);
+
+        if (!chunks[i].running)
+            func(&chunks[i]);
+    }
+
+    func(&chunks[0]);
+
+    for (i = 1; i < count; ++i)
+    {
+        if (chunks[i].running)
+            pthread_join(chunks[i].thread, NULL);
+
+        chunks[i].running = 0;
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns number of chunks for text.
+ *
+ * @param size Text size.
+ *
+ * @return Number of chunks.
+ */
+static unsigned int chunk_count(size_t size)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (count > CSV_MAX_THREADS)
+        count = CSV_MAX_THREADS;
+
+    if ((size_t) count > size / CSV_MIN_CHUNK_SIZE)
+        count = (long) (size / CSV_MIN_CHUNK_SIZE);
+
+    return count > 1 ? (unsigned int) count : 1;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Loads file into memory, regular file is mapped.
+ *
+ * @param name File name.
+ * @param file Loaded file.
+ *
+ * @return 0 on success.
+ */
+static int load_file(const char *name, struct CsvFile *file)
+{
+    struct stat info;
+    size_t capacity = 0;
+    int fd;
+
+    file->text = NULL;
+    file->size = 0;
+    file->mapped = 0;
+
+    if ((fd = open(name, O_RDONLY)) < 0)
+        return -1;
+
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode))
+    {
+        void *map = MAP_FAILED;
+
+        if (info.st_size > 0)
+            map = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE,
+                fd, 0);
+
+        if (info.st_size == 0 || map != MAP_FAILED)
+        {
+            file->text = (info.st_size > 0) ? (char *) map : NULL;
+            file->size = (size_t) info.st_size;
+            file->mapped = (info.st_size > 0);
+            close(fd);
+            return 0;
+        }
+    }
+
+    /* Other files are read into memory */
+    while (1)
+    {
+        ssize_t count;
+
+        if (file->size == capacity)
+        {
+            char *tmp;
+
+            capacity = capacity ? 2 * capacity : CSV_MIN_CHUNK_SIZE;
+
+            if ((tmp = realloc(file->text, capacity)) == NULL)
+            {
+                perror("Unable to allocate memory for CSV file");
+                exit(EXIT_FAILURE);
+            }
+
+            file->text = tmp;
+        }
+
+        count = read(fd, file->text + file->size, capacity - file->size);
+
+        if (count <= 0)
+        {
+            close(fd);
+            return (int) count;
+        }
+
+        file->size += (size_t) count;
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Releases loaded file.
+ *
+ * @param file Loaded file.
+ */
+static void unload_file(struct CsvFile *file)
+{
+    if (file->mapped)
+        munmap(file->text, file->size);
+    else
+        free(file->text);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns number of cells in line.
+ *
+ * @param line Line start.
+ * @param end  Line end.
+ *
+ * @return Number of cells.
+ */
+static unsigned int count_cells(const char *line, const char *end)
+{
+    unsigned int count = 1;
+
+    for (; line < end; ++line)
+    {
+        if (*line == ',')
+            ++count;
+    }
+
+    return count;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Parses text of CSV file into column vectors.
+ *
+ * Vectors are pushed on evaluation stack.
+ *
+ * @param text    Text after header.
+ * @param end     End of text.
+ * @param line    Number of the first line.
+ * @param columns Number of columns.
+ * @param vectors Column vectors.
+ * @param error   Error message buffer.
+ *
+ * @return 0 on success.
+ */
+static int parse_text(const char *text, const char *end, unsigned long line,
+    unsigned int columns, struct SExpression **vectors, char *error)
+{
+    struct CsvChunk chunks[CSV_MAX_THREADS];
+    union VectorItem **items;
+    unsigned int count = chunk_count((size_t) (end - text));
+    unsigned long rows = 0;
+    unsigned int i;
+    unsigned int j;
+    int res = 0;
+
+    /* Chunks start at line starts */
+    for (i = 0; i < count; ++i)
+    {
+        memset(&chunks[i], 0, sizeof(struct CsvChunk));
+        chunks[i].begin = i ? chunks[i - 1].end : text;
+        chunks[i].end = (i + 1 < count) ? text + (size_t) (end - text) /
+            count * (i + 1) : end;
+
+        if (chunks[i].end < chunks[i].begin)
+            chunks[i].end = chunks[i].begin;
+
+        if (chunks[i].end < end)
+            chunks[i].end = next_line(chunks[i].end, end);
+    }
+
+    run_chunks(chunks, count, &count_rows);
+
+    for (i = 0; i < count; ++i)
+    {
+        chunks[i].first = rows;
+        chunks[i].line = line;
+        chunks[i].columns = columns;
+        rows += chunks[i].rows;
+        line += chunks[i].lines;
+    }
+
+    items = malloc(columns * sizeof(union VectorItem *));
+
+    for (i = 0; i < count; ++i)
+    {
+        chunks[i].items = items;
+        chunks[i].floats = calloc(columns, 1);
+
+        if (items == NULL || chunks[i].floats == NULL)
+        {
+            perror("Unable to allocate memory for CSV file");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    /* Vectors are allocated before threads start */
+    for (j = 0; j < columns; ++j)
+    {
+        vectors[j] = vector_create(VECTOR_INTEGER, rows);
+        push_value(vectors[j]);
+        items[j] = vector_get(vectors[j])->items;
+    }
+
+    run_chunks(chunks, count, &parse_rows);
+
+    /* The first error in file */
+    for (i = 0; i < count && res == 0; ++i)
+    {
+        if (chunks[i].error)
+        {
+            sprintf(error, chunks[i].error, chunks[i].error_line);
+            res = -1;
+        }
+    }
+
+    /* Column is floating point if any chunk has floating point number */
+    for (j = 0; j < columns && res == 0; ++j)
+    {
+        for (i = 0; i < count && !chunks[i].floats[j]; ++i)
+            ;
+
+        if (i == count)
+            continue;
+
+        vector_get(vectors[j])->kind = VECTOR_FLOAT;
+
+        for (i = 0; i < count; ++i)
+        {
+            unsigned long k;
+
+            if (chunks[i].floats[j])
+                continue;
+
+            for (k = chunks[i].first; k < chunks[i].first + chunks[i].rows; ++k)
+                items[j][k].real = (double) items[j][k].integer;
+        }
+    }
+
+    for (i = 0; i < count; ++i)
+        free(chunks[i].floats);
+
+    free(items);
+
+    return res;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *csv_read(const char *name, int header, const char **error)
+{
+    static char message[80];
+    struct SExpression **vectors;
+    struct SExpression *res = &sexpr_nil;
+    struct CsvFile file;
+    const char *text;
+    const char *end;
+    const char *line;
+    unsigned long number = 1;
+    unsigned int columns;
+    unsigned int i;
+
+    assert(name);
+    assert(error);
+
+    if (load_file(name, &file))
+    {
+        *error = "Unable to open file";
+        return NULL;
+    }
+
+    text = file.text;
+    end = text + file.size;
+
+    /* Header or the first row gives number of columns */
+    for (line = text; !header && line < end &&
+        is_blank(line, line_end(line, end)); ++number)
+        line = next_line(line, end);
+
+    if (line == end)
+    {
+        unload_file(&file);
+        return &sexpr_nil;
+    }
+
+    columns = count_cells(line, line_end(line, end));
+
+    if (header)
+    {
+        line = next_line(line, end);
+        ++number;
+    }
+
+    if ((vectors = malloc(columns * sizeof(struct SExpression *))) == NULL)
+    {
+        perror("Unable to allocate memory for CSV file");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Vectors are reachable from the stack */
+    if (parse_text(line, end, number, columns, vectors, message))
+    {
+        *error = message;
+        res = NULL;
+    }
+
+    for (i = columns; i > 0 && res != NULL; --i)
+    {
+        struct SExpression *cell;
+
+        push_value(res);
+        cell = alloc_sexpr(TYPE_CONS);
+        pop_values(1);
+
+        cell->list = vectors[i - 1];
+        cell->right = res;
+        res = cell;
+    }
+
+    pop_values(columns);
+    free(vectors);
+    unload_file(&file);
+
+    return res;
+}
+
+/* ************************************************************************ */
@@ -0,0 +1,76 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+#ifndef CSV_H_
+#define CSV_H_
+
+/* ************************************************************************ */
+
+/* LISP */
+#include "desc.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Minimum size of part of CSV file parsed by one thread.
+ */
+#ifndef CSV_MIN_CHUNK_SIZE
+#define CSV_MIN_CHUNK_SIZE (1024 * 1024)
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum number of threads parsing CSV file.
+ */
+#ifndef CSV_MAX_THREADS
+#define CSV_MAX_THREADS 8
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads numeric columns of CSV file into vectors.
+ *
+ * Cells are separated by commas, numbers can be in double quotes and empty
+ * cells are errors. Column with any floating point number is a vector of
+ * floating point numbers, other columns are integer vectors. Empty lines
+ * are skipped. Parts of large file are parsed by threads.
+ *
+ * @param name   File name.
+ * @param header If the first line has column names.
+ * @param error  Error message when NULL is returned.
+ *
+ * @return List of column vectors, NIL for empty file, NULL on error.
+ */
+struct SExpression *csv_read(const char *name, int header, const char **error);
+
+/* ************************************************************************ */
+
+#endif /* CSV_H_ */
+
+/* ************************************************************************ */
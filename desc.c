@@ -33,6 +33,11 @@
 #include <stdio.h>
 #include <string.h>
 
+/* LISP */
+#include "gc.h"
+#include "vector.h"
+#include "text.h"
+
 /* ************************************************************************ */
 
 #ifndef NDEBUG
@@ -44,23 +49,25 @@ int sexpr_count = 0;
 
 /* ************************************************************************ */
 
-struct SExpression *alloc_sexpr(enum Type type)
-{
-    struct SExpression *expr;
+struct SExpression sexpr_nil = {NULL, NULL, "", 0, 0, TYPE_NIL, 0};
 
-    /* Try to allocate memory for S-expression */
-    expr = malloc(sizeof(struct SExpression));
+/* ************************************************************************ */
 
-    /* Unable to allocate memory */
-    if (expr == NULL)
-    {
-        perror("S-expression allocation fail");
-        exit(EXIT_FAILURE);
-    }
+struct SExpression sexpr_true = {NULL, NULL, "T", 0, 0, TYPE_VALUE, 0};
+
+/* ************************************************************************ */
+
+struct SExpression *alloc_sexpr(enum Type type)
+{
+    /* Allocate memory from heap */
+    struct SExpression *expr = gc_alloc();
 
     /* Initialize expression */
     expr->lvalue[0] = '\0';
     expr->right = NULL;
+    expr->list = NULL;
+    expr->depth = 0;
+    expr->slot = 0;
     expr->type = type;
 
 #ifndef NDEBUG
@@ -73,62 +80,296 @@ struct SExpression *alloc_sexpr(enum Type type)
 
 /* ************************************************************************ */
 
-void free_sexpr(struct SExpression *expr)
+struct SExpression *alloc_range(long start, long step, long length)
 {
-    /* Pointer must be "valid" */
-    assert(expr);
+    struct SExpression *expr;
+    struct Range range;
 
-    /* Recursive free */
-    if (expr->right)
-        free_sexpr(expr->right);
+    assert(sizeof(struct Range) <= MAX_VALUE_LENGTH);
+    assert(length > 0);
 
-    /** Free expression */
-    free(expr);
+    range.start = start;
+    range.step = step;
+    range.length = length;
 
-#ifndef NDEBUG
-    /* Decrease counter */
-    sexpr_count--;
-#endif
+    /* Range is stored in place of value text */
+    expr = alloc_sexpr(TYPE_RANGE);
+    memcpy(expr->lvalue, &range, sizeof(range));
 
+    return expr;
 }
 
 /* ************************************************************************ */
 
-void print_sexpr(struct SExpression *expr)
+void get_range(const struct SExpression *expr, struct Range *range)
 {
-    /* Must be "valid" expression */
-    assert(expr);
+    assert(expr->type == TYPE_RANGE);
+
+    memcpy(range, expr->lvalue, sizeof(*range));
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stack of cons cells which are being printed.
+ */
+static const struct SExpression **l_print_stack = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of allocated items in print stack.
+ */
+static unsigned int l_print_capacity = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Skips evaluated lazy sequences.
+ *
+ * @param expr Expression.
+ *
+ * @return Expression which is not an evaluated lazy sequence.
+ */
+static const struct SExpression *realized(const struct SExpression *expr)
+{
+    while (expr->type == TYPE_LAZY && expr->depth)
+        expr = expr->list;
+
+    return expr;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Writes range items separated by spaces.
+ *
+ * @param file Output file.
+ * @param expr Range.
+ */
+static void write_range(FILE *file, const struct SExpression *expr)
+{
+    struct Range range;
+    long value;
+    long i;
+
+    get_range(expr, &range);
+
+    for (i = 0, value = range.start; i < range.length; ++i, value += range.step)
+        fprintf(file, i ? " %ld" : "%ld", value);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Writes floating point number.
+ *
+ * The shortest text which is read back as the same value is used.
+ *
+ * @param file  Output file.
+ * @param value Floating point number.
+ */
+static void write_float(FILE *file, double value)
+{
+    char buffer[32];
+    int precision = 15;
+
+    do
+        sprintf(buffer, "%.*g", precision++, value);
+    while (precision <= 17 && strtod(buffer, NULL) != value);
+
+    /* Number without fraction is still floating point */
+    if (strpbrk(buffer, ".en") == NULL)
+        strcat(buffer, ".0");
+
+    fprintf(file, "%s", buffer);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Writes vector items.
+ *
+ * @param file Output file.
+ * @param expr Vector.
+ */
+static void write_vector(FILE *file, const struct SExpression *expr)
+{
+    struct Vector *vector = vector_get(expr);
+    unsigned long i;
 
+    for (i = 0; i < vector->length; ++i)
+    {
+        if (i)
+            fprintf(file, " ");
+
+        if (vector->kind == VECTOR_FLOAT)
+            write_float(file, vector->items[i].real);
+        else
+            fprintf(file, "%ld", vector->items[i].integer);
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Writes atom.
+ *
+ * @param file Output file.
+ * @param expr Atom.
+ */
+static void write_atom(FILE *file, const struct SExpression *expr)
+{
     if (expr->type == TYPE_NIL)
     {
         /* Print NIL type */
-        printf("NIL");
+        fprintf(file, "NIL");
     }
-    else if (expr->type == TYPE_VALUE)
+    else if (expr->type == TYPE_LAMBDA)
     {
-        /* Print value */
-        printf("%s", expr->lvalue);
+        /* Print function object */
+        fprintf(file, "#<LAMBDA>");
+    }
+    else if (expr->type == TYPE_STRING)
+    {
+        /* Print string in quotes */
+        fprintf(file, "\"%s\"", text_get(expr));
+    }
+    else if (expr->type == TYPE_LAZY)
+    {
+        /* Not evaluated lazy sequence */
+        fprintf(file, "#<LAZY-SEQ>");
+    }
+    else if (expr->type == TYPE_HASH)
+    {
+        /* Print hash table object */
+        fprintf(file, "#<HASH-TABLE>");
+    }
+    else if (expr->type == TYPE_READER)
+    {
+        /* Print line reader object */
+        fprintf(file, "#<LINE-READER>");
+    }
+    else if (expr->type == TYPE_VALUE && expr != &sexpr_true)
+    {
+        long value;
+
+        /* Print integer */
+        memcpy(&value, expr->lvalue, sizeof(value));
+        fprintf(file, "%ld", value);
+    }
+    else if (expr->type == TYPE_FLOAT)
+    {
+        double value;
+
+        memcpy(&value, expr->lvalue, sizeof(value));
+        write_float(file, value);
+    }
+    else if (expr->type == TYPE_VECTOR)
+    {
+        /* Print vector items */
+        fprintf(file, "#(");
+        write_vector(file, expr);
+        fprintf(file, ")");
+    }
+    else if (expr->type == TYPE_RANGE)
+    {
+        /* Print range as a list */
+        fprintf(file, "(");
+        write_range(file, expr);
+        fprintf(file, ")");
     }
     else
     {
-        struct SExpression *tmp = expr;
+        /* Empty value doesn't make sense */
+        assert(strlen(expr->lvalue) != 0);
 
-        printf("(");
+        /* Print value */
+        fprintf(file, "%s", expr->lvalue);
+    }
+}
+
+/* ************************************************************************ */
+
+void write_sexpr(FILE *file, const struct SExpression *expr)
+{
+    unsigned int count = 0;
+
+    /* Must be "valid" expression */
+    assert(expr);
+
+    /* Nested lists are stored on explicit stack */
+    while (1)
+    {
+        expr = realized(expr);
+
+        if (expr->type == TYPE_CONS)
+        {
+            /* Stack needs to be reallocated */
+            if (count == l_print_capacity)
+            {
+                unsigned int capacity = l_print_capacity ? 2 * l_print_capacity : 64;
+                const struct SExpression **tmp = realloc(l_print_stack,
+                    capacity * sizeof(struct SExpression *));
+
+                if (tmp == NULL)
+                {
+                    perror("Unable to allocate memory for printing\n");
+                    exit(EXIT_FAILURE);
+                }
 
-        /* Foreach */
-        for (; tmp != NULL; tmp = tmp->right)
+                l_print_stack = tmp;
+                l_print_capacity = capacity;
+            }
+
+            fprintf(file, "(");
+            l_print_stack[count++] = expr;
+            expr = expr->list;
+            continue;
+        }
+
+        write_atom(file, expr);
+
+        /* Close finished lists */
+        while (count > 0)
         {
-            if (tmp != expr)
-                printf(" ");
+            expr = realized(l_print_stack[count - 1]->right);
+
+            if (expr->type == TYPE_CONS)
+                break;
 
-            /* Empty value doesn't make sense */
-            assert(strlen(tmp->lvalue) != 0);
+            /* Range is the rest of list */
+            if (expr->type == TYPE_RANGE)
+            {
+                fprintf(file, " ");
+                write_range(file, expr);
+            }
+            /* Dotted pair */
+            else if (expr->type != TYPE_NIL)
+            {
+                fprintf(file, " . ");
+                write_atom(file, expr);
+            }
 
-            printf("%s", tmp->lvalue);
+            fprintf(file, ")");
+            --count;
         }
 
-        printf(")");
+        if (count == 0)
+            break;
+
+        /* The next list item */
+        fprintf(file, " ");
+        l_print_stack[count - 1] = expr;
+        expr = expr->list;
     }
 }
 
 /* ************************************************************************ */
+
+void print_sexpr(const struct SExpression *expr)
+{
+    write_sexpr(stdout, expr);
+}
+
+/* ************************************************************************ */
@@ -29,6 +29,11 @@
 
 /* ************************************************************************ */
 
+/* C library */
+#include <stdio.h>
+
+/* ************************************************************************ */
+
 /**
  * @brief Maximum length of stored value.
  */
@@ -45,24 +50,80 @@ enum Type
     TYPE_SEXPR,
     TYPE_VALUE,
     TYPE_NIL,
-    TYPE_QUOTED
+    TYPE_QUOTED,
+    TYPE_SYMBOL,
+    TYPE_LAMBDA,
+    TYPE_LOCAL,
+    TYPE_CONS,
+    TYPE_STRING,
+    TYPE_LAZY,
+    TYPE_RANGE,
+    TYPE_FLOAT,
+    TYPE_HASH,
+    TYPE_READER,
+    TYPE_VECTOR
 };
 
 /* ************************************************************************ */
 
 /**
  * @brief Structure for storing a single S-expression
+ *
+ * Source forms are lists of items linked by right pointer. Data lists are
+ * cons cells (TYPE_CONS) where list pointer is CAR and right pointer is CDR.
+ * Lazy sequences (TYPE_LAZY) refer to body forms and captured values before
+ * evaluation and to the result after it (depth is set). Function objects
+ * (TYPE_LAMBDA) refer to the definition and captured values. Integer ranges
+ * (TYPE_RANGE) store struct Range in lvalue and behave like lists of numbers.
+ * Integers (TYPE_VALUE) store long in lvalue, except T which is stored as
+ * text. Floating point numbers (TYPE_FLOAT) store double in lvalue, hash
+ * tables (TYPE_HASH), line readers (TYPE_READER), numeric vectors
+ * (TYPE_VECTOR) and strings (TYPE_STRING) a pointer to data outside of the
+ * heap.
  */
 struct SExpression
 {
     /** A pointer to next expression. */
     struct SExpression *right;
 
+    /** A pointer to nested list (not evaluated form or lambda definition). */
+    struct SExpression *list;
+
     /** Stored expression value. */
     char lvalue[MAX_VALUE_LENGTH];
 
+    /** Local variable frame depth (number of frames to go up). For global
+     * variable reference version of cached place, for function name item
+     * number of evaluations counted by JIT. */
+    unsigned short depth;
+
+    /** Local variable slot index within the frame. For global variable
+     * reference cached place + 1, for function name item index of compiled
+     * code used by JIT. */
+    unsigned short slot;
+
     /** Expression type. */
     enum Type type;
+
+    /** Garbage collector mark. */
+    unsigned char mark;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Integer sequence stored in a single S-expression.
+ */
+struct Range
+{
+    /** The first item. */
+    long start;
+
+    /** Difference between two items. */
+    long step;
+
+    /** Number of items (at least one). */
+    long length;
 };
 
 /* ************************************************************************ */
@@ -78,10 +139,25 @@ extern int sexpr_count;
 
 /* ************************************************************************ */
 
+/**
+ * @brief NIL constant.
+ */
+extern struct SExpression sexpr_nil;
+
+/* ************************************************************************ */
+
+/**
+ * @brief T constant.
+ */
+extern struct SExpression sexpr_true;
+
+/* ************************************************************************ */
+
 /**
  * @brief Create a new S-expression of given type.
  *
- * Allocated object must be freed by calling `free_sexpr` function.
+ * Allocated object is freed by garbage collector when it isn't reachable
+ * from roots.
  *
  * Function never returns NULL pointer. If memory cannot be allocated, it
  * prints error to stderr and exit application with EXIT_FAILURE code.
@@ -95,20 +171,48 @@ struct SExpression *alloc_sexpr(enum Type type);
 /* ************************************************************************ */
 
 /**
- * @brief Free S-expression object.
+ * @brief Create a new integer range.
+ *
+ * @param start  The first item.
+ * @param step   Difference between two items.
+ * @param length Number of items, it must not be zero.
+ *
+ * @return Allocated object.
+ */
+struct SExpression *alloc_range(long start, long step, long length);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads integer range.
  *
- * @param expr Object.
+ * @param expr  Range S-expression.
+ * @param range Output range.
  */
-void free_sexpr(struct SExpression *expr);
+void get_range(const struct SExpression *expr, struct Range *range);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Writes S-expression to file.
+ *
+ * Following expressions are not written.
+ *
+ * @param file Output file.
+ * @param expr S-expression object.
+ */
+void write_sexpr(FILE *file, const struct SExpression *expr);
 
 /* ************************************************************************ */
 
 /**
  * @brief Prints S-expression to stdout.
  *
+ * Following expressions are not printed.
+ *
  * @param expr S-expression object.
  */
-void print_sexpr(struct SExpression *expr);
+void print_sexpr(const struct SExpression *expr);
 
 /* ************************************************************************ */
 
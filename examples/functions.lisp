@@ -0,0 +1,14 @@
+(defun sq (x) (* x x))
+(+ (sq 3) (sq 4))
+(defun fact (n acc) (if (= n 0) acc (fact (- n 1) (* n acc))))
+(fact 10 1)
+(defun fib (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))
+(fib 15)
+(defun even (n) (if (= n 0) t (odd (- n 1))))
+(defun odd (n) (if (= n 0) nil (even (- n 1))))
+(even 100000)
+((lambda (x y) (- x y)) 10 3)
+(let ((a 1) (b 2)) (+ a b))
+(let* ((a 1) (b (+ a 1))) (* a b))
+(defun countdown (n) (let ((m (- n 1))) (if (= m 0) 'done (countdown m))))
+(countdown 100000)
@@ -32,9 +32,21 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 
 /* LISP */
 #include "interpret.h"
+#include "gc.h"
+#include "image.h"
+#include "hash.h"
+#include "pool.h"
+#include "reader.h"
+#include "vector.h"
+#include "text.h"
+#include "csv.h"
+#include "sort.h"
 
 /* ************************************************************************ */
 
@@ -46,10 +58,10 @@
  *
  * @return Result value.
  */
-static int f_add(unsigned int argc, int* argv)
+static long f_add(unsigned int argc, long* argv)
 {
     unsigned int i;
-    int result = 0;
+    long result = 0;
 
     for (i = 0; i < argc; i++)
         result += argv[i];
@@ -67,10 +79,10 @@ static int f_add(unsigned int argc, int* argv)
  *
  * @return Result value.
  */
-static int f_sub(unsigned int argc, int* argv)
+static long f_sub(unsigned int argc, long* argv)
 {
     unsigned int i;
-    int result;
+    long result;
 
     if (argc == 0)
         return 0;
@@ -93,10 +105,10 @@ static int f_sub(unsigned int argc, int* argv)
  *
  * @return Result value.
  */
-static int f_mult(unsigned int argc, int* argv)
+static long f_mult(unsigned int argc, long* argv)
 {
     unsigned int i;
-    int result = 1;
+    long result = 1;
 
     for (i = 0; i < argc; i++)
         result *= argv[i];
@@ -107,17 +119,25 @@ static int f_mult(unsigned int argc, int* argv)
 /* ************************************************************************ */
 
 /**
- * @brief Division arithmetic function.
+ * @brief If integer division has a remainder.
+ */
+static int l_inexact = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Division arithmetic function. Remainder or overflow sets
+ * `l_inexact`.
  *
  * @param argc Number of arguments.
  * @param argv Array of arguments.
  *
  * @return Result value.
  */
-static int f_div(unsigned int argc, int* argv)
+static long f_div(unsigned int argc, long* argv)
 {
     unsigned int i;
-    int result;
+    long result;
 
     if (argc == 0)
         return 0;
@@ -125,7 +145,26 @@ static int f_div(unsigned int argc, int* argv)
     result = argv[0];
 
     for (i = 1; i < argc; i++)
+    {
+        if (argv[i] == 0)
+            syntax_error("Division by zero");
+
+        /* Negated LONG_MIN is not an integer, remainder would trap too */
+        if (argv[i] == -1)
+        {
+            if (result == LONG_MIN)
+                l_inexact = 1;
+            else
+                result = -result;
+
+            continue;
+        }
+
+        if (result % argv[i])
+            l_inexact = 1;
+
         result /= argv[i];
+    }
 
     return result;
 }
@@ -140,7 +179,7 @@ static int f_div(unsigned int argc, int* argv)
  *
  * @return Result value.
  */
-static int f_eq(unsigned int argc, int* argv)
+static long f_eq(unsigned int argc, long* argv)
 {
     unsigned int i;
     int result = 1;
@@ -161,7 +200,7 @@ static int f_eq(unsigned int argc, int* argv)
  *
  * @return Result value.
  */
-static int f_neq(unsigned int argc, int* argv)
+static long f_neq(unsigned int argc, long* argv)
 {
     unsigned int i;
     int result = 1;
@@ -182,7 +221,7 @@ static int f_neq(unsigned int argc, int* argv)
  *
  * @return Result value.
  */
-static int f_gt(unsigned int argc, int* argv)
+static long f_gt(unsigned int argc, long* argv)
 {
     unsigned int i;
     int result = 1;
@@ -203,7 +242,7 @@ static int f_gt(unsigned int argc, int* argv)
  *
  * @return Result value.
  */
-static int f_ge(unsigned int argc, int* argv)
+static long f_ge(unsigned int argc, long* argv)
 {
     unsigned int i;
     int result = 1;
@@ -224,7 +263,7 @@ static int f_ge(unsigned int argc, int* argv)
  *
  * @return Result value.
  */
-static int f_lt(unsigned int argc, int* argv)
+static long f_lt(unsigned int argc, long* argv)
 {
     unsigned int i;
     int result = 1;
@@ -245,7 +284,7 @@ static int f_lt(unsigned int argc, int* argv)
  *
  * @return Result value.
  */
-static int f_le(unsigned int argc, int* argv)
+static long f_le(unsigned int argc, long* argv)
 {
     unsigned int i;
     int result = 1;
@@ -259,194 +298,2070 @@ static int f_le(unsigned int argc, int* argv)
 /* ************************************************************************ */
 
 /**
- * @brief Converts expression to boolean result.
+ * @brief Floating point addition function.
  *
- * @param expr Source expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
- * @return Modified expression.
+ * @return Result value.
  */
-struct SExpression* to_bool(struct SExpression* expr)
+static double f_fadd(unsigned int argc, double* argv)
 {
-    if (expr->lvalue[0] == '1')
-    {
-        strcpy(expr->lvalue, "T");
-        expr->type = TYPE_VALUE;
-    }
-    else
-    {
-        expr->lvalue[0] = '\0';
-        expr->type = TYPE_NIL;
-    }
+    unsigned int i;
+    double result = 0;
 
-    return expr;
+    for (i = 0; i < argc; i++)
+        result += argv[i];
+
+    return result;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_quit(struct SExpression *expr)
+/**
+ * @brief Floating point substraction function.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Result value.
+ */
+static double f_fsub(unsigned int argc, double* argv)
 {
-    /* Memory is freed by atexit callback (clean_up) */
-    exit(EXIT_SUCCESS);
+    unsigned int i;
+    double result;
+
+    if (argc == 0)
+        return 0;
+
+    result = argv[0];
+
+    for (i = 1; i < argc; i++)
+        result -= argv[i];
+
+    return result;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_set(struct SExpression *expr)
+/**
+ * @brief Floating point multiplication function.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Result value.
+ */
+static double f_fmult(unsigned int argc, double* argv)
 {
-    if (!expr->right)
-        syntax_error("Missing variable name");
+    unsigned int i;
+    double result = 1;
 
-    if (!expr->right->right)
-        syntax_error("Missing variable value");
+    for (i = 0; i < argc; i++)
+        result *= argv[i];
+
+    return result;
+}
 
-    if (expr->right->right->type != TYPE_VALUE)
-        syntax_error("Invalid value type");
+/* ************************************************************************ */
 
-    /* Store variable value */
-    set_variable(expr->right->lvalue, atoi(expr->right->right->lvalue));
+/**
+ * @brief Floating point division function.
+ *
+ * Division by zero gives infinity or NaN.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Result value.
+ */
+static double f_fdiv(unsigned int argc, double* argv)
+{
+    unsigned int i;
+    double result;
+
+    if (argc == 0)
+        return 0;
 
-    /* Modify initial expression */
-    expr->type = TYPE_VALUE;
-    strcpy(expr->lvalue, expr->right->right->lvalue);
+    result = argv[0];
 
-    /* Delete arguments parts */
-    free_sexpr(expr->right);
-    expr->right = NULL;
+    for (i = 1; i < argc; i++)
+        result /= argv[i];
 
-    /* Return set value */
-    return expr;
+    return result;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Floating point equation function.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Result value.
+ */
+static double f_feq(unsigned int argc, double* argv)
+{
+    unsigned int i;
+    int result = 1;
+
+    for (i = 1; i < argc; i++)
+        result &= (argv[0] == argv[i]);
+
+    return result;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Floating point non-equation function.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Result value.
+ */
+static double f_fneq(unsigned int argc, double* argv)
+{
+    unsigned int i;
+    int result = 1;
+
+    for (i = 1; i < argc; i++)
+        result &= (argv[0] != argv[i]);
+
+    return result;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_add(struct SExpression *expr)
+/**
+ * @brief Floating point greater than function.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Result value.
+ */
+static double f_fgt(unsigned int argc, double* argv)
 {
-    return func_arithm_base(expr, f_add);
+    unsigned int i;
+    int result = 1;
+
+    for (i = 1; i < argc; i++)
+        result &= (argv[i - 1] > argv[i]);
+
+    return result;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_sub(struct SExpression *expr)
+/**
+ * @brief Floating point greater equals function.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Result value.
+ */
+static double f_fge(unsigned int argc, double* argv)
 {
-    return func_arithm_base(expr, f_sub);
+    unsigned int i;
+    int result = 1;
+
+    for (i = 1; i < argc; i++)
+        result &= (argv[i - 1] >= argv[i]);
+
+    return result;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_mult(struct SExpression *expr)
+/**
+ * @brief Floating point less than function.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Result value.
+ */
+static double f_flt(unsigned int argc, double* argv)
 {
-    return func_arithm_base(expr, f_mult);
+    unsigned int i;
+    int result = 1;
+
+    for (i = 1; i < argc; i++)
+        result &= (argv[i - 1] < argv[i]);
+
+    return result;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_div(struct SExpression *expr)
+/**
+ * @brief Floating point less equals function.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Result value.
+ */
+static double f_fle(unsigned int argc, double* argv)
 {
-    return func_arithm_base(expr, f_div);
+    unsigned int i;
+    int result = 1;
+
+    for (i = 1; i < argc; i++)
+        result &= (argv[i - 1] <= argv[i]);
+
+    return result;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_eq(struct SExpression *expr)
+/**
+ * @brief Converts expression to boolean result.
+ *
+ * @param expr Source expression.
+ *
+ * @return T or NIL.
+ */
+static struct SExpression* to_bool(struct SExpression* expr)
 {
-    return to_bool(func_arithm_base(expr, f_eq));
+    return get_value(expr) ? &sexpr_true : &sexpr_nil;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_neq(struct SExpression *expr)
+/**
+ * @brief Checks number of function arguments.
+ *
+ * @param argc  Number of arguments.
+ * @param count Required number of arguments.
+ */
+static void check_args(unsigned int argc, unsigned int count)
 {
-    return to_bool(func_arithm_base(expr, f_neq));
+    if (argc != count)
+        syntax_error("Invalid number of arguments");
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_quote(struct SExpression *expr)
+/**
+ * @brief Checks if expression is a cons cell.
+ *
+ * @param expr Expression.
+ */
+static void check_list(const struct SExpression *expr)
 {
-    struct SExpression *tmp = expr;
+    if (expr->type != TYPE_CONS)
+        syntax_error("List expected");
+}
 
-    for (; tmp != NULL; tmp = tmp->right)
-        tmp->type = TYPE_QUOTED;
+/* ************************************************************************ */
 
-    return expr;
+/**
+ * @brief Returns absolute value of integer without overflow.
+ *
+ * @param value Integer.
+ *
+ * @return Absolute value.
+ */
+static unsigned long abs_value(long value)
+{
+    return value < 0 ? 0UL - (unsigned long) value : (unsigned long) value;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_list(struct SExpression *expr)
+/**
+ * @brief Returns part of range.
+ *
+ * @param expr   Range.
+ * @param offset Index of the first item.
+ * @param count  Maximum number of items.
+ *
+ * @return Range or NIL if it's empty.
+ */
+static struct SExpression *sub_range(const struct SExpression *expr, long offset,
+    long count)
 {
-    /* Return list without the first value */
-    struct SExpression *res = expr->right;
-    res->type = TYPE_SEXPR;
+    struct Range range;
 
-    expr->right = NULL;
-    free_sexpr(expr);
+    get_range(expr, &range);
 
-    return res;
+    if (offset >= range.length || count <= 0)
+        return &sexpr_nil;
+
+    if (count > range.length - offset)
+        count = range.length - offset;
+
+    return alloc_range(range.start + offset * range.step, range.step, count);
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_car(struct SExpression *expr)
+/**
+ * @brief Returns part of vector, items are shared with the vector.
+ *
+ * @param expr   Vector, it must be reachable by garbage collector.
+ * @param offset Index of the first item.
+ * @param count  Maximum number of items.
+ *
+ * @return Vector or NIL if it's empty.
+ */
+static struct SExpression *sub_vector(struct SExpression *expr,
+    long offset, long count)
 {
-    /* Return list without the first value */
-    struct SExpression *res = expr->right;
-    res->type = TYPE_VALUE;
+    const struct Vector *data = vector_get(expr);
 
-    /* Free rest of list */
-    if (res->right)
-    {
-        free_sexpr(res->right);
-        res->right = NULL;
-    }
+    if ((unsigned long) offset >= data->length || count <= 0)
+        return &sexpr_nil;
 
-    /* Free beginning */
-    expr->right = NULL;
-    free_sexpr(expr);
+    if ((unsigned long) count > data->length - offset)
+        count = (long) (data->length - offset);
 
-    return res;
+    return vector_view(expr, (unsigned long) offset, (unsigned long) count);
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_cdr(struct SExpression *expr)
+/**
+ * @brief Returns range item.
+ *
+ * @param expr  Range.
+ * @param index Item index.
+ *
+ * @return Number or NIL if index is out of range.
+ */
+static struct SExpression *range_item(const struct SExpression *expr, long index)
 {
-    /* Return list without the first value */
-    struct SExpression *res = expr->right->right;
-    res->type = TYPE_SEXPR;
+    struct Range range;
 
-    expr->right->right = NULL;
-    free_sexpr(expr);
+    get_range(expr, &range);
 
-    return res;
+    if (index >= range.length)
+        return &sexpr_nil;
+
+    return alloc_value(range.start + index * range.step);
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_gt(struct SExpression *expr)
+/**
+ * @brief Checks if expression is a hash table.
+ *
+ * @param expr Expression.
+ */
+static void check_hash(const struct SExpression *expr)
 {
-    return to_bool(func_arithm_base(expr, f_gt));
+    if (expr->type != TYPE_HASH)
+        syntax_error("Hash table expected");
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_ge(struct SExpression *expr)
+/**
+ * @brief Checks if expression is a line reader.
+ *
+ * @param expr Expression.
+ */
+static void check_reader(const struct SExpression *expr)
 {
-    return to_bool(func_arithm_base(expr, f_ge));
+    if (expr->type != TYPE_READER)
+        syntax_error("Line reader expected");
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_lt(struct SExpression *expr)
+/**
+ * @brief Creates cons cell.
+ *
+ * Arguments must be reachable by garbage collector.
+ *
+ * @param car The first item.
+ * @param cdr Rest of the list.
+ *
+ * @return Cons cell.
+ */
+static struct SExpression *make_cons(struct SExpression *car, struct SExpression *cdr)
 {
-    return to_bool(func_arithm_base(expr, f_lt));
+    struct SExpression *expr = alloc_sexpr(TYPE_CONS);
+    expr->list = car;
+    expr->right = cdr;
+
+    return expr;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_le(struct SExpression *expr)
+/**
+ * @brief Sequence processed by parallel tasks.
+ */
+struct Sequence
+{
+    /** Applied function. */
+    struct SExpression *func;
+
+    /** The first cons cell. */
+    struct SExpression *head;
+
+    /** Number of cons cells. */
+    unsigned long count;
+
+    /** Range after cons cells, vector without cons cells or NIL. */
+    struct SExpression *tail;
+
+    /** Cons cell of the last item, tasks of one process go forward. */
+    struct SExpression *cell;
+
+    /** Index of the last item. */
+    unsigned long position;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Prepares list, lazy sequence, range or vector for parallel tasks.
+ *
+ * Lazy sequence is realized, so the whole sequence must stay reachable.
+ *
+ * @param seq  Sequence.
+ * @param func Applied function.
+ * @param list Argument with sequence, it's replaced by realized sequence.
+ *
+ * @return Number of items.
+ */
+static unsigned long init_sequence(struct Sequence *seq,
+    struct SExpression *func, struct SExpression **list)
 {
-    return to_bool(func_arithm_base(expr, f_le));
+    struct SExpression *item;
+    unsigned long length = 0;
+
+    seq->func = func;
+    seq->head = seq->cell = *list = force(*list);
+    seq->position = 0;
+
+    for (item = seq->head; item->type == TYPE_CONS; item = force(item->right))
+        ++length;
+
+    seq->count = length;
+    seq->tail = item;
+
+    if (item->type == TYPE_RANGE)
+    {
+        struct Range range;
+
+        get_range(item, &range);
+        length += range.length;
+    }
+    else if (item->type == TYPE_VECTOR && length == 0)
+    {
+        length = vector_get(item)->length;
+    }
+    else if (item->type != TYPE_NIL)
+    {
+        check_list(item);
+    }
+
+    return length;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns sequence item.
+ *
+ * @param seq   Sequence.
+ * @param index Item index.
+ *
+ * @return Item, range or vector item must be made reachable.
+ */
+static struct SExpression *sequence_item(struct Sequence *seq,
+    unsigned long index)
+{
+    if (index >= seq->count && seq->tail->type == TYPE_VECTOR)
+        return vector_item(seq->tail, index - seq->count);
+
+    if (index >= seq->count)
+        return range_item(seq->tail, (long) (index - seq->count));
+
+    if (index < seq->position)
+    {
+        seq->cell = seq->head;
+        seq->position = 0;
+    }
+
+    for (; seq->position < index; ++seq->position)
+        seq->cell = force(seq->cell->right);
+
+    return seq->cell->list;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief PMAP task, applies function to items.
+ *
+ * @param begin The first item.
+ * @param end   Item after the last one.
+ * @param data  Sequence.
+ *
+ * @return List of results.
+ */
+static struct SExpression *pmap_task(unsigned long begin, unsigned long end,
+    void *data)
+{
+    struct Sequence *seq = (struct Sequence *) data;
+    struct SExpression *res = &sexpr_nil;
+    struct SExpression *last = NULL;
+    unsigned long i;
+
+    for (i = begin; i < end; ++i)
+    {
+        struct SExpression *item = sequence_item(seq, i);
+        struct SExpression *cell;
+
+        /* Item and result must be reachable during allocation */
+        push_value(item);
+        item = apply_function(seq->func, 1, &item);
+        push_value(item);
+        cell = make_cons(item, &sexpr_nil);
+        pop_values(2);
+
+        if (last)
+        {
+            last->right = cell;
+        }
+        else
+        {
+            res = cell;
+            push_value(res);
+        }
+
+        last = cell;
+    }
+
+    if (last)
+        pop_values(1);
+
+    return res;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief PREDUCE task, combines items from left.
+ *
+ * @param begin The first item.
+ * @param end   Item after the last one, there is at least one item.
+ * @param data  Sequence.
+ *
+ * @return Combined items.
+ */
+static struct SExpression *preduce_task(unsigned long begin, unsigned long end,
+    void *data)
+{
+    struct Sequence *seq = (struct Sequence *) data;
+    struct SExpression *args[2];
+    unsigned long i;
+
+    args[0] = sequence_item(seq, begin);
+    push_value(args[0]);
+
+    for (i = begin + 1; i < end; ++i)
+    {
+        args[1] = sequence_item(seq, i);
+        push_value(args[1]);
+
+        /* Only the combined value is kept */
+        args[0] = apply_function(seq->func, 2, args);
+        pop_values(2);
+        push_value(args[0]);
+    }
+
+    pop_values(1);
+
+    return args[0];
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief PFOR-EACH task, applies function to items.
+ *
+ * @param begin The first item.
+ * @param end   Item after the last one.
+ * @param data  Sequence.
+ *
+ * @return NIL.
+ */
+static struct SExpression *pfor_each_task(unsigned long begin,
+    unsigned long end, void *data)
+{
+    struct Sequence *seq = (struct Sequence *) data;
+    unsigned long i;
+
+    for (i = begin; i < end; ++i)
+    {
+        struct SExpression *item = sequence_item(seq, i);
+
+        push_value(item);
+        apply_function(seq->func, 1, &item);
+        pop_values(1);
+    }
+
+    return &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Converts text of string into number.
+ *
+ * @param text   Text.
+ * @param length Text length.
+ *
+ * @return Number or NULL if text is not a number.
+ */
+static struct SExpression *parse_text(const char *text, size_t length)
+{
+    char number[64];
+    char *end;
+
+    /* Hexadecimal, infinite and NaN numbers are not supported by reader */
+    if (length < sizeof(number) && (isdigit((unsigned char) text[0]) ||
+        (length > 1 && strchr("+-.", text[0]) &&
+        (isdigit((unsigned char) text[1]) || text[1] == '.'))) &&
+        memchr(text, 'x', length) == NULL && memchr(text, 'X', length) == NULL)
+    {
+        long value;
+        double real;
+
+        memcpy(number, text, length);
+        number[length] = '\0';
+
+        errno = 0;
+        value = strtol(number, &end, 10);
+
+        /* Too big integer is stored as floating point number */
+        if (*end == '\0' && errno != ERANGE)
+            return alloc_value(value);
+
+        real = strtod(number, &end);
+
+        if (*end == '\0')
+            return alloc_float(real);
+    }
+
+    return NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns number or number stored in string.
+ *
+ * @param expr Number or string, it must be reachable by garbage collector.
+ *
+ * @return Number.
+ */
+static struct SExpression *get_number(struct SExpression *expr)
+{
+    if (expr->type == TYPE_STRING &&
+        (expr = parse_text(text_get(expr), strlen(text_get(expr)))) == NULL)
+        syntax_error("Number expected");
+
+    return expr;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads the next line.
+ *
+ * @param reader Line reader.
+ *
+ * @return String with line text or NULL at end of file.
+ */
+static struct SExpression *read_line(struct SExpression *reader)
+{
+    const char *line;
+    size_t length;
+    int status = reader_next(reader, &line, &length);
+
+    if (status == -2)
+        syntax_error("Line is too long");
+
+    if (status < 0)
+        syntax_error("Line reader cannot be used in worker process");
+
+    if (status == 0)
+        return NULL;
+
+    return text_create(line, length);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns order of predicate which is known to compare numbers.
+ *
+ * @param pred Predicate, NIL for the default order.
+ *
+ * @return 1 for ascending order, -1 for descending one, 0 for other
+ * predicate.
+ */
+static int sort_order(const struct SExpression *pred)
+{
+    if (pred->type == TYPE_NIL)
+        return 1;
+
+    if (pred->type != TYPE_QUOTED || pred->list)
+        return 0;
+
+    if (!strcmp(pred->lvalue, "<") || !strcmp(pred->lvalue, "<="))
+        return 1;
+
+    if (!strcmp(pred->lvalue, ">") || !strcmp(pred->lvalue, ">="))
+        return -1;
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks if item is integer or floating point number.
+ *
+ * @param item Item.
+ *
+ * @return If item is a number.
+ */
+static int is_numeric(const struct SExpression *item)
+{
+    /* T is stored as text */
+    if (item->type == TYPE_VALUE)
+        return !item->list && item != &sexpr_true;
+
+    return item->type == TYPE_FLOAT;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Compares items by < or > function.
+ *
+ * @param first  The first item.
+ * @param second The second item.
+ * @param data   Sort order.
+ *
+ * @return If the first item goes first.
+ */
+static int order_less(struct SExpression *first, struct SExpression *second,
+    void *data)
+{
+    struct SExpression *args[2];
+
+    args[0] = first;
+    args[1] = second;
+
+    if (*(int *) data < 0)
+        return func_gt(2, args)->type != TYPE_NIL;
+
+    return func_lt(2, args)->type != TYPE_NIL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Compares items by predicate.
+ *
+ * @param first  The first item.
+ * @param second The second item.
+ * @param data   Predicate.
+ *
+ * @return If the first item goes first.
+ */
+static int predicate_less(struct SExpression *first,
+    struct SExpression *second, void *data)
+{
+    struct SExpression *args[2];
+
+    args[0] = first;
+    args[1] = second;
+
+    return apply_function((struct SExpression *) data, 2, args)->type !=
+        TYPE_NIL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks if all sequence items are integers.
+ *
+ * @param seq Sequence.
+ *
+ * @return If items are integers.
+ */
+static int is_integer_sequence(const struct Sequence *seq)
+{
+    const struct SExpression *cell = seq->head;
+    unsigned long i;
+
+    /* Only range items are generated */
+    if (seq->tail->type == TYPE_VECTOR)
+        return 0;
+
+    for (i = 0; i < seq->count; ++i, cell = cell->right)
+    {
+        if (cell->list->type != TYPE_VALUE || cell->list == &sexpr_true)
+            return 0;
+    }
+
+    return 1;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Sorts integer sequence by radix sort.
+ *
+ * @param seq   Sequence.
+ * @param count Number of items.
+ * @param order Sort order.
+ *
+ * @return Sorted list.
+ */
+static struct SExpression *sort_integers(const struct Sequence *seq,
+    unsigned long count, int order)
+{
+    union VectorItem *items = sort_buffer(count);
+    struct SExpression *res = &sexpr_nil;
+    const struct SExpression *cell = seq->head;
+    unsigned long i;
+
+    for (i = 0; i < seq->count; ++i, cell = cell->right)
+        memcpy(&items[i].integer, cell->list->lvalue, sizeof(long));
+
+    if (i < count)
+    {
+        struct Range range;
+
+        get_range(seq->tail, &range);
+
+        for (; i < count; ++i)
+            items[i].integer = range.start + (long) (i - seq->count) *
+                range.step;
+    }
+
+    sort_items(items, count, VECTOR_INTEGER);
+
+    /* Built from the end */
+    for (i = 0; i < count; ++i)
+    {
+        struct SExpression *item;
+
+        push_value(res);
+        item = alloc_value(items[order > 0 ? count - 1 - i : i].integer);
+        push_value(item);
+        res = make_cons(item, res);
+        pop_values(2);
+    }
+
+    return res;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Sorts vector in place.
+ *
+ * @param vector Vector.
+ * @param pred   Predicate.
+ * @param order  Sort order or 0 when predicate is called.
+ *
+ * @return Vector.
+ */
+static struct SExpression *sort_vector(struct SExpression *vector,
+    struct SExpression *pred, int order)
+{
+    struct Vector *data = vector_get(vector);
+    struct SExpression *list = &sexpr_nil;
+    struct SExpression *cell;
+    unsigned long i;
+
+    if (order)
+    {
+        sort_items(data->items, data->length, data->kind);
+
+        for (i = 0; order < 0 && i < data->length / 2; ++i)
+        {
+            union VectorItem item = data->items[i];
+
+            data->items[i] = data->items[data->length - 1 - i];
+            data->items[data->length - 1 - i] = item;
+        }
+
+        return vector;
+    }
+
+    /* Items are sorted as list and stored back */
+    for (i = data->length; i > 0; --i)
+    {
+        struct SExpression *item;
+
+        push_value(list);
+        item = vector_item(vector, i - 1);
+        push_value(item);
+        list = make_cons(item, list);
+        pop_values(2);
+    }
+
+    push_value(list);
+    sort_list(list, data->length, &predicate_less, pred);
+
+    for (i = 0, cell = list; i < data->length; ++i, cell = cell->right)
+    {
+        if (data->kind == VECTOR_FLOAT)
+            memcpy(&data->items[i].real, cell->list->lvalue, sizeof(double));
+        else
+            memcpy(&data->items[i].integer, cell->list->lvalue, sizeof(long));
+    }
+
+    pop_values(1);
+
+    return vector;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Helper function for LET and LET* special forms.
+ *
+ * @param expr       S-expression.
+ * @param sequential If variables are initialized one by one.
+ *
+ * @return The last body form for evaluation.
+ */
+static struct SExpression *let_base(struct SExpression *expr, int sequential)
+{
+    struct SExpression *item;
+    struct SExpression *values[MAX_FRAME_SIZE];
+    unsigned int count = 0;
+    unsigned int i;
+
+    /* Checked by compile */
+    assert(expr->right);
+
+    for (item = expr->right->list; item != NULL; item = item->right)
+        ++count;
+
+    /* Variables are visible during initialization */
+    if (sequential)
+        push_frame(count);
+
+    for (item = expr->right->list, i = 0; i < count; item = item->right, ++i)
+    {
+        struct SExpression *value = &sexpr_nil;
+
+        /* Variable with value */
+        if (item->list && item->list->right)
+            value = eval_sexpr(item->list->right);
+
+        if (sequential)
+        {
+            set_local(0, i, value);
+        }
+        else
+        {
+            /* Value must be reachable until it's stored */
+            values[i] = value;
+            push_value(value);
+        }
+    }
+
+    if (!sequential)
+    {
+        push_frame(count);
+
+        for (i = 0; i < count; ++i)
+            set_local(0, i, values[i]);
+
+        pop_values(count);
+    }
+
+    item = expr->right->right;
+
+    if (!item)
+        return &sexpr_nil;
+
+    /* Evaluate body forms */
+    for (; item->right != NULL; item = item->right)
+        eval_sexpr(item);
+
+    /* The last form is evaluated in place */
+    return item;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_quit(unsigned int argc, struct SExpression **argv)
+{
+    /* Memory is freed by atexit callback (clean_up) */
+    exit(EXIT_SUCCESS);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_set(unsigned int argc, struct SExpression **argv)
+{
+    if (argc < 1 || argv[0]->type != TYPE_QUOTED || !isalpha(argv[0]->lvalue[0]))
+        syntax_error("Missing variable name");
+
+    if (argc < 2)
+        syntax_error("Missing variable value");
+
+    check_args(argc, 2);
+
+    /* Store variable value */
+    set_variable(argv[0]->lvalue, argv[1]);
+
+    /* Return set value */
+    return argv[1];
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_if(struct SExpression *expr)
+{
+    struct SExpression *branch;
+
+    if (!expr->right)
+        syntax_error("Missing condition");
+
+    if (!expr->right->right)
+        syntax_error("Missing IF branch");
+
+    if (expr->right->right->right && expr->right->right->right->right)
+        syntax_error("Too many IF branches");
+
+    branch = expr->right->right;
+
+    /* Select else branch */
+    if (eval_sexpr(expr->right)->type == TYPE_NIL)
+        branch = branch->right;
+
+    /* Missing else branch */
+    if (!branch)
+        return &sexpr_nil;
+
+    return branch;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_defun(struct SExpression *expr)
+{
+    struct SExpression *name = expr->right;
+    struct SExpression *res;
+
+    if (!name || name->list || name->type != TYPE_SYMBOL ||
+        !isalpha(name->lvalue[0]))
+        syntax_error("Missing function name");
+
+    /* Store parameters and body */
+    set_function(name->lvalue, name->right);
+
+    /* Return function name */
+    res = alloc_sexpr(TYPE_QUOTED);
+    strcpy(res->lvalue, name->lvalue);
+
+    return res;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_lambda(struct SExpression *expr)
+{
+    /* Function object refers to parameters, body and captured values */
+    return make_lambda(expr->right);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_let(struct SExpression *expr)
+{
+    return let_base(expr, 0);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_let_seq(struct SExpression *expr)
+{
+    return let_base(expr, 1);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_add(unsigned int argc, struct SExpression **argv)
+{
+    return func_arithm_base(argc, argv, f_add, f_fadd);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_sub(unsigned int argc, struct SExpression **argv)
+{
+    return func_arithm_base(argc, argv, f_sub, f_fsub);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_mult(unsigned int argc, struct SExpression **argv)
+{
+    return func_arithm_base(argc, argv, f_mult, f_fmult);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_div(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *result;
+
+    /* Divisors are checked by f_div, they can be items of range */
+    l_inexact = 0;
+    result = func_arithm_base(argc, argv, f_div, f_fdiv);
+
+    /* Fraction is a floating point number */
+    if (l_inexact)
+        return float_arithm_base(argc, argv, f_fdiv);
+
+    return result;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_eq(unsigned int argc, struct SExpression **argv)
+{
+    return to_bool(func_compare_base(argc, argv, f_eq, f_feq, 0));
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_neq(unsigned int argc, struct SExpression **argv)
+{
+    return to_bool(func_compare_base(argc, argv, f_neq, f_fneq, 0));
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_float(unsigned int argc, struct SExpression **argv)
+{
+    check_args(argc, 1);
+
+    if (argv[0]->type == TYPE_FLOAT)
+        return argv[0];
+
+    return alloc_float(get_float(get_number(argv[0])));
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_truncate(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *number;
+    double value;
+
+    check_args(argc, 1);
+
+    number = get_number(argv[0]);
+
+    if (number->type == TYPE_FLOAT)
+    {
+        value = get_float(number);
+
+        /* NaN fails both comparisons */
+        if (!(value >= (double) LONG_MIN && value < -(double) LONG_MIN))
+            syntax_error("Number out of range");
+    }
+
+    return alloc_value(get_value(number));
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_dotimes(struct SExpression *expr)
+{
+    struct SExpression *spec;
+    struct SExpression *body;
+    struct Block block;
+    long count;
+    long i;
+
+    /* Checked by compile */
+    assert(expr->right && expr->right->list && expr->right->list->right);
+
+    spec = expr->right->list;
+    count = get_value(eval_sexpr(spec->right));
+
+    /* Counter is bound once */
+    push_frame(1);
+
+    enter_block(&block);
+
+    if (setjmp(block.jump))
+        return leave_block(&block);
+
+    for (i = 0; i < count; ++i)
+    {
+        set_local(0, 0, alloc_value(i));
+
+        for (body = expr->right->right; body != NULL; body = body->right)
+            eval_sexpr(body);
+    }
+
+    leave_block(&block);
+
+    /* Result is evaluated in place with counter equal to count */
+    set_local(0, 0, alloc_value(count < 0 ? 0 : count));
+
+    return spec->right->right ? spec->right->right : &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_while(struct SExpression *expr)
+{
+    struct SExpression *body;
+    struct Block block;
+
+    if (!expr->right)
+        syntax_error("Missing condition");
+
+    enter_block(&block);
+
+    if (setjmp(block.jump))
+        return leave_block(&block);
+
+    while (eval_sexpr(expr->right)->type != TYPE_NIL)
+    {
+        for (body = expr->right->right; body != NULL; body = body->right)
+            eval_sexpr(body);
+    }
+
+    leave_block(&block);
+
+    return &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_loop(struct SExpression *expr)
+{
+    struct SExpression *body;
+    struct Block block;
+
+    enter_block(&block);
+
+    if (setjmp(block.jump))
+        return leave_block(&block);
+
+    /* Only RETURN ends the loop */
+    while (1)
+    {
+        for (body = expr->right; body != NULL; body = body->right)
+            eval_sexpr(body);
+    }
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_return(unsigned int argc, struct SExpression **argv)
+{
+    if (argc > 1)
+        syntax_error("Invalid number of arguments");
+
+    return_from_block(argc ? argv[0] : &sexpr_nil);
+
+    /* Not reachable */
+    return &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_quote(struct SExpression *expr)
+{
+    if (!expr->right)
+        syntax_error("Missing QUOTE argument");
+
+    if (expr->right->right)
+        syntax_error("Too many QUOTE arguments");
+
+    /* Argument is marked as quoted by compile */
+    return expr->right;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_list(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *res = &sexpr_nil;
+    unsigned int i;
+
+    /* Built from the end, arguments are shared */
+    for (i = argc; i > 0; --i)
+    {
+        /* Result must be reachable during allocation */
+        push_value(res);
+        res = make_cons(argv[i - 1], res);
+        pop_values(1);
+    }
+
+    return res;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_car(unsigned int argc, struct SExpression **argv)
+{
+    check_args(argc, 1);
+
+    argv[0] = force(argv[0]);
+
+    if (argv[0]->type == TYPE_NIL)
+        return &sexpr_nil;
+
+    if (argv[0]->type == TYPE_RANGE)
+        return range_item(argv[0], 0);
+
+    if (argv[0]->type == TYPE_VECTOR)
+    {
+        if (vector_get(argv[0])->length == 0)
+            return &sexpr_nil;
+
+        return vector_item(argv[0], 0);
+    }
+
+    check_list(argv[0]);
+
+    return argv[0]->list;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_cdr(unsigned int argc, struct SExpression **argv)
+{
+    check_args(argc, 1);
+
+    argv[0] = force(argv[0]);
+
+    if (argv[0]->type == TYPE_NIL)
+        return &sexpr_nil;
+
+    if (argv[0]->type == TYPE_RANGE)
+        return sub_range(argv[0], 1, LONG_MAX);
+
+    if (argv[0]->type == TYPE_VECTOR)
+        return sub_vector(argv[0], 1, LONG_MAX);
+
+    check_list(argv[0]);
+
+    return argv[0]->right;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_cons(unsigned int argc, struct SExpression **argv)
+{
+    check_args(argc, 2);
+
+    return make_cons(argv[0], argv[1]);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_nth(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *list;
+    long index;
+
+    check_args(argc, 2);
+
+    index = get_value(argv[0]);
+
+    if (index < 0)
+        syntax_error("Invalid list index");
+
+    if (argv[1]->type == TYPE_VECTOR)
+    {
+        if ((unsigned long) index >= vector_get(argv[1])->length)
+            return &sexpr_nil;
+
+        return vector_item(argv[1], (unsigned long) index);
+    }
+
+    /* Walked part of lazy sequence is not kept */
+    for (list = argv[1] = force(argv[1]); list->type == TYPE_CONS;
+        list = argv[1] = force(list->right))
+    {
+        if (!index--)
+            return list->list;
+    }
+
+    if (list->type == TYPE_RANGE)
+        return range_item(list, index);
+
+    if (list->type != TYPE_NIL)
+        check_list(list);
+
+    /* Index out of range */
+    return &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_length(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *list;
+    long length = 0;
+
+    check_args(argc, 1);
+
+    if (argv[0]->type == TYPE_VECTOR)
+        return alloc_value((long) vector_get(argv[0])->length);
+
+    for (list = argv[0] = force(argv[0]); list->type == TYPE_CONS;
+        list = argv[0] = force(list->right))
+        ++length;
+
+    if (list->type == TYPE_RANGE)
+    {
+        struct Range range;
+
+        get_range(list, &range);
+        length += range.length;
+    }
+    else if (list->type != TYPE_NIL)
+    {
+        check_list(list);
+    }
+
+    return alloc_value(length);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_lazy_seq(struct SExpression *expr)
+{
+    return make_lazy(expr->right);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_take(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *res = &sexpr_nil;
+    struct SExpression *list;
+    struct SExpression *last = NULL;
+    long count;
+
+    check_args(argc, 2);
+
+    count = get_value(argv[0]);
+    argv[1] = force(argv[1]);
+
+    if (argv[1]->type == TYPE_VECTOR)
+        return sub_vector(argv[1], 0, count);
+
+    for (list = argv[1]; count > 0 && list->type == TYPE_CONS; --count)
+    {
+        struct SExpression *cell = make_cons(list->list, &sexpr_nil);
+
+        if (last)
+        {
+            last->right = cell;
+        }
+        else
+        {
+            /* Result must be reachable during allocation */
+            res = cell;
+            push_value(res);
+        }
+
+        last = cell;
+
+        /* Walked part of lazy sequence is not kept */
+        list = argv[1] = force(list->right);
+    }
+
+    if (count > 0 && list->type == TYPE_RANGE)
+    {
+        /* Range items are not expanded */
+        struct SExpression *tail = sub_range(list, 0, count);
+
+        if (last)
+            last->right = tail;
+        else
+            res = tail;
+    }
+    else if (count > 0 && list->type != TYPE_NIL)
+    {
+        check_list(list);
+    }
+
+    if (last)
+        pop_values(1);
+
+    return res;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_drop(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *list;
+    long count;
+
+    check_args(argc, 2);
+
+    count = get_value(argv[0]);
+
+    /* Rest of lazy sequence is not evaluated */
+    for (list = argv[1]; count > 0; --count)
+    {
+        list = argv[1] = force(list);
+
+        if (list->type == TYPE_NIL)
+            return list;
+
+        if (list->type == TYPE_RANGE)
+            return sub_range(list, count, LONG_MAX);
+
+        if (list->type == TYPE_VECTOR)
+            return sub_vector(list, count, LONG_MAX);
+
+        check_list(list);
+
+        /* Walked part of lazy sequence is not kept */
+        list = argv[1] = list->right;
+    }
+
+    return list;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_range(unsigned int argc, struct SExpression **argv)
+{
+    long start = 0;
+    long end;
+    long step = 1;
+    long length;
+    unsigned long span;
+
+    if (argc < 1 || argc > 3)
+        syntax_error("Invalid number of arguments");
+
+    if (argc == 1)
+    {
+        end = get_value(argv[0]);
+    }
+    else
+    {
+        start = get_value(argv[0]);
+        end = get_value(argv[1]);
+    }
+
+    if (argc == 3)
+        step = get_value(argv[2]);
+
+    if (step == 0)
+        syntax_error("Invalid range step");
+
+    /* Items are between start and end (excluded) */
+    if (step > 0 ? end <= start : start <= end)
+        return &sexpr_nil;
+
+    /* Distance is computed without overflow */
+    span = step > 0 ? (unsigned long) end - (unsigned long) start :
+        (unsigned long) start - (unsigned long) end;
+
+    /* Every item must be reachable from start by a number */
+    if (span > (unsigned long) LONG_MAX)
+        syntax_error("Invalid range");
+
+    length = (long) ((span - 1) / abs_value(step) + 1);
+
+    return alloc_range(start, step, length);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_iota(unsigned int argc, struct SExpression **argv)
+{
+    long count;
+    long start = 0;
+    long step = 1;
+    unsigned long span;
+
+    if (argc < 1 || argc > 3)
+        syntax_error("Invalid number of arguments");
+
+    count = get_value(argv[0]);
+
+    if (argc > 1)
+        start = get_value(argv[1]);
+
+    if (argc > 2)
+        step = get_value(argv[2]);
+
+    if (count <= 0)
+        return &sexpr_nil;
+
+    /* All items must be numbers and reachable from start by a number */
+    span = abs_value(step);
+
+    if (span && (unsigned long) (count - 1) > (unsigned long) LONG_MAX / span)
+        syntax_error("Invalid range");
+
+    span *= (unsigned long) (count - 1);
+
+    if (step > 0 ? start > LONG_MAX - (long) span : start < LONG_MIN + (long) span)
+        syntax_error("Invalid range");
+
+    return alloc_range(start, step, count);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_gt(unsigned int argc, struct SExpression **argv)
+{
+    return to_bool(func_compare_base(argc, argv, f_gt, f_fgt, 1));
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_ge(unsigned int argc, struct SExpression **argv)
+{
+    return to_bool(func_compare_base(argc, argv, f_ge, f_fge, 1));
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_lt(unsigned int argc, struct SExpression **argv)
+{
+    return to_bool(func_compare_base(argc, argv, f_lt, f_flt, 1));
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_le(unsigned int argc, struct SExpression **argv)
+{
+    return to_bool(func_compare_base(argc, argv, f_le, f_fle, 1));
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_gc(unsigned int argc, struct SExpression **argv)
+{
+    check_args(argc, 0);
+
+    gc_collect();
+
+    return alloc_value(gc_stats()->live);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_gc_stats(unsigned int argc, struct SExpression **argv)
+{
+    const struct GcStats *stats = gc_stats();
+    struct SExpression *values[7];
+    struct SExpression *res;
+
+    check_args(argc, 0);
+
+    values[0] = alloc_value(stats->collections);
+    push_value(values[0]);
+    values[1] = alloc_value(stats->live);
+    push_value(values[1]);
+    values[2] = alloc_value(stats->heap);
+    push_value(values[2]);
+    values[3] = alloc_value(stats->allocated);
+    push_value(values[3]);
+    values[4] = alloc_value(stats->freed);
+    push_value(values[4]);
+    values[5] = alloc_value((long) (stats->pause_total * 1000000));
+    push_value(values[5]);
+    values[6] = alloc_value((long) (stats->pause_max * 1000000));
+    push_value(values[6]);
+
+    res = func_list(7, values);
+    pop_values(7);
+
+    return res;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_gc_tune(unsigned int argc, struct SExpression **argv)
+{
+    check_args(argc, 2);
+
+    if (get_value(argv[0]) <= 0 || get_value(argv[1]) <= 0)
+        syntax_error("Invalid garbage collector parameters");
+
+    gc_configure(get_value(argv[0]), get_value(argv[1]));
+
+    return &sexpr_true;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_make_hash(unsigned int argc, struct SExpression **argv)
+{
+    long size = 0;
+
+    if (argc > 1)
+        syntax_error("Invalid number of arguments");
+
+    if (argc == 1)
+        size = get_value(argv[0]);
+
+    return hash_create(size > 0 ? size : 0);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_gethash(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *value;
+
+    if (argc < 2 || argc > 3)
+        syntax_error("Invalid number of arguments");
+
+    check_hash(argv[1]);
+
+    value = hash_get(argv[1], argv[0]);
+
+    /* Missing key */
+    if (value == NULL)
+        return (argc == 3) ? argv[2] : &sexpr_nil;
+
+    return value;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_puthash(unsigned int argc, struct SExpression **argv)
+{
+    check_args(argc, 3);
+    check_hash(argv[2]);
+
+    hash_put(argv[2], argv[0], argv[1]);
+
+    return argv[1];
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_remhash(unsigned int argc, struct SExpression **argv)
+{
+    check_args(argc, 2);
+    check_hash(argv[1]);
+
+    return hash_remove(argv[1], argv[0]) ? &sexpr_true : &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_hash_count(unsigned int argc, struct SExpression **argv)
+{
+    check_args(argc, 1);
+    check_hash(argv[0]);
+
+    return alloc_value(hash_count(argv[0]));
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_save_image(unsigned int argc, struct SExpression **argv)
+{
+    check_args(argc, 1);
+
+    if (argv[0]->type != TYPE_STRING)
+        syntax_error("File name expected");
+
+    if (save_image(text_get(argv[0])))
+        syntax_error("Unable to save image");
+
+    return &sexpr_true;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_pmap(unsigned int argc, struct SExpression **argv)
+{
+    struct Sequence seq;
+    struct SExpression *parts;
+    struct SExpression *res = &sexpr_nil;
+    struct SExpression *last = NULL;
+    unsigned long count;
+
+    check_args(argc, 2);
+
+    count = init_sequence(&seq, argv[0], &argv[1]);
+
+    if (count == 0)
+        return &sexpr_nil;
+
+    /* Results of parts are joined in order */
+    for (parts = pool_run(count, pmap_task, &seq); parts->type == TYPE_CONS;
+        parts = parts->right)
+    {
+        struct SExpression *part = parts->list;
+
+        if (part->type != TYPE_CONS)
+            continue;
+
+        if (last)
+            last->right = part;
+        else
+            res = part;
+
+        for (last = part; last->right->type == TYPE_CONS; last = last->right)
+            continue;
+    }
+
+    return res;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_preduce(unsigned int argc, struct SExpression **argv)
+{
+    struct Sequence seq;
+    struct SExpression *parts;
+    struct SExpression *args[2];
+    struct Block *block;
+    unsigned long count;
+
+    if (argc < 2 || argc > 3)
+        syntax_error("Invalid number of arguments");
+
+    count = init_sequence(&seq, argv[0], &argv[1]);
+
+    /* Empty sequence */
+    if (count == 0)
+        return (argc == 3) ? argv[2] : apply_function(argv[0], 0, NULL);
+
+    parts = pool_run(count, preduce_task, &seq);
+    push_value(parts);
+
+    /* Results of parts are combined like items */
+    block = begin_task(0);
+
+    if (argc == 3)
+    {
+        args[0] = argv[2];
+    }
+    else
+    {
+        args[0] = parts->list;
+        parts = parts->right;
+    }
+
+    for (; parts->type == TYPE_CONS; parts = parts->right)
+    {
+        args[1] = parts->list;
+        args[0] = apply_function(argv[0], 2, args);
+
+        /* Sequence is not needed, its place keeps combined value */
+        argv[1] = args[0];
+    }
+
+    end_task(block);
+    pop_values(1);
+
+    return args[0];
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_pfor_each(unsigned int argc, struct SExpression **argv)
+{
+    struct Sequence seq;
+    unsigned long count;
+
+    check_args(argc, 2);
+
+    count = init_sequence(&seq, argv[0], &argv[1]);
+
+    if (count > 0)
+        pool_run(count, pfor_each_task, &seq);
+
+    return &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_open_lines(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *reader;
+
+    check_args(argc, 1);
+
+    if (argv[0]->type != TYPE_STRING)
+        syntax_error("File name expected");
+
+    if ((reader = reader_open(text_get(argv[0]))) == NULL)
+        syntax_error("Unable to open file");
+
+    return reader;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_next_line(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *line;
+
+    check_args(argc, 1);
+    check_reader(argv[0]);
+
+    line = read_line(argv[0]);
+
+    return line ? line : &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_for_each_line(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *reader;
+    struct SExpression *line;
+
+    check_args(argc, 2);
+
+    /* Reader opened for file name is closed at the end */
+    reader = argv[1]->type == TYPE_STRING ? func_open_lines(1, &argv[1]) :
+        argv[1];
+    check_reader(reader);
+    push_value(reader);
+
+    while ((line = read_line(reader)) != NULL)
+    {
+        push_value(line);
+        apply_function(argv[0], 1, &line);
+        pop_values(1);
+    }
+
+    if (reader != argv[1])
+        reader_close(reader);
+
+    pop_values(1);
+
+    return &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_close_lines(unsigned int argc, struct SExpression **argv)
+{
+    check_args(argc, 1);
+    check_reader(argv[0]);
+
+    reader_close(argv[0]);
+
+    return &sexpr_true;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_sort(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *pred;
+    struct SExpression *res = &sexpr_nil;
+    struct SExpression *last = NULL;
+    struct Sequence seq;
+    unsigned long count;
+    unsigned long i;
+    int order;
+
+    if (argc < 1 || argc > 2)
+        syntax_error("Invalid number of arguments");
+
+    pred = (argc == 2) ? argv[1] : &sexpr_nil;
+    order = sort_order(pred);
+
+    if (argv[0]->type == TYPE_VECTOR)
+        return sort_vector(argv[0], pred, order);
+
+    count = init_sequence(&seq, pred, &argv[0]);
+
+    if (count == 0)
+        return &sexpr_nil;
+
+    if (order && is_integer_sequence(&seq))
+        return sort_integers(&seq, count, order);
+
+    /* Copy of sequence is sorted */
+    for (i = 0; i < count; ++i)
+    {
+        struct SExpression *item = sequence_item(&seq, i);
+        struct SExpression *cell;
+
+        /* Other items would be equal to zero */
+        if (order && !is_numeric(item))
+            syntax_error("Number expected");
+
+        push_value(item);
+        cell = make_cons(item, &sexpr_nil);
+        pop_values(1);
+
+        if (last)
+        {
+            last->right = cell;
+        }
+        else
+        {
+            /* Result must be reachable during allocation */
+            res = cell;
+            push_value(res);
+        }
+
+        last = cell;
+    }
+
+    if (order)
+        sort_list(res, count, &order_less, &order);
+    else
+        sort_list(res, count, &predicate_less, pred);
+
+    pop_values(1);
+
+    return res;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_read_csv(unsigned int argc, struct SExpression **argv)
+{
+    struct SExpression *res;
+    const char *error;
+
+    if (argc < 1 || argc > 2)
+        syntax_error("Invalid number of arguments");
+
+    if (argv[0]->type != TYPE_STRING)
+        syntax_error("File name expected");
+
+    if ((res = csv_read(text_get(argv[0]), argc == 2 &&
+        argv[1]->type != TYPE_NIL, &error)) == NULL)
+        syntax_error(error);
+
+    return res;
 }
 
 /* ************************************************************************ */
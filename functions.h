@@ -37,97 +37,239 @@
 /**
  * @brief Quit function.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return NORETURN
  */
-struct SExpression *func_quit(struct SExpression *expr);
+struct SExpression *func_quit(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
  * @brief Store variable in expression.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Stored value.
  */
-struct SExpression *func_set(struct SExpression *expr);
+struct SExpression *func_set(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
- * @brief Addition of all values in expression.
+ * @brief IF special form.
+ *
+ * @param expr S-expression.
+ *
+ * @return Selected branch for evaluation.
+ */
+struct SExpression *func_if(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief DEFUN special form. Defines user function.
+ *
+ * @param expr S-expression.
+ *
+ * @return Function name.
+ */
+struct SExpression *func_defun(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief LAMBDA special form.
  *
  * @param expr S-expression.
  *
+ * @return Function object.
+ */
+struct SExpression *func_lambda(struct SExpression *expr);
+/* ************************************************************************ */
+
+/**
+ * @brief LET special form. Variables are initialized in parallel.
+ *
+ * @param expr S-expression.
+ *
+ * @return The last body form for evaluation.
+ */
+struct SExpression *func_let(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief LET* special form. Variables are initialized sequentially.
+ *
+ * @param expr S-expression.
+ *
+ * @return The last body form for evaluation.
+ */
+struct SExpression *func_let_seq(struct SExpression *expr);
+/* ************************************************************************ */
+
+/**
+ * @brief Addition of all values in expression.
+ *
+ * Items of ranges and vectors are added like arguments.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
  * @return Result value.
  */
-struct SExpression *func_add(struct SExpression *expr);
+struct SExpression *func_add(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
  * @brief Substraction of all values in expression.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Result value.
  */
-struct SExpression *func_sub(struct SExpression *expr);
+struct SExpression *func_sub(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
  * @brief Multiplication of all values in expression.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Result value.
  */
-struct SExpression *func_mult(struct SExpression *expr);
+struct SExpression *func_mult(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
  * @brief Division of all values in expression.
  *
- * @param expr S-expression.
+ * Division of integers with remainder gives floating point number.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Result value.
  */
-struct SExpression *func_div(struct SExpression *expr);
+struct SExpression *func_div(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
  * @brief Equation of all values in expression.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Result value.
  */
-struct SExpression *func_eq(struct SExpression *expr);
+struct SExpression *func_eq(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
  * @brief Not-equation of all values in expression.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Result value.
  */
-struct SExpression *func_neq(struct SExpression *expr);
+struct SExpression *func_neq(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
- * @brief QUOTE function.
+ * @brief Converts number to floating point number: (FLOAT number).
+ *
+ * Number can be given as string, e.g. line read by NEXT-LINE.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Floating point number.
+ */
+struct SExpression *func_float(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Converts number to integer rounded toward zero: (TRUNCATE number).
+ *
+ * Number can be given as string, e.g. line read by NEXT-LINE. Number out of
+ * integer range, infinity and NaN are errors.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Integer.
+ */
+struct SExpression *func_truncate(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Evaluates body for counter from 0 to count - 1:
+ * (DOTIMES (var count [result]) body...).
+ *
+ * Counter is bound once and only its value changes between iterations.
  *
  * @param expr S-expression.
  *
- * @return Result value.
+ * @return Result form evaluated with counter equal to count or NIL.
+ */
+struct SExpression *func_dotimes(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Evaluates body while condition is not NIL: (WHILE test body...).
+ *
+ * @param expr S-expression.
+ *
+ * @return NIL
+ */
+struct SExpression *func_while(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Evaluates body until RETURN is called: (LOOP body...).
+ *
+ * @param expr S-expression.
+ *
+ * @return Value passed to RETURN.
+ */
+struct SExpression *func_loop(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Leaves the innermost DOTIMES, WHILE or LOOP with given value.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return NORETURN
+ */
+struct SExpression *func_return(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief QUOTE special form.
+ *
+ * @param expr S-expression.
+ *
+ * @return Quoted argument.
  */
 struct SExpression *func_quote(struct SExpression *expr);
 
@@ -136,77 +278,437 @@ struct SExpression *func_quote(struct SExpression *expr);
 /**
  * @brief LIST function.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Result value.
  */
-struct SExpression *func_list(struct SExpression *expr);
+struct SExpression *func_list(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
  * @brief CAR function.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Result value.
  */
-struct SExpression *func_car(struct SExpression *expr);
+struct SExpression *func_car(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
  * @brief CDR function.
  *
- * @param expr S-expression.
+ * Rest of vector shares items with the vector.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Result value.
  */
-struct SExpression *func_cdr(struct SExpression *expr);
+struct SExpression *func_cdr(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
- * @brief > function.
+ * @brief CONS function.
+ *
+ * Creates a new cons cell from item and rest of the list. Nothing is copied.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Result value.
+ */
+struct SExpression *func_cons(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief NTH function.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Item with given index or NIL.
+ */
+struct SExpression *func_nth(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief LENGTH function.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Number of list or vector items.
+ */
+struct SExpression *func_length(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates lazy sequence: (LAZY-SEQ body...).
+ *
+ * Body is evaluated when the sequence is used for the first time and its
+ * result (list, NIL or another lazy sequence) is cached.
  *
  * @param expr S-expression.
  *
+ * @return Lazy sequence.
+ */
+struct SExpression *func_lazy_seq(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns list of the first N items: (TAKE n sequence).
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return List, vector sharing items for vector.
+ */
+struct SExpression *func_take(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns sequence without the first N items: (DROP n sequence).
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Rest of sequence, it's not evaluated if it's lazy. Rest of vector
+ * shares items with the vector.
+ */
+struct SExpression *func_drop(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns integer range: (RANGE end), (RANGE start end) or
+ * (RANGE start end step).
+ *
+ * Range is stored in a single object and items are not allocated until
+ * they're needed.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Range or NIL if it's empty.
+ */
+struct SExpression *func_range(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns integer range of given length: (IOTA count [start [step]]).
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Range or NIL if it's empty.
+ */
+struct SExpression *func_iota(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief > function.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
  * @return Result value.
  */
-struct SExpression *func_gt(struct SExpression *expr);
+struct SExpression *func_gt(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
  * @brief >= function.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Result value.
  */
-struct SExpression *func_ge(struct SExpression *expr);
+struct SExpression *func_ge(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
  * @brief < function.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Result value.
  */
-struct SExpression *func_lt(struct SExpression *expr);
+struct SExpression *func_lt(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
 /**
  * @brief <= function.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
  *
  * @return Result value.
  */
-struct SExpression *func_le(struct SExpression *expr);
+struct SExpression *func_le(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Runs garbage collector.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Number of live objects.
+ */
+struct SExpression *func_gc(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns garbage collector statistics.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return List of: number of collections, live objects, heap objects,
+ *         allocated objects, freed objects, total pause and the longest
+ *         pause in microseconds.
+ */
+struct SExpression *func_gc_stats(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Set garbage collector parameters: minimum number of allocations
+ * between collections and growth in percents of live objects.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return T
+ */
+struct SExpression *func_gc_tune(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates hash table: (MAKE-HASH [size]).
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Hash table.
+ */
+struct SExpression *func_make_hash(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns value stored in hash table: (GETHASH key table [default]).
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Value or default (NIL) if key is not in table.
+ */
+struct SExpression *func_gethash(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores value into hash table: (PUTHASH key value table).
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Value.
+ */
+struct SExpression *func_puthash(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Removes key from hash table: (REMHASH key table).
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return T if key was removed, NIL if it isn't in table.
+ */
+struct SExpression *func_remhash(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns number of items in hash table: (HASH-COUNT table).
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Number of items.
+ */
+struct SExpression *func_hash_count(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Applies function to all items in worker processes:
+ * (PMAP function sequence).
+ *
+ * Sequence is a list, lazy sequence, range or vector. Function is a lambda
+ * or quoted function name. It cannot change global variables.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return List of results in order of items.
+ */
+struct SExpression *func_pmap(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Combines items by function in worker processes:
+ * (PREDUCE function sequence [initial]).
+ *
+ * Parts of sequence are combined in parallel and their results are combined
+ * in order, so function must be associative. Empty sequence gives initial
+ * value or result of function called without arguments.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Combined value.
+ */
+struct SExpression *func_preduce(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Applies function to all items in worker processes:
+ * (PFOR-EACH function sequence).
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return NIL.
+ */
+struct SExpression *func_pfor_each(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Opens file for reading by lines: (OPEN-LINES name).
+ *
+ * File is read ahead by background thread in buffers of fixed size.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Line reader.
+ */
+struct SExpression *func_open_lines(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads the next line: (NEXT-LINE reader).
+ *
+ * Line is returned as string with the text as it is, without line end.
+ * Longer lines than READER_MAX_LINE_LENGTH are errors.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Line, NIL at end of file.
+ */
+struct SExpression *func_next_line(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Calls function for each line:
+ * (FOR-EACH-LINE function name-or-reader).
+ *
+ * Reader opened for file name is closed at the end.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return NIL.
+ */
+struct SExpression *func_for_each_line(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Closes line reader: (CLOSE-LINES reader).
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return T.
+ */
+struct SExpression *func_close_lines(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Sorts sequence: (SORT sequence [predicate]).
+ *
+ * Integers in the default order or ordered by quoted < or > are sorted by
+ * radix sort, other items by stable merge sort. The default order and
+ * quoted < or > accept only numbers. List is sorted into a new list, vector
+ * is sorted in place.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Sorted sequence.
+ */
+struct SExpression *func_sort(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads numeric columns of CSV file: (READ-CSV name [header]).
+ *
+ * Each column is a vector of integers or floating point numbers. The first
+ * line is skipped when header is not NIL.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return List of column vectors.
+ */
+struct SExpression *func_read_csv(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Saves global variables and functions into image file which can be
+ * loaded by `--image` option.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return T
+ */
+struct SExpression *func_save_image(unsigned int argc, struct SExpression **argv);
 
 /* ************************************************************************ */
 
@@ -0,0 +1,508 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+/* Declaration */
+#include "gc.h"
+
+/* C library */
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+/* ************************************************************************ */
+
+/**
+ * @brief S-expression states.
+ */
+enum Mark
+{
+    /** Allocated and not marked. */
+    MARK_WHITE,
+    /** Allocated and reachable. */
+    MARK_BLACK,
+    /** In free list. */
+    MARK_FREE
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Heap page.
+ */
+struct Page
+{
+    /** Next page. */
+    struct Page *next;
+
+    /** Page objects. */
+    struct SExpression objects[GC_PAGE_SIZE];
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief List of heap pages.
+ */
+static struct Page *l_pages = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief List of free objects linked by `right` member.
+ */
+static struct SExpression *l_free = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Function for marking roots.
+ */
+static gc_roots_t l_roots = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Function for marking data outside of the heap.
+ */
+static gc_external_t l_mark_external = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Function for freeing data outside of the heap.
+ */
+static gc_external_t l_release_external = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of allocations since the last collection.
+ */
+static unsigned long l_allocations = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of allocations that starts a collection.
+ */
+static unsigned long l_threshold = GC_MIN_THRESHOLD;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Minimum number of allocations between collections.
+ */
+static unsigned long l_min_threshold = GC_MIN_THRESHOLD;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Threshold growth in percents of live objects.
+ */
+static unsigned int l_growth = GC_GROWTH;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Collector statistics.
+ */
+static struct GcStats l_stats;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stack of nested lists waiting for marking.
+ */
+static struct SExpression **l_mark_stack = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of lists waiting for marking.
+ */
+static unsigned int l_mark_count = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of allocated items in mark stack.
+ */
+static unsigned int l_mark_capacity = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Permanent objects which reference heap objects.
+ */
+static struct SExpression **l_changed = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of changed permanent objects.
+ */
+static unsigned long l_changed_count = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of allocated items in changed objects.
+ */
+static unsigned long l_changed_capacity = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks if object keeps data outside of the heap.
+ *
+ * @param expr Object.
+ *
+ * @return If object is a hash table, a line reader or a vector.
+ */
+static int is_external(const struct SExpression *expr)
+{
+    return expr->type == TYPE_HASH || expr->type == TYPE_READER ||
+        expr->type == TYPE_VECTOR || expr->type == TYPE_STRING;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds nested list into mark stack.
+ *
+ * @param expr The first list item.
+ */
+static void push_mark(struct SExpression *expr)
+{
+    /* Stack needs to be reallocated */
+    if (l_mark_count == l_mark_capacity)
+    {
+        unsigned int capacity = l_mark_capacity ? 2 * l_mark_capacity : 256;
+        struct SExpression **tmp = realloc(l_mark_stack,
+            capacity * sizeof(struct SExpression *));
+
+        if (tmp == NULL)
+        {
+            perror("Unable to allocate memory for garbage collector\n");
+            exit(EXIT_FAILURE);
+        }
+
+        l_mark_stack = tmp;
+        l_mark_capacity = capacity;
+    }
+
+    l_mark_stack[l_mark_count++] = expr;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Allocates a new heap page and adds its objects into free list.
+ */
+static void add_page(void)
+{
+    unsigned int i;
+    struct Page *page = malloc(sizeof(struct Page));
+
+    /* Unable to allocate memory */
+    if (page == NULL)
+    {
+        perror("S-expression allocation fail");
+        exit(EXIT_FAILURE);
+    }
+
+    page->next = l_pages;
+    l_pages = page;
+
+    /* Objects in reverse order so allocation goes in memory order */
+    for (i = GC_PAGE_SIZE; i-- > 0; )
+    {
+        page->objects[i].mark = MARK_FREE;
+        page->objects[i].list = NULL;
+        page->objects[i].right = l_free;
+        l_free = &page->objects[i];
+    }
+
+    l_stats.heap += GC_PAGE_SIZE;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Frees all white objects and makes black objects white.
+ */
+static void sweep(void)
+{
+    struct Page *page;
+
+    for (page = l_pages; page != NULL; page = page->next)
+    {
+        unsigned int i;
+
+        for (i = 0; i < GC_PAGE_SIZE; ++i)
+        {
+            struct SExpression *expr = &page->objects[i];
+
+            if (expr->mark == MARK_BLACK)
+            {
+                expr->mark = MARK_WHITE;
+            }
+            else if (expr->mark == MARK_WHITE)
+            {
+                if (is_external(expr) && l_release_external)
+                    l_release_external(expr);
+
+                /* Add into free list */
+                expr->mark = MARK_FREE;
+                expr->list = NULL;
+                expr->right = l_free;
+                l_free = expr;
+
+                l_stats.live--;
+                l_stats.freed++;
+
+#ifndef NDEBUG
+                sexpr_count--;
+#endif
+            }
+        }
+    }
+}
+
+/* ************************************************************************ */
+
+void gc_set_roots(gc_roots_t roots)
+{
+    l_roots = roots;
+}
+
+/* ************************************************************************ */
+
+void gc_set_external(gc_external_t mark, gc_external_t release)
+{
+    l_mark_external = mark;
+    l_release_external = release;
+}
+
+/* ************************************************************************ */
+
+void gc_set_permanent(struct SExpression *objects, unsigned long count)
+{
+    unsigned long i;
+
+    /* Marked objects are skipped by gc_mark and sweep doesn't see them */
+    for (i = 0; i < count; ++i)
+        objects[i].mark = MARK_BLACK;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *gc_alloc(void)
+{
+    struct SExpression *expr;
+
+    /* Time for collection */
+    if (l_allocations >= l_threshold)
+        gc_collect();
+
+    /* No free objects */
+    if (l_free == NULL)
+        add_page();
+
+    expr = l_free;
+    l_free = expr->right;
+
+    assert(expr->mark == MARK_FREE);
+    expr->mark = MARK_WHITE;
+
+    l_allocations++;
+    l_stats.allocated++;
+    l_stats.live++;
+
+    return expr;
+}
+
+/* ************************************************************************ */
+
+void gc_mark(struct SExpression *expr)
+{
+    /* Following expressions are marked in loop, nested lists are stored
+     * on explicit stack so deep structures don't overflow C stack */
+    while (1)
+    {
+        while (expr != NULL && expr->mark == MARK_WHITE)
+        {
+            expr->mark = MARK_BLACK;
+
+            /* Data outside of the heap */
+            if (is_external(expr) && l_mark_external)
+                l_mark_external(expr);
+
+            if (expr->list && expr->list->mark == MARK_WHITE)
+                push_mark(expr->list);
+
+            expr = expr->right;
+        }
+
+        if (l_mark_count == 0)
+            break;
+
+        expr = l_mark_stack[--l_mark_count];
+    }
+}
+
+/* ************************************************************************ */
+
+void gc_changed(struct SExpression *expr)
+{
+    assert(expr);
+
+    /* Heap objects are white between collections */
+    if (expr->mark != MARK_BLACK)
+        return;
+
+    if (l_changed_count == l_changed_capacity)
+    {
+        unsigned long capacity = l_changed_capacity ? 2 * l_changed_capacity : 16;
+        struct SExpression **tmp = realloc(l_changed,
+            capacity * sizeof(struct SExpression *));
+
+        if (tmp == NULL)
+        {
+            perror("Unable to allocate memory for garbage collector\n");
+            exit(EXIT_FAILURE);
+        }
+
+        l_changed = tmp;
+        l_changed_capacity = capacity;
+    }
+
+    l_changed[l_changed_count++] = expr;
+}
+
+/* ************************************************************************ */
+
+void gc_collect(void)
+{
+    clock_t start = clock();
+    double pause;
+    unsigned long i;
+
+    /* Mark all reachable objects */
+    if (l_roots)
+        l_roots();
+
+    /* Permanent objects themselves are skipped by gc_mark */
+    for (i = 0; i < l_changed_count; ++i)
+    {
+        gc_mark(l_changed[i]->list);
+        gc_mark(l_changed[i]->right);
+
+        if (is_external(l_changed[i]) && l_mark_external)
+            l_mark_external(l_changed[i]);
+    }
+
+    sweep();
+
+    /* Next collection */
+    l_allocations = 0;
+    l_threshold = l_stats.live / 100 * l_growth;
+
+    if (l_threshold < l_min_threshold)
+        l_threshold = l_min_threshold;
+
+    /* Statistics */
+    pause = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    l_stats.collections++;
+    l_stats.pause_total += pause;
+
+    if (pause > l_stats.pause_max)
+        l_stats.pause_max = pause;
+}
+
+/* ************************************************************************ */
+
+void gc_configure(unsigned long threshold, unsigned int growth)
+{
+    l_min_threshold = threshold;
+    l_growth = growth;
+    l_threshold = threshold;
+}
+
+/* ************************************************************************ */
+
+const struct GcStats *gc_stats(void)
+{
+    return &l_stats;
+}
+
+/* ************************************************************************ */
+
+void gc_free_all(void)
+{
+    while (l_pages)
+    {
+        struct Page *page = l_pages;
+        unsigned int i;
+
+        for (i = 0; i < GC_PAGE_SIZE; ++i)
+        {
+            if (page->objects[i].mark != MARK_FREE &&
+                is_external(&page->objects[i]) && l_release_external)
+                l_release_external(&page->objects[i]);
+        }
+
+        l_pages = page->next;
+        free(page);
+    }
+
+#ifndef NDEBUG
+    sexpr_count -= l_stats.live;
+#endif
+
+    if (l_mark_stack)
+        free(l_mark_stack);
+
+    if (l_changed)
+        free(l_changed);
+
+    l_changed = NULL;
+    l_changed_count = 0;
+    l_changed_capacity = 0;
+
+    l_mark_stack = NULL;
+    l_mark_count = 0;
+    l_mark_capacity = 0;
+
+    l_free = NULL;
+    l_stats.live = 0;
+    l_stats.heap = 0;
+}
+
+/* ************************************************************************ */
@@ -0,0 +1,221 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+#ifndef GC_H_
+#define GC_H_
+
+/* ************************************************************************ */
+
+/* LISP */
+#include "desc.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of S-expressions allocated in one heap page.
+ */
+#ifndef GC_PAGE_SIZE
+#define GC_PAGE_SIZE 4096
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Minimum number of allocations between two collections.
+ */
+#ifndef GC_MIN_THRESHOLD
+#define GC_MIN_THRESHOLD 65536
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of allocations between two collections in percents of live
+ * objects after the last collection.
+ */
+#ifndef GC_GROWTH
+#define GC_GROWTH 100
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Garbage collector statistics.
+ */
+struct GcStats
+{
+    /** Number of collections. */
+    unsigned long collections;
+
+    /** Number of live objects. */
+    unsigned long live;
+
+    /** Number of objects in heap pages. */
+    unsigned long heap;
+
+    /** Total number of allocated objects. */
+    unsigned long allocated;
+
+    /** Total number of freed objects. */
+    unsigned long freed;
+
+    /** Total time spent in collections (in seconds). */
+    double pause_total;
+
+    /** The longest collection (in seconds). */
+    double pause_max;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Function pointer type for marking roots.
+ *
+ * Function must call `gc_mark` for all S-expressions referenced outside
+ * of the heap.
+ */
+typedef void (*gc_roots_t)(void);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Function pointer type for objects with data outside of the heap.
+ *
+ * @param expr Object.
+ */
+typedef void (*gc_external_t)(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Set function for marking roots.
+ *
+ * @param roots Function pointer.
+ */
+void gc_set_roots(gc_roots_t roots);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Set functions for hash tables, line readers and vectors which keep
+ * data outside of the heap.
+ *
+ * @param mark    Function that calls `gc_mark` for objects referenced from
+ *                the data.
+ * @param release Function that frees the data of collected object.
+ */
+void gc_set_external(gc_external_t mark, gc_external_t release);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Marks objects allocated outside of the heap as permanent.
+ *
+ * Permanent objects are never collected and they are not traversed during
+ * marking so they must not reference heap objects.
+ *
+ * @param objects Array of objects.
+ * @param count   Number of objects.
+ */
+void gc_set_permanent(struct SExpression *objects, unsigned long count);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Records that object references different objects.
+ *
+ * Objects referenced from a changed permanent object, including data of
+ * hash tables, are marked in every collection. Objects in the heap are not
+ * recorded and every permanent object must be recorded only once.
+ *
+ * @param expr Changed object.
+ */
+void gc_changed(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Allocates memory for a new S-expression.
+ *
+ * Allocation can start a collection so all used S-expressions must be
+ * reachable from roots.
+ *
+ * Function never returns NULL pointer. If memory cannot be allocated, it
+ * prints error to stderr and exit application with EXIT_FAILURE code.
+ *
+ * @return Not initialized S-expression.
+ */
+struct SExpression *gc_alloc(void);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Marks S-expression and all reachable S-expressions as used.
+ *
+ * @param expr S-expression. Can be NULL.
+ */
+void gc_mark(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Frees all S-expressions that are not reachable from roots.
+ */
+void gc_collect(void);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Set collector parameters.
+ *
+ * @param threshold Minimum number of allocations between two collections.
+ * @param growth    Number of allocations between two collections in percents
+ *                  of live objects.
+ */
+void gc_configure(unsigned long threshold, unsigned int growth);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns collector statistics.
+ *
+ * @return A pointer to statistics.
+ */
+const struct GcStats *gc_stats(void);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Frees whole heap.
+ */
+void gc_free_all(void);
+
+/* ************************************************************************ */
+
+#endif /* GC_H_ */
+
+/* ************************************************************************ */
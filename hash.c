@@ -0,0 +1,624 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+/* Declaration */
+#include "hash.h"
+
+/* C library */
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* LISP */
+#include "gc.h"
+#include "text.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Tag of slot that was never used.
+ */
+#define TAG_EMPTY 0
+
+/* ************************************************************************ */
+
+/**
+ * @brief Tag of slot with removed item, probing continues over it.
+ */
+#define TAG_DELETED 1
+
+/* ************************************************************************ */
+
+/**
+ * @brief Tag bit of used slot, the other bits are taken from hash.
+ */
+#define TAG_FULL 0x80
+
+/* ************************************************************************ */
+
+/**
+ * @brief Table item.
+ */
+struct Entry
+{
+    /** Key. */
+    struct SExpression *key;
+
+    /** Value. */
+    struct SExpression *value;
+
+    /** Hash of key. */
+    unsigned long hash;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Open addressing table with linear probing.
+ *
+ * Tags are stored separately from items so probing reads consecutive bytes
+ * and items are compared only when tag matches.
+ */
+struct Table
+{
+    /** Slot tags. */
+    unsigned char *tags;
+
+    /** Slot items. */
+    struct Entry *entries;
+
+    /** Number of slots (power of 2) or 0. */
+    unsigned long capacity;
+
+    /** Number of used and deleted slots. */
+    unsigned long used;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Hash table data.
+ */
+struct HashTable
+{
+    /** Table for new items. */
+    struct Table current;
+
+    /** Previous table whose items are being moved into current table. */
+    struct Table old;
+
+    /** The next slot of previous table to move. */
+    unsigned long position;
+
+    /** Number of items. */
+    unsigned long count;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns hash table data of object.
+ *
+ * @param table Hash table object.
+ *
+ * @return Data.
+ */
+static struct HashTable *get_data(const struct SExpression *table)
+{
+    struct HashTable *data;
+
+    assert(table->type == TYPE_HASH);
+
+    memcpy(&data, table->lvalue, sizeof(data));
+
+    return data;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks if object is an integer (T is stored as value too).
+ *
+ * @param expr Object.
+ *
+ * @return If object is an integer.
+ */
+static int is_integer(const struct SExpression *expr)
+{
+    return expr->type == TYPE_VALUE && expr != &sexpr_true;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds bytes into FNV-1a hash.
+ *
+ * @param hash Hash.
+ * @param data Bytes.
+ * @param size Number of bytes.
+ *
+ * @return Hash.
+ */
+static unsigned long add_bytes(unsigned long hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+
+    while (size-- > 0)
+    {
+        hash ^= *bytes++;
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Computes hash of key.
+ *
+ * @param key Key.
+ *
+ * @return Hash.
+ */
+static unsigned long hash_key(const struct SExpression *key)
+{
+    unsigned long hash = 2166136261UL;
+
+    if (is_integer(key))
+    {
+        hash = add_bytes(hash, key->lvalue, sizeof(long));
+    }
+    else if (key->type == TYPE_FLOAT)
+    {
+        hash = add_bytes(hash, key->lvalue, sizeof(double));
+    }
+    else if (key->type == TYPE_STRING)
+    {
+        hash = add_bytes(hash, text_get(key), strlen(text_get(key)));
+    }
+    else if (key->type == TYPE_QUOTED || key->type == TYPE_SYMBOL)
+    {
+        hash = add_bytes(hash, key->lvalue, strlen(key->lvalue));
+    }
+    else
+    {
+        hash = add_bytes(hash, &key, sizeof(key));
+    }
+
+    /* Upper bits are used by tags */
+    return hash ^ (hash >> 15);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Compares keys.
+ *
+ * @param first  The first key.
+ * @param second The second key.
+ *
+ * @return If keys are equal.
+ */
+static int equal_keys(const struct SExpression *first,
+    const struct SExpression *second)
+{
+    if (first == second)
+        return 1;
+
+    if (is_integer(first) && is_integer(second))
+        return !memcmp(first->lvalue, second->lvalue, sizeof(long));
+
+    if (first->type != second->type)
+        return 0;
+
+    if (first->type == TYPE_FLOAT)
+        return !memcmp(first->lvalue, second->lvalue, sizeof(double));
+
+    if (first->type == TYPE_STRING)
+        return !strcmp(text_get(first), text_get(second));
+
+    if (first->type == TYPE_QUOTED || first->type == TYPE_SYMBOL)
+        return !strcmp(first->lvalue, second->lvalue);
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns slot tag for hash.
+ *
+ * @param hash Hash.
+ *
+ * @return Tag.
+ */
+static unsigned char make_tag(unsigned long hash)
+{
+    return (unsigned char) (TAG_FULL | ((hash >> 24) & 0x7F));
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Allocates table slots.
+ *
+ * @param table    Table.
+ * @param capacity Number of slots (power of 2).
+ */
+static void alloc_table(struct Table *table, unsigned long capacity)
+{
+    table->tags = calloc(capacity, 1);
+    table->entries = malloc(capacity * sizeof(struct Entry));
+
+    if (table->tags == NULL || table->entries == NULL)
+    {
+        perror("Unable to allocate memory for hash table");
+        exit(EXIT_FAILURE);
+    }
+
+    table->capacity = capacity;
+    table->used = 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Frees table slots.
+ *
+ * @param table Table.
+ */
+static void free_table(struct Table *table)
+{
+    free(table->tags);
+    free(table->entries);
+
+    table->tags = NULL;
+    table->entries = NULL;
+    table->capacity = 0;
+    table->used = 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Finds slot of the key.
+ *
+ * @param table Table.
+ * @param key   Key.
+ * @param hash  Hash of key.
+ *
+ * @return Slot index or table capacity if key is not in table.
+ */
+static unsigned long find_slot(const struct Table *table,
+    const struct SExpression *key, unsigned long hash)
+{
+    unsigned char tag = make_tag(hash);
+    unsigned long mask = table->capacity - 1;
+    unsigned long i;
+
+    if (table->capacity == 0)
+        return table->capacity;
+
+    /* Table always contains empty slots */
+    for (i = hash & mask; table->tags[i] != TAG_EMPTY; i = (i + 1) & mask)
+    {
+        if (table->tags[i] == tag && table->entries[i].hash == hash &&
+            equal_keys(table->entries[i].key, key))
+            return i;
+    }
+
+    return table->capacity;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores item which is not in table.
+ *
+ * @param table Table.
+ * @param entry Item.
+ */
+static void insert(struct Table *table, const struct Entry *entry)
+{
+    unsigned long mask = table->capacity - 1;
+    unsigned long i;
+
+    /* Deleted slots are reused */
+    for (i = entry->hash & mask; table->tags[i] & TAG_FULL; i = (i + 1) & mask)
+        ;
+
+    if (table->tags[i] == TAG_EMPTY)
+        table->used++;
+
+    table->tags[i] = make_tag(entry->hash);
+    table->entries[i] = *entry;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Moves items from previous table into current table.
+ *
+ * @param data  Hash table data.
+ * @param count Maximum number of visited slots.
+ */
+static void migrate(struct HashTable *data, unsigned long count)
+{
+    struct Table *old = &data->old;
+
+    for (; count > 0 && data->position < old->capacity; --count)
+    {
+        unsigned long i = data->position++;
+
+        if (old->tags[i] & TAG_FULL)
+        {
+            insert(&data->current, &old->entries[i]);
+            old->tags[i] = TAG_DELETED;
+        }
+    }
+
+    /* All items are moved */
+    if (old->capacity && data->position == old->capacity)
+        free_table(old);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns number of slots for given number of items.
+ *
+ * @param size Number of items.
+ *
+ * @return Number of slots (power of 2), table is at most half full.
+ */
+static unsigned long get_capacity(unsigned long size)
+{
+    unsigned long capacity = HASH_MIN_CAPACITY;
+
+    while (capacity < 2 * size)
+        capacity *= 2;
+
+    return capacity;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Starts moving items into a new table.
+ *
+ * New table has space for items and for all operations done before the
+ * previous table is moved, so it doesn't fill up during moving.
+ *
+ * @param data Hash table data.
+ */
+static void resize(struct HashTable *data)
+{
+    unsigned long size = data->count +
+        data->current.capacity / HASH_MIGRATE_STEP + 1;
+
+    /* Previous resize must be finished */
+    migrate(data, ULONG_MAX);
+
+    data->old = data->current;
+    data->position = 0;
+    alloc_table(&data->current, get_capacity(size));
+}
+
+/* ************************************************************************ */
+
+struct SExpression *hash_create(unsigned long size)
+{
+    struct SExpression *table = alloc_sexpr(TYPE_HASH);
+
+    hash_init(table, size);
+
+    return table;
+}
+
+/* ************************************************************************ */
+
+void hash_init(struct SExpression *table, unsigned long size)
+{
+    struct HashTable *data = calloc(1, sizeof(struct HashTable));
+
+    if (data == NULL)
+    {
+        perror("Unable to allocate memory for hash table");
+        exit(EXIT_FAILURE);
+    }
+
+    alloc_table(&data->current, get_capacity(size));
+
+    /* Pointer is stored in place of value text */
+    table->type = TYPE_HASH;
+    memcpy(table->lvalue, &data, sizeof(data));
+}
+
+/* ************************************************************************ */
+
+struct SExpression *hash_get(struct SExpression *table,
+    const struct SExpression *key)
+{
+    struct HashTable *data = get_data(table);
+    unsigned long hash = hash_key(key);
+    unsigned long i;
+
+    migrate(data, HASH_MIGRATE_STEP);
+
+    i = find_slot(&data->current, key, hash);
+
+    if (i < data->current.capacity)
+        return data->current.entries[i].value;
+
+    i = find_slot(&data->old, key, hash);
+
+    if (i < data->old.capacity)
+        return data->old.entries[i].value;
+
+    return NULL;
+}
+
+/* ************************************************************************ */
+
+void hash_put(struct SExpression *table, struct SExpression *key,
+    struct SExpression *value)
+{
+    struct HashTable *data = get_data(table);
+    struct Entry entry;
+    unsigned long i;
+
+    entry.key = key;
+    entry.value = value;
+    entry.hash = hash_key(key);
+
+    migrate(data, HASH_MIGRATE_STEP);
+
+    i = find_slot(&data->current, key, entry.hash);
+
+    if (i < data->current.capacity)
+    {
+        data->current.entries[i].value = value;
+        return;
+    }
+
+    /* Item from previous table is moved */
+    i = find_slot(&data->old, key, entry.hash);
+
+    if (i < data->old.capacity)
+        data->old.tags[i] = TAG_DELETED;
+    else
+        data->count++;
+
+    /* Table is kept at most 7/8 full including deleted slots */
+    if (8 * (data->current.used + 1) > 7 * data->current.capacity)
+        resize(data);
+
+    insert(&data->current, &entry);
+}
+
+/* ************************************************************************ */
+
+int hash_remove(struct SExpression *table, const struct SExpression *key)
+{
+    struct HashTable *data = get_data(table);
+    unsigned long hash = hash_key(key);
+    unsigned long i;
+
+    migrate(data, HASH_MIGRATE_STEP);
+
+    i = find_slot(&data->current, key, hash);
+
+    if (i < data->current.capacity)
+    {
+        data->current.tags[i] = TAG_DELETED;
+        data->count--;
+        return 1;
+    }
+
+    i = find_slot(&data->old, key, hash);
+
+    if (i < data->old.capacity)
+    {
+        data->old.tags[i] = TAG_DELETED;
+        data->count--;
+        return 1;
+    }
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+unsigned long hash_count(const struct SExpression *table)
+{
+    return get_data(table)->count;
+}
+
+/* ************************************************************************ */
+
+void hash_for_each(const struct SExpression *table, hash_item_t func,
+    void *data)
+{
+    struct HashTable *hash = get_data(table);
+    const struct Table *tables[2];
+    unsigned int t;
+
+    tables[0] = &hash->current;
+    tables[1] = &hash->old;
+
+    for (t = 0; t < 2; ++t)
+    {
+        unsigned long i;
+
+        for (i = 0; i < tables[t]->capacity; ++i)
+        {
+            if (tables[t]->tags[i] & TAG_FULL)
+                func(tables[t]->entries[i].key, tables[t]->entries[i].value, data);
+        }
+    }
+}
+
+/* ************************************************************************ */
+
+void hash_mark(struct SExpression *table)
+{
+    struct HashTable *data = get_data(table);
+    const struct Table *tables[2];
+    unsigned int t;
+
+    tables[0] = &data->current;
+    tables[1] = &data->old;
+
+    for (t = 0; t < 2; ++t)
+    {
+        unsigned long i;
+
+        for (i = 0; i < tables[t]->capacity; ++i)
+        {
+            if (tables[t]->tags[i] & TAG_FULL)
+            {
+                gc_mark(tables[t]->entries[i].key);
+                gc_mark(tables[t]->entries[i].value);
+            }
+        }
+    }
+}
+
+/* ************************************************************************ */
+
+void hash_release(struct SExpression *table)
+{
+    struct HashTable *data = get_data(table);
+
+    free_table(&data->current);
+    free_table(&data->old);
+    free(data);
+}
+
+/* ************************************************************************ */
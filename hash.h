@@ -0,0 +1,183 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+#ifndef HASH_H_
+#define HASH_H_
+
+/* ************************************************************************ */
+
+/* LISP */
+#include "desc.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief The smallest number of slots of hash table.
+ */
+#ifndef HASH_MIN_CAPACITY
+#define HASH_MIN_CAPACITY 16
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of slots moved from the previous table by each operation
+ * during resizing.
+ */
+#ifndef HASH_MIGRATE_STEP
+#define HASH_MIGRATE_STEP 32
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Function called for table items.
+ *
+ * @param key   Key.
+ * @param value Value.
+ * @param data  User data.
+ */
+typedef void (*hash_item_t)(struct SExpression *key, struct SExpression *value,
+    void *data);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates a new hash table.
+ *
+ * Table data are stored outside of the heap and they are released by
+ * garbage collector (see gc_set_external).
+ *
+ * @param size Expected number of items, it can be 0.
+ *
+ * @return Hash table object.
+ */
+struct SExpression *hash_create(unsigned long size);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Turns existing object into an empty hash table.
+ *
+ * It's used for objects loaded from image, the object must not be
+ * released by garbage collector before.
+ *
+ * @param table Object.
+ * @param size  Expected number of items, it can be 0.
+ */
+void hash_init(struct SExpression *table, unsigned long size);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Finds value stored for the key.
+ *
+ * Numbers, strings and symbols are compared by value, other objects by
+ * identity.
+ *
+ * @param table Hash table.
+ * @param key   Key.
+ *
+ * @return Value or NULL if key is not in table.
+ */
+struct SExpression *hash_get(struct SExpression *table,
+    const struct SExpression *key);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores value for the key.
+ *
+ * Table grows incrementally, items are moved into the bigger table by the
+ * following operations.
+ *
+ * @param table Hash table.
+ * @param key   Key.
+ * @param value Value.
+ */
+void hash_put(struct SExpression *table, struct SExpression *key,
+    struct SExpression *value);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Removes the key from table.
+ *
+ * @param table Hash table.
+ * @param key   Key.
+ *
+ * @return 1 if key was removed, 0 if key is not in table.
+ */
+int hash_remove(struct SExpression *table, const struct SExpression *key);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns number of items in table.
+ *
+ * @param table Hash table.
+ *
+ * @return Number of items.
+ */
+unsigned long hash_count(const struct SExpression *table);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Calls function for all items of table, the table must not be
+ * changed by the function.
+ *
+ * @param table Hash table.
+ * @param func  Function.
+ * @param data  Data passed to function.
+ */
+void hash_for_each(const struct SExpression *table, hash_item_t func,
+    void *data);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Marks keys and values of table for garbage collector.
+ *
+ * @param table Hash table.
+ */
+void hash_mark(struct SExpression *table);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Frees table data, it's called by garbage collector.
+ *
+ * @param table Hash table.
+ */
+void hash_release(struct SExpression *table);
+
+/* ************************************************************************ */
+
+#endif /* HASH_H_ */
+
+/* ************************************************************************ */
@@ -0,0 +1,1508 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+/* Feature test macros */
+#define _DEFAULT_SOURCE
+
+/* Declaration */
+#include "image.h"
+
+/* C library */
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* LISP */
+#include "desc.h"
+#include "interpret.h"
+#include "gc.h"
+#include "hash.h"
+#include "text.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Heap image file identification.
+ */
+#define IMAGE_MAGIC "LISPIMG"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Compiled source file identification.
+ */
+#define CACHE_MAGIC "LISPCCH"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Serialized object identification.
+ */
+#define OBJECT_MAGIC "LISPOBJ"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum length of stored variable or function name.
+ */
+#define IMAGE_NAME_LENGTH 16
+
+/* ************************************************************************ */
+
+/**
+ * @brief Encoded pointers. Object indices are stored after them.
+ */
+enum ImageRef
+{
+    IMAGE_NULL,
+    IMAGE_NIL,
+    IMAGE_TRUE,
+    IMAGE_OBJECTS
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Image file header. It's followed by objects, entries, forms and
+ * text of source lines and strings.
+ */
+struct ImageHeader
+{
+    /** Image identification. */
+    char magic[8];
+
+    /** Image format version. */
+    unsigned int version;
+
+    /** Size of stored S-expression. */
+    unsigned int object_size;
+
+    /** Number of objects. */
+    unsigned long object_count;
+
+    /** Number of global variables. */
+    unsigned long variable_count;
+
+    /** Number of user functions. */
+    unsigned long function_count;
+
+    /** Number of top-level expressions. */
+    unsigned long form_count;
+
+    /** Size of source lines and strings text. */
+    unsigned long text_size;
+
+    /** Hash of source file content. */
+    unsigned long source_hash;
+
+    /** Size of source file. */
+    unsigned long source_size;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Global variable or function stored in image.
+ */
+struct ImageEntry
+{
+    /** Name. */
+    char name[IMAGE_NAME_LENGTH];
+
+    /** Encoded value. */
+    unsigned long value;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Top-level expression stored in compiled source file.
+ */
+struct ImageForm
+{
+    /** Encoded expression. */
+    unsigned long value;
+
+    /** Offset of source line in text. */
+    unsigned long line;
+
+    /** Number of source line. */
+    unsigned long number;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Object index in hash table.
+ */
+struct ImageSlot
+{
+    /** Object pointer. */
+    const struct SExpression *expr;
+
+    /** Object index. */
+    unsigned long index;
+
+    /** Batch of the object, slots from other batches are empty. */
+    unsigned long batch;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Image which is being written.
+ *
+ * Objects are added in batches. When batch is finished, objects are encoded
+ * and the hash table is cleared so objects of the batch can be released.
+ */
+struct ImageWriter
+{
+    /** Objects of current batch. */
+    const struct SExpression **objects;
+
+    /** Number of objects in current batch. */
+    unsigned long count;
+
+    /** Number of allocated objects. */
+    unsigned long capacity;
+
+    /** Index of the first object in current batch. */
+    unsigned long base;
+
+    /** Current batch. */
+    unsigned long batch;
+
+    /** Hash table of objects in current batch. */
+    struct ImageSlot *slots;
+
+    /** Size of hash table (power of 2). */
+    unsigned long slot_count;
+
+    /** Encoded objects of finished batches. */
+    struct SExpression *data;
+
+    /** Number of allocated encoded objects. */
+    unsigned long data_capacity;
+
+    /** Stored variables and functions. */
+    struct ImageEntry *entries;
+
+    /** Number of stored entries. */
+    unsigned long entry_count;
+
+    /** Number of allocated entries. */
+    unsigned long entry_capacity;
+
+    /** Stored top-level expressions. */
+    struct ImageForm *forms;
+
+    /** Number of stored expressions. */
+    unsigned long form_count;
+
+    /** Number of allocated expressions. */
+    unsigned long form_capacity;
+
+    /** Source lines and strings. */
+    char *text;
+
+    /** Size of source lines and strings. */
+    unsigned long text_size;
+
+    /** Allocated size for source lines and strings. */
+    unsigned long text_capacity;
+
+    /** Stored copies of hash tables with their items. */
+    struct SExpression **tables;
+
+    /** Number of stored copies of hash tables. */
+    unsigned long table_count;
+
+    /** Number of allocated copies of hash tables. */
+    unsigned long table_capacity;
+
+    /** Allocation failed. */
+    int failed;
+
+    /** Name of object type which cannot be stored, NULL if all can be. */
+    const char *unsupported;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reallocates array when it's full.
+ *
+ * @param writer   Image writer, failure is stored there.
+ * @param array    Array.
+ * @param count    Number of required items.
+ * @param capacity Number of allocated items.
+ * @param size     Item size.
+ *
+ * @return If array has enough space.
+ */
+static int grow(struct ImageWriter *writer, void *array, unsigned long count,
+    unsigned long *capacity, size_t size)
+{
+    void **parray = array;
+    unsigned long new_capacity = *capacity ? *capacity : 64;
+    void *tmp;
+
+    if (writer->failed)
+        return 0;
+
+    if (count <= *capacity)
+        return 1;
+
+    while (new_capacity < count)
+        new_capacity *= 2;
+
+    tmp = realloc(*parray, new_capacity * size);
+
+    if (tmp == NULL)
+    {
+        writer->failed = 1;
+        return 0;
+    }
+
+    *parray = tmp;
+    *capacity = new_capacity;
+
+    return 1;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Finds hash table slot of object.
+ *
+ * @param writer Image writer.
+ * @param expr   Object.
+ *
+ * @return Slot with the object or empty slot.
+ */
+static struct ImageSlot *find_slot(struct ImageWriter *writer,
+    const struct SExpression *expr)
+{
+    unsigned long mask = writer->slot_count - 1;
+    unsigned long i = ((unsigned long) expr >> 4) * 2654435761UL & mask;
+
+    while (writer->slots[i].batch == writer->batch && writer->slots[i].expr != expr)
+        i = (i + 1) & mask;
+
+    return &writer->slots[i];
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Appends key and value as two list items.
+ *
+ * @param key   Key.
+ * @param value Value.
+ * @param data  Position of the next list item.
+ */
+static void add_item(struct SExpression *key, struct SExpression *value,
+    void *data)
+{
+    struct SExpression **pos = data;
+
+    (*pos)->list = key;
+    (*pos)->right = *pos + 1;
+    ++*pos;
+
+    (*pos)->list = value;
+    (*pos)->right = *pos + 1;
+    ++*pos;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Copies hash table without its data.
+ *
+ * Items are stored in list of the copy as keys followed by values, the list
+ * is owned by writer.
+ *
+ * @param writer Image writer.
+ * @param table  Hash table.
+ *
+ * @return Copy or NULL.
+ */
+static struct SExpression *copy_table(struct ImageWriter *writer,
+    const struct SExpression *table)
+{
+    unsigned long count = 2 * hash_count(table);
+    struct SExpression *copy;
+    struct SExpression *pos;
+    unsigned long i;
+
+    if (!grow(writer, &writer->tables, writer->table_count + 1,
+            &writer->table_capacity, sizeof(struct SExpression *)))
+        return NULL;
+
+    if ((copy = calloc(count + 1, sizeof(struct SExpression))) == NULL)
+    {
+        writer->failed = 1;
+        return NULL;
+    }
+
+    writer->tables[writer->table_count++] = copy;
+
+    copy->type = TYPE_HASH;
+    copy->list = count ? copy + 1 : NULL;
+
+    for (i = 1; i <= count; ++i)
+        copy[i].type = TYPE_CONS;
+
+    pos = copy + 1;
+    hash_for_each(table, add_item, &pos);
+
+    if (count)
+        copy[count].right = &sexpr_nil;
+
+    return copy;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds object into image if it isn't stored yet.
+ *
+ * Hash table is stored as a copy with its items.
+ *
+ * @param writer Image writer.
+ * @param expr   Object.
+ */
+static void add_object(struct ImageWriter *writer, const struct SExpression *expr)
+{
+    const struct SExpression *stored = expr;
+    struct ImageSlot *slot;
+
+    if (expr == NULL || expr == &sexpr_nil || expr == &sexpr_true)
+        return;
+
+    /* Line reader and vector data are outside of the heap */
+    if (expr->type == TYPE_READER || expr->type == TYPE_VECTOR)
+    {
+        writer->unsupported = expr->type == TYPE_READER ? "Line readers" :
+            "Vectors";
+        return;
+    }
+
+    /* Hash table is kept at most half full */
+    if (2 * (writer->count + 1) > writer->slot_count)
+    {
+        struct ImageSlot *old = writer->slots;
+        unsigned long old_count = writer->slot_count;
+        unsigned long i;
+
+        writer->slot_count = old_count ? 2 * old_count : 1024;
+        writer->slots = calloc(writer->slot_count, sizeof(struct ImageSlot));
+
+        if (writer->slots == NULL)
+        {
+            writer->slots = old;
+            writer->slot_count = old_count;
+            writer->failed = 1;
+            return;
+        }
+
+        for (i = 0; i < old_count; ++i)
+        {
+            if (old[i].batch == writer->batch)
+                *find_slot(writer, old[i].expr) = old[i];
+        }
+
+        free(old);
+    }
+
+    slot = find_slot(writer, expr);
+
+    if (slot->batch == writer->batch)
+        return;
+
+    if (!grow(writer, &writer->objects, writer->count + 1, &writer->capacity,
+            sizeof(struct SExpression *)))
+        return;
+
+    if (expr->type == TYPE_HASH && (stored = copy_table(writer, expr)) == NULL)
+        return;
+
+    slot->expr = expr;
+    slot->index = writer->base + writer->count;
+    slot->batch = writer->batch;
+    writer->objects[writer->count++] = stored;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds object and all objects reachable from it.
+ *
+ * @param writer Image writer.
+ * @param expr   Object.
+ */
+static void add_objects(struct ImageWriter *writer, const struct SExpression *expr)
+{
+    /* Objects array is used as queue of objects to visit */
+    unsigned long i = writer->count;
+
+    add_object(writer, expr);
+
+    for (; i < writer->count; ++i)
+    {
+        add_object(writer, writer->objects[i]->right);
+        add_object(writer, writer->objects[i]->list);
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Encodes pointer as object index.
+ *
+ * @param writer Image writer.
+ * @param expr   Object of current batch.
+ *
+ * @return Encoded pointer.
+ */
+static unsigned long encode(struct ImageWriter *writer, const struct SExpression *expr)
+{
+    if (expr == NULL)
+        return IMAGE_NULL;
+
+    if (expr == &sexpr_nil)
+        return IMAGE_NIL;
+
+    if (expr == &sexpr_true)
+        return IMAGE_TRUE;
+
+    return IMAGE_OBJECTS + find_slot(writer, expr)->index;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores string text and replaces pointer by its offset.
+ *
+ * @param writer Image writer.
+ * @param expr   Encoded string.
+ */
+static void encode_text(struct ImageWriter *writer, struct SExpression *expr)
+{
+    const char *text = text_get(expr);
+    unsigned long size = strlen(text) + 1;
+    unsigned long offset = writer->text_size;
+
+    if (!grow(writer, &writer->text, writer->text_size + size,
+            &writer->text_capacity, 1))
+        return;
+
+    memcpy(writer->text + offset, text, size);
+    writer->text_size += size;
+
+    memcpy(expr->lvalue, &offset, sizeof(offset));
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Encodes objects of current batch and starts a new batch.
+ *
+ * String texts are stored with source lines.
+ *
+ * @param writer Image writer.
+ */
+static void finish_batch(struct ImageWriter *writer)
+{
+    unsigned long i;
+
+    if (!grow(writer, &writer->data, writer->base + writer->count,
+            &writer->data_capacity, sizeof(struct SExpression)))
+        return;
+
+    /* Objects with pointers replaced by indices */
+    for (i = 0; i < writer->count; ++i)
+    {
+        struct SExpression *expr = &writer->data[writer->base + i];
+
+        *expr = *writer->objects[i];
+        expr->right = (struct SExpression *) encode(writer, expr->right);
+        expr->list = (struct SExpression *) encode(writer, expr->list);
+        expr->mark = 0;
+
+        /* Inline caches and JIT counters are valid only in this process */
+        if (expr->type == TYPE_SYMBOL)
+        {
+            expr->depth = 0;
+            expr->slot = 0;
+        }
+        else if (expr->type == TYPE_STRING)
+        {
+            encode_text(writer, expr);
+        }
+    }
+
+    writer->base += writer->count;
+    writer->count = 0;
+    writer->batch++;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores variable or function and all objects reachable from it.
+ *
+ * @param name  Name.
+ * @param value Value.
+ * @param data  Image writer.
+ */
+static void add_entry(const char *name, struct SExpression *value, void *data)
+{
+    struct ImageWriter *writer = data;
+    struct ImageEntry *entry;
+
+    if (!grow(writer, &writer->entries, writer->entry_count + 1,
+            &writer->entry_capacity, sizeof(struct ImageEntry)))
+        return;
+
+    entry = &writer->entries[writer->entry_count++];
+    memset(entry, 0, sizeof(struct ImageEntry));
+    strncpy(entry->name, name, IMAGE_NAME_LENGTH - 1);
+
+    /* Value is encoded when all objects are collected */
+    entry->value = (unsigned long) value;
+
+    add_objects(writer, value);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores top-level expression with its source line.
+ *
+ * @param expr   Compiled expression.
+ * @param line   Source line.
+ * @param number Number of source line.
+ * @param data   Image writer.
+ */
+static void add_form(struct SExpression *expr, const char *line,
+    unsigned long number, void *data)
+{
+    struct ImageWriter *writer = data;
+    unsigned long size = strlen(line) + 1;
+    struct ImageForm *form;
+
+    if (!grow(writer, &writer->forms, writer->form_count + 1,
+            &writer->form_capacity, sizeof(struct ImageForm)) ||
+        !grow(writer, &writer->text, writer->text_size + size,
+            &writer->text_capacity, 1))
+        return;
+
+    add_objects(writer, expr);
+
+    form = &writer->forms[writer->form_count++];
+    form->value = encode(writer, expr);
+    form->line = writer->text_size;
+    form->number = number;
+
+    memcpy(writer->text + writer->text_size, line, size);
+    writer->text_size += size;
+
+    /* Expression is released after return */
+    finish_batch(writer);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Releases image writer.
+ *
+ * @param writer Image writer.
+ */
+static void free_writer(struct ImageWriter *writer)
+{
+    unsigned long i;
+
+    free((void *) writer->objects);
+    free(writer->slots);
+    free(writer->data);
+    free(writer->entries);
+
+    for (i = 0; i < writer->table_count; ++i)
+        free(writer->tables[i]);
+
+    free(writer->tables);
+    free(writer->forms);
+    free(writer->text);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Copies image part.
+ *
+ * @param pos  Destination.
+ * @param data Image part, it can be NULL when it's empty.
+ * @param size Size of image part.
+ *
+ * @return Position after copied part.
+ */
+static char *append(char *pos, const void *data, size_t size)
+{
+    if (size > 0)
+        memcpy(pos, data, size);
+
+    return pos + size;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates image file content.
+ *
+ * @param writer Image writer with finished batch.
+ * @param header Prepared header with identification and source info.
+ * @param size   Size of image.
+ *
+ * @return Image or NULL if memory cannot be allocated.
+ */
+static char *build_image(struct ImageWriter *writer, struct ImageHeader *header,
+    size_t *size)
+{
+    char *image;
+    char *pos;
+
+    header->version = IMAGE_VERSION;
+    header->object_size = sizeof(struct SExpression);
+    header->object_count = writer->base;
+    header->form_count = writer->form_count;
+    header->text_size = writer->text_size;
+
+    *size = sizeof(struct ImageHeader) +
+        writer->base * sizeof(struct SExpression) +
+        writer->entry_count * sizeof(struct ImageEntry) +
+        writer->form_count * sizeof(struct ImageForm) +
+        writer->text_size;
+
+    if (writer->failed || (image = malloc(*size)) == NULL)
+        return NULL;
+
+    pos = image;
+    pos = append(pos, header, sizeof(struct ImageHeader));
+    pos = append(pos, writer->data, writer->base * sizeof(struct SExpression));
+    pos = append(pos, writer->entries, writer->entry_count * sizeof(struct ImageEntry));
+    pos = append(pos, writer->forms, writer->form_count * sizeof(struct ImageForm));
+    append(pos, writer->text, writer->text_size);
+
+    return image;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Writes image into file.
+ *
+ * Image is written into temporary file which replaces the target so other
+ * processes never see partially written image.
+ *
+ * @param path  File path.
+ * @param image Image content.
+ * @param size  Size of image.
+ *
+ * @return 0 on success.
+ */
+static int write_image(const char *path, const char *image, size_t size)
+{
+    char *tmp_path = malloc(strlen(path) + 32);
+    FILE *file;
+    int result = -1;
+
+    if (tmp_path == NULL)
+        return -1;
+
+    sprintf(tmp_path, "%s.%ld", path, (long) getpid());
+
+    if ((file = fopen(tmp_path, "wb")) != NULL)
+    {
+        fwrite(image, 1, size, file);
+
+        if ((ferror(file) | fclose(file)) == 0 && rename(tmp_path, path) == 0)
+            result = 0;
+        else
+            remove(tmp_path);
+    }
+
+    free(tmp_path);
+
+    return result;
+}
+
+/* ************************************************************************ */
+
+int save_image(const char *path)
+{
+    struct ImageWriter writer;
+    struct ImageHeader header;
+    unsigned long i;
+    size_t size;
+    char *image;
+    int result = 0;
+
+    assert(path);
+
+    memset(&writer, 0, sizeof(writer));
+    memset(&header, 0, sizeof(header));
+    writer.batch = 1;
+
+    /* Collect variables and functions */
+    for_each_variable(add_entry, &writer);
+    header.variable_count = writer.entry_count;
+    for_each_function(add_entry, &writer);
+    header.function_count = writer.entry_count - header.variable_count;
+
+    for (i = 0; i < writer.entry_count; ++i)
+    {
+        writer.entries[i].value = encode(&writer,
+            (struct SExpression *) writer.entries[i].value);
+    }
+
+    finish_batch(&writer);
+
+    strcpy(header.magic, IMAGE_MAGIC);
+    image = writer.unsupported ? NULL : build_image(&writer, &header, &size);
+
+    if (writer.unsupported)
+    {
+        fprintf(stderr, "%s cannot be saved into image\n", writer.unsupported);
+        result = -1;
+    }
+    else if (image == NULL)
+    {
+        fprintf(stderr, "Unable to allocate memory for image\n");
+        result = -1;
+    }
+    else if (write_image(path, image, size))
+    {
+        perror(path);
+        result = -1;
+    }
+
+    free(image);
+    free_writer(&writer);
+
+    return result;
+}
+
+/* ************************************************************************ */
+
+int write_object(FILE *file, struct SExpression *expr)
+{
+    struct ImageWriter writer;
+    struct ImageHeader header;
+    size_t size;
+    char *image;
+    int result = -1;
+
+    assert(file);
+    assert(expr);
+
+    memset(&writer, 0, sizeof(writer));
+    memset(&header, 0, sizeof(header));
+    writer.batch = 1;
+
+    /* Object is stored as the only form without source line */
+    add_form(expr, "", 0, &writer);
+
+    strcpy(header.magic, OBJECT_MAGIC);
+    image = writer.unsupported ? NULL : build_image(&writer, &header, &size);
+
+    if (image != NULL && fwrite(image, 1, size, file) == size)
+        result = 0;
+
+    free(image);
+    free_writer(&writer);
+
+    return result;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Decodes object index as pointer.
+ *
+ * @param objects Loaded objects.
+ * @param count   Number of objects.
+ * @param value   Encoded pointer.
+ * @param expr    Decoded pointer.
+ *
+ * @return 0 if index is valid.
+ */
+static int decode(struct SExpression *objects, unsigned long count,
+    unsigned long value, struct SExpression **expr)
+{
+    if (value == IMAGE_NULL)
+        *expr = NULL;
+    else if (value == IMAGE_NIL)
+        *expr = &sexpr_nil;
+    else if (value == IMAGE_TRUE)
+        *expr = &sexpr_true;
+    else if (value - IMAGE_OBJECTS < count)
+        *expr = &objects[value - IMAGE_OBJECTS];
+    else
+        return -1;
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Counts keys and values stored in list of loaded hash table.
+ *
+ * @param table Loaded hash table with decoded pointers.
+ * @param limit Maximum number of list items.
+ *
+ * @return Number of keys and values or -1 if the list is invalid.
+ */
+static long count_items(const struct SExpression *table, unsigned long limit)
+{
+    const struct SExpression *item;
+    unsigned long count = 0;
+
+    for (item = table->list; item != NULL && item != &sexpr_nil; item = item->right)
+    {
+        if (item->type != TYPE_CONS || ++count > limit)
+            return -1;
+    }
+
+    return count % 2 ? -1 : (long) count;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns text of loaded string.
+ *
+ * @param expr      Loaded string with text offset.
+ * @param text      Text of image.
+ * @param text_size Size of text, it ends with terminator.
+ *
+ * @return Text or NULL if the offset is invalid.
+ */
+static const char *decode_text(const struct SExpression *expr,
+    const char *text, unsigned long text_size)
+{
+    unsigned long offset;
+
+    memcpy(&offset, expr->lvalue, sizeof(offset));
+
+    return offset < text_size ? text + offset : NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates data of loaded hash table from its list.
+ *
+ * @param table Loaded hash table with decoded pointers.
+ * @param count Number of keys and values.
+ */
+static void fill_table(struct SExpression *table, unsigned long count)
+{
+    struct SExpression *item = table->list;
+
+    hash_init(table, count / 2);
+
+    for (; count > 0; count -= 2)
+    {
+        hash_put(table, item->list, item->right->list);
+        item = item->right->right;
+    }
+
+    table->list = NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks image header.
+ *
+ * @param image Image content.
+ * @param size  Size of image.
+ * @param magic Expected identification.
+ *
+ * @return 0 if image is compatible and complete.
+ */
+static int check_header(const char *image, size_t size, const char *magic)
+{
+    const struct ImageHeader *header = (const struct ImageHeader *) image;
+    size_t rest;
+
+    if (size < sizeof(struct ImageHeader) ||
+        memcmp(header->magic, magic, sizeof(header->magic)) ||
+        header->version != IMAGE_VERSION ||
+        header->object_size != sizeof(struct SExpression))
+        return -1;
+
+    /* Counts are checked one by one so the size cannot overflow */
+    rest = size - sizeof(struct ImageHeader);
+
+    if (header->object_count > rest / sizeof(struct SExpression))
+        return -1;
+
+    rest -= header->object_count * sizeof(struct SExpression);
+
+    if (header->variable_count > rest / sizeof(struct ImageEntry) ||
+        header->function_count > rest / sizeof(struct ImageEntry) -
+            header->variable_count)
+        return -1;
+
+    rest -= (header->variable_count + header->function_count) *
+        sizeof(struct ImageEntry);
+
+    if (header->form_count > rest / sizeof(struct ImageForm))
+        return -1;
+
+    rest -= header->form_count * sizeof(struct ImageForm);
+
+    /* Source lines are terminated */
+    if (header->text_size != rest ||
+        (rest > 0 && image[size - 1] != '\0'))
+        return -1;
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Replaces object indices by pointers and makes objects permanent.
+ *
+ * Header must be checked before.
+ *
+ * @param image Image content.
+ *
+ * @return 0 on success.
+ */
+static int fix_image(char *image)
+{
+    struct ImageHeader *header = (struct ImageHeader *) image;
+    struct SExpression *objects = (struct SExpression *) (header + 1);
+    struct ImageEntry *entries = (struct ImageEntry *) (objects + header->object_count);
+    unsigned long entry_count = header->variable_count + header->function_count;
+    struct ImageForm *forms = (struct ImageForm *) (entries + entry_count);
+    const char *text = (const char *) (forms + header->form_count);
+    unsigned long i;
+
+    for (i = 0; i < header->object_count; ++i)
+    {
+        if (decode(objects, header->object_count,
+                (unsigned long) objects[i].right, &objects[i].right) ||
+            decode(objects, header->object_count,
+                (unsigned long) objects[i].list, &objects[i].list))
+            return -1;
+    }
+
+    for (i = 0; i < entry_count; ++i)
+    {
+        struct SExpression *value;
+
+        entries[i].name[IMAGE_NAME_LENGTH - 1] = '\0';
+
+        if (decode(objects, header->object_count, entries[i].value, &value) ||
+            value == NULL)
+            return -1;
+
+        entries[i].value = (unsigned long) value;
+    }
+
+    for (i = 0; i < header->form_count; ++i)
+    {
+        struct SExpression *value;
+
+        if (decode(objects, header->object_count, forms[i].value, &value) ||
+            value == NULL || forms[i].line >= header->text_size)
+            return -1;
+
+        forms[i].value = (unsigned long) value;
+    }
+
+    for (i = 0; i < header->object_count; ++i)
+    {
+        if (objects[i].type == TYPE_HASH &&
+            count_items(&objects[i], header->object_count) < 0)
+            return -1;
+
+        /* String refers to text in image */
+        if (objects[i].type == TYPE_STRING)
+        {
+            const char *value = decode_text(&objects[i], text, header->text_size);
+
+            if (value == NULL)
+                return -1;
+
+            text_attach(&objects[i], value);
+        }
+    }
+
+    /* Objects are not managed by garbage collector */
+    gc_set_permanent(objects, header->object_count);
+
+    /* Hash tables are filled when all items are decoded */
+    for (i = 0; i < header->object_count; ++i)
+    {
+        if (objects[i].type == TYPE_HASH)
+        {
+            fill_table(&objects[i], count_items(&objects[i], header->object_count));
+            gc_changed(&objects[i]);
+        }
+    }
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maps image file into memory.
+ *
+ * Mapping is private so pages are copied only when pointers are fixed.
+ *
+ * @param path  File path.
+ * @param size  Size of image.
+ *
+ * @return Image content or NULL.
+ */
+static char *map_image(const char *path, size_t *size)
+{
+    struct stat st;
+    void *data;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+
+    if (fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return NULL;
+
+    *size = st.st_size;
+
+    return data;
+}
+
+/* ************************************************************************ */
+
+int load_image(const char *path)
+{
+    struct ImageHeader *header;
+    struct ImageEntry *entries;
+    unsigned long i;
+    size_t size;
+    char *image;
+
+    assert(path);
+
+    image = map_image(path, &size);
+
+    if (image == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    if (check_header(image, size, IMAGE_MAGIC) || fix_image(image))
+    {
+        fprintf(stderr, "%s: Invalid or incompatible image\n", path);
+        munmap(image, size);
+        return -1;
+    }
+
+    header = (struct ImageHeader *) image;
+    entries = (struct ImageEntry *) ((struct SExpression *) (header + 1) +
+        header->object_count);
+
+    for (i = 0; i < header->variable_count + header->function_count; ++i)
+    {
+        struct SExpression *value = (struct SExpression *) entries[i].value;
+
+        if (i < header->variable_count)
+            set_variable(entries[i].name, value);
+        else
+            set_function(entries[i].name, value);
+    }
+
+    /* Mapping is kept until exit */
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Decodes object index as pointer to copied object.
+ *
+ * @param objects Loaded objects.
+ * @param copies  Copies of loaded objects.
+ * @param count   Number of objects.
+ * @param value   Encoded pointer, it must be valid.
+ *
+ * @return Decoded pointer.
+ */
+static struct SExpression *decode_copy(struct SExpression *objects,
+    struct SExpression **copies, unsigned long count, unsigned long value)
+{
+    struct SExpression *expr = NULL;
+
+    decode(objects, count, value, &expr);
+
+    if (expr >= objects && expr < objects + count)
+        return copies[expr - objects];
+
+    return expr;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *read_object(FILE *file)
+{
+    struct ImageHeader header;
+    struct SExpression *objects;
+    struct SExpression **copies;
+    struct SExpression *expr = NULL;
+    struct ImageForm *form;
+    const char *text;
+    unsigned long count;
+    unsigned long i;
+    size_t size;
+    char *image;
+
+    assert(file);
+
+    if (fread(&header, sizeof(header), 1, file) != 1)
+        return NULL;
+
+    /* Only one object without source line is expected, text holds strings */
+    if (header.variable_count || header.function_count ||
+        header.form_count != 1 || header.text_size == 0 ||
+        header.text_size > (size_t) -1 / 4 ||
+        header.object_count > ((size_t) -1 / 4) / sizeof(struct SExpression))
+        return NULL;
+
+    count = header.object_count;
+    size = sizeof(header) + count * sizeof(struct SExpression) +
+        sizeof(struct ImageForm) + header.text_size;
+
+    if ((image = malloc(size)) == NULL)
+        return NULL;
+
+    copies = malloc((count ? count : 1) * sizeof(struct SExpression *));
+    memcpy(image, &header, sizeof(header));
+
+    if (copies == NULL ||
+        fread(image + sizeof(header), size - sizeof(header), 1, file) != 1 ||
+        check_header(image, size, OBJECT_MAGIC))
+    {
+        free(copies);
+        free(image);
+        return NULL;
+    }
+
+    objects = (struct SExpression *) (image + sizeof(header));
+    form = (struct ImageForm *) (objects + count);
+    text = (const char *) (form + 1);
+
+    /* All indices are checked before objects are allocated */
+    for (i = 0; i < count; ++i)
+    {
+        if (decode(objects, count, (unsigned long) objects[i].right, &expr) ||
+            decode(objects, count, (unsigned long) objects[i].list, &expr) ||
+            (objects[i].type == TYPE_STRING &&
+                decode_text(&objects[i], text, header.text_size) == NULL))
+            break;
+    }
+
+    if (i < count || decode(objects, count, form->value, &expr) || !expr)
+    {
+        free(copies);
+        free(image);
+        return NULL;
+    }
+
+    /* Copies are reachable through the last one during allocation */
+    for (i = 0; i < count; ++i)
+    {
+        copies[i] = alloc_sexpr(TYPE_CONS);
+        copies[i]->right = i ? copies[i - 1] : NULL;
+
+        if (i)
+            pop_values(1);
+
+        push_value(copies[i]);
+    }
+
+    /* Nothing is allocated while objects are copied */
+    for (i = 0; i < count; ++i)
+    {
+        unsigned char mark = copies[i]->mark;
+
+        *copies[i] = objects[i];
+        copies[i]->right = decode_copy(objects, copies, count,
+            (unsigned long) objects[i].right);
+        copies[i]->list = decode_copy(objects, copies, count,
+            (unsigned long) objects[i].list);
+        copies[i]->mark = mark;
+    }
+
+    /* Strings get their own text */
+    for (i = 0; i < count; ++i)
+    {
+        if (copies[i]->type == TYPE_STRING)
+        {
+            const char *value = decode_text(&objects[i], text, header.text_size);
+            text_init(copies[i], value, strlen(value));
+        }
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        if (copies[i]->type == TYPE_HASH && count_items(copies[i], count) < 0)
+            break;
+    }
+
+    expr = decode_copy(objects, copies, count, form->value);
+
+    /* Hash tables without data must not be released as hash tables */
+    if (i < count)
+        expr = NULL;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (copies[i]->type != TYPE_HASH)
+            continue;
+
+        if (expr != NULL)
+            fill_table(copies[i], count_items(copies[i], count));
+        else
+            copies[i]->type = TYPE_CONS;
+    }
+
+    if (count)
+        pop_values(1);
+
+    free(copies);
+    free(image);
+
+    return expr;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Evaluates all expressions from fixed compiled source.
+ *
+ * @param image Compiled source.
+ */
+static void eval_image(char *image)
+{
+    struct ImageHeader *header = (struct ImageHeader *) image;
+    struct SExpression *objects = (struct SExpression *) (header + 1);
+    struct ImageForm *forms = (struct ImageForm *) (objects + header->object_count);
+    const char *text = (const char *) (forms + header->form_count);
+    unsigned long i;
+
+    for (i = 0; i < header->form_count; ++i)
+        eval_form((struct SExpression *) forms[i].value, text + forms[i].line,
+            forms[i].number);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Computes FNV-1a hash of source file.
+ *
+ * @param file Source file.
+ * @param hash Hash.
+ * @param size Size of file.
+ *
+ * @return 0 on success.
+ */
+static int hash_file(FILE *file, unsigned long *hash, unsigned long *size)
+{
+    char buffer[4096];
+    size_t count;
+
+#if ULONG_MAX > 0xFFFFFFFFUL
+    *hash = 14695981039346656037UL;
+#else
+    *hash = 2166136261UL;
+#endif
+    *size = 0;
+
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        size_t i;
+
+        for (i = 0; i < count; ++i)
+        {
+            *hash ^= (unsigned char) buffer[i];
+#if ULONG_MAX > 0xFFFFFFFFUL
+            *hash *= 1099511628211UL;
+#else
+            *hash *= 16777619UL;
+#endif
+        }
+
+        *size += count;
+    }
+
+    return ferror(file) ? -1 : 0;
+}
+
+/* ************************************************************************ */
+
+int eval_cached(const char *path)
+{
+    struct ImageWriter writer;
+    struct ImageHeader header;
+    const struct ImageHeader *cached;
+    struct stat st;
+    char *cache_path;
+    char *image;
+    size_t size;
+    size_t length;
+    FILE *file;
+
+    assert(path);
+
+    if ((file = fopen(path, "r")) == NULL)
+        return -1;
+
+    /* Only regular files can be read twice */
+    if (fstat(fileno(file), &st) < 0 || !S_ISREG(st.st_mode))
+    {
+        eval_file(file);
+        fclose(file);
+        return 0;
+    }
+
+    memset(&header, 0, sizeof(header));
+
+    length = strlen(path);
+    cache_path = malloc(length + sizeof(CACHE_SUFFIX) + 1);
+
+    if (cache_path == NULL || hash_file(file, &header.source_hash, &header.source_size))
+    {
+        free(cache_path);
+        rewind(file);
+        eval_file(file);
+        fclose(file);
+        return 0;
+    }
+
+    /* "file.lisp" is compiled into "file.lispc" */
+    strcpy(cache_path, path);
+
+    if (length > 5 && !strcmp(path + length - 5, ".lisp"))
+        strcat(cache_path, "c");
+    else
+        strcat(cache_path, CACHE_SUFFIX);
+
+    /* Compiled source is up to date */
+    image = map_image(cache_path, &size);
+
+    if (image != NULL)
+    {
+        cached = (const struct ImageHeader *) image;
+
+        if (!check_header(image, size, CACHE_MAGIC) &&
+            cached->source_hash == header.source_hash &&
+            cached->source_size == header.source_size &&
+            !fix_image(image))
+        {
+            free(cache_path);
+            fclose(file);
+
+            /* Mapping is kept until exit */
+            eval_image(image);
+            return 0;
+        }
+
+        munmap(image, size);
+    }
+
+    /* Compile source */
+    memset(&writer, 0, sizeof(writer));
+    writer.batch = 1;
+    strcpy(header.magic, CACHE_MAGIC);
+    rewind(file);
+
+    if (read_forms(file, add_form, &writer) ||
+        (image = build_image(&writer, &header, &size)) == NULL)
+    {
+        /* Syntax errors are reported by evaluation */
+        free_writer(&writer);
+        free(cache_path);
+        rewind(file);
+        eval_file(file);
+        fclose(file);
+        return 0;
+    }
+
+    free_writer(&writer);
+    fclose(file);
+
+    /* Compiled source is only optimization, failure is ignored */
+    write_image(cache_path, image, size);
+    free(cache_path);
+
+    /* Memory is kept until exit */
+    fix_image(image);
+    eval_image(image);
+
+    return 0;
+}
+
+/* ************************************************************************ */
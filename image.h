@@ -0,0 +1,144 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+
+#ifndef IMAGE_H_
+#define IMAGE_H_
+
+/* ************************************************************************ */
+
+/* C library */
+#include <stdio.h>
+
+/* LISP */
+#include "desc.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Image format version. It must be changed when image layout or
+ * meaning of stored objects changes.
+ */
+#define IMAGE_VERSION 5
+
+/* ************************************************************************ */
+
+/**
+ * @brief Suffix of compiled source files for sources without ".lisp" suffix.
+ */
+#ifndef CACHE_SUFFIX
+#define CACHE_SUFFIX ".lispc"
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Saves global variables and user functions into image file.
+ *
+ * Image contains all reachable S-expressions stored as they are in memory
+ * with pointers replaced by object indices. Hash tables are stored with
+ * list of their keys and values and they are rebuilt when image is loaded,
+ * line readers and vectors cannot be stored. Image is valid only for the
+ * same build of interpreter.
+ *
+ * @param path File path.
+ *
+ * @return 0 on success.
+ */
+int save_image(const char *path);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Loads global variables and user functions from image file.
+ *
+ * The file is mapped into memory and only pointers are fixed, nothing is
+ * parsed or allocated except data of hash tables. Loaded objects are permanent and they are kept until
+ * the application exits. Existing variables and functions with same names
+ * are replaced.
+ *
+ * @param path File path.
+ *
+ * @return 0 on success.
+ */
+int load_image(const char *path);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Writes object and all objects reachable from it into file.
+ *
+ * Objects are stored like in image, so they can be read only by the same
+ * build of interpreter.
+ *
+ * @param file Output file.
+ * @param expr Object.
+ *
+ * @return 0 on success, -1 when object contains line reader or vector or it
+ * cannot be written.
+ */
+int write_object(FILE *file, struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads object stored by `write_object` into heap.
+ *
+ * Objects are copied into garbage collected heap, result must be made
+ * reachable before the next allocation.
+ *
+ * @param file Input file.
+ *
+ * @return Object or NULL if data are invalid.
+ */
+struct SExpression *read_object(FILE *file);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Evaluates source file using its compiled form.
+ *
+ * Compiled expressions are stored next to the source ("file.lisp" into
+ * "file.lispc") together with hash of source content. When the hash and
+ * the image version match, the compiled file is mapped into memory and
+ * evaluated without reading the source. Otherwise the source is compiled,
+ * the compiled file is replaced and expressions are evaluated. Sources with
+ * syntax errors are evaluated by `eval_file` and they are not compiled.
+ *
+ * Output is the same as `eval_file` output.
+ *
+ * @param path Source file path.
+ *
+ * @return 0 on success, -1 if source cannot be opened.
+ */
+int eval_cached(const char *path);
+
+/* ************************************************************************ */
+
+#endif /* IMAGE_H_ */
+
+/* ************************************************************************ */
@@ -24,6 +24,7 @@
 /*                                                                          */
 /* ************************************************************************ */
 
+
 /* Declaration */
 #include "interpret.h"
 
@@ -33,10 +34,19 @@
 #include <assert.h>
 #include <string.h>
 #include <ctype.h>
+#include <setjmp.h>
 
 /* LISP */
 #include "tokenizer.h"
 #include "functions.h"
+#include "gc.h"
+#include "jit.h"
+#include "hash.h"
+#include "reader.h"
+#include "vector.h"
+#include "text.h"
+#include "trace.h"
+#include "profile.h"
 
 /* ************************************************************************ */
 
@@ -49,11 +59,55 @@
 
 /* ************************************************************************ */
 
+/**
+ * @brief The last version of variable places (versions are stored in 16 bits
+ * of reference items).
+ */
+#define MAX_VARIABLE_VERSION 0xFFFF
+
+/* ************************************************************************ */
+
 /**
  * @brief Maximum length of function name.
  */
 #ifndef MAX_FUNCTION_NAME_LENGTH
-#define MAX_FUNCTION_NAME_LENGTH 10
+#define MAX_FUNCTION_NAME_LENGTH 16
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum number of values on the evaluation stack.
+ */
+#ifndef MAX_STACK_SIZE
+#define MAX_STACK_SIZE 1048576
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Default maximum nesting depth of read lists and pending calls.
+ */
+#ifndef MAX_DEPTH
+#define MAX_DEPTH 100000
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of values passed to arithmetic function at once.
+ */
+#ifndef ARITHM_CHUNK_SIZE
+#define ARITHM_CHUNK_SIZE 256
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of preallocated small numbers (0 to count - 1).
+ */
+#ifndef SMALL_VALUE_COUNT
+#define SMALL_VALUE_COUNT 1024
 #endif
 
 /* ************************************************************************ */
@@ -67,7 +121,7 @@ struct Variable
     char name[MAX_VARIABLE_NAME_LENGTH];
 
     /** Variable value. */
-    int value;
+    struct SExpression *value;
 };
 
 /* ************************************************************************ */
@@ -80,8 +134,114 @@ struct Function
     /** Function name. */
     char name[MAX_FUNCTION_NAME_LENGTH];
 
-    /** Function pointer. */
+    /** Builtin function pointer. */
+    func_t function;
+
+    /** Special form function pointer. */
+    special_t special;
+
+    /** User function definition: parameter list followed by body forms. */
+    struct SExpression *lambda;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Structure for storing local variables frame.
+ */
+struct Frame
+{
+    /** Index of the first frame slot in the slot stack. */
+    unsigned int base;
+
+    /** Number of slots. */
+    unsigned int size;
+
+    /** Index of lexically enclosing frame or -1. */
+    int parent;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Compile-time scope of local variables.
+ */
+struct Scope
+{
+    /** Lexically enclosing scope. */
+    const struct Scope *parent;
+
+    /** Number of variables. */
+    unsigned int count;
+
+    /** Variable names. */
+    const char *names[MAX_FRAME_SIZE];
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief List which is being read.
+ */
+struct Reader
+{
+    /** Source form item or NULL for data list. */
+    struct SExpression *parent;
+
+    /** Location for the next item. */
+    struct SExpression **dest;
+
+    /** If items are quoted. */
+    int quoted;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Source item waiting for local variable resolution.
+ */
+struct Unresolved
+{
+    /** Source item. */
+    struct SExpression *item;
+
+    /** Scope of the item. */
+    const struct Scope *scope;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Pending function call or return from function.
+ */
+struct Call
+{
+    /** Function name item followed by arguments or NULL for return. */
+    struct SExpression *head;
+
+    /** The next argument for evaluation. */
+    struct SExpression *arg;
+
+    /** Builtin function or NULL for user function. */
     func_t function;
+
+    /** Function name for profiler, for return the called user function. */
+    const char *name;
+
+    /** Index of the first argument (return value for return). */
+    unsigned int base;
+
+    /** Number of evaluated arguments. */
+    unsigned int argc;
+
+    /** Current frame of the caller. */
+    int frame;
+
+    /** Number of frames of the caller. */
+    unsigned int frame_count;
+
+    /** Number of slots of the caller. */
+    unsigned int slot_count;
 };
 
 /* ************************************************************************ */
@@ -108,310 +268,2372 @@ static unsigned int l_variable_count = 0;
 /* ************************************************************************ */
 
 /**
- * @brief Array of supported functions.
+ * @brief Version of variable places. It's changed when a place is reused
+ * by another variable, that invalidates inline caches of references.
  */
-static const struct Function l_functions[] = {
-    {"QUIT", func_quit},
-    {"EXIT", func_quit},
-    {"SET", func_set},
-    {"+", func_add},
-    {"-", func_sub},
-    {"*", func_mult},
-    {"/", func_div},
-    {"=", func_eq},
-    {"/=", func_neq},
-    {"QUOTE", func_quote},
-    {"LIST", func_list},
-    {"CAR", func_car},
-    {"CDR", func_cdr},
-    {">", func_gt},
-    {">=", func_ge},
-    {"<", func_lt},
-    {"<=", func_le}
-};
+static unsigned short l_variable_version = 1;
 
 /* ************************************************************************ */
 
 /**
- * @brief Number of supported functions.
+ * @brief Stack of local variable values.
  */
-static const unsigned int l_function_count = sizeof(l_functions) / sizeof(struct Function);
+static struct SExpression **l_slots = NULL;
 
 /* ************************************************************************ */
 
 /**
- * @brief Current expression for `clean_up()` when error is occured.
+ * @brief Number of used slots.
  */
-static struct SExpression* l_current_expr = NULL;
+static unsigned int l_slot_count = 0;
 
 /* ************************************************************************ */
 
 /**
- * @brief Find variable object by name.
- *
- * @param name Variable name.
- *
- * @return Found variable object pointer or NULL.
+ * @brief Number of allocated slots.
  */
-static struct Variable *find_variable(const char *name)
-{
-    unsigned int i;
+static unsigned int l_slot_capacity = 0;
 
-    /* No variables */
-    if (l_variables == NULL)
-        return NULL;
+/* ************************************************************************ */
 
-    /* Foreach whole table */
-    for (i = 0; i < l_variable_count; ++i)
-    {
-        /* Check variable name */
-        if (!strcmp(l_variables[i].name, name))
-            return &l_variables[i];
-    }
+/**
+ * @brief Stack of local variable frames.
+ */
+static struct Frame *l_frames = NULL;
 
-    /* Not found */
-    return NULL;
-}
+/* ************************************************************************ */
+
+/**
+ * @brief Number of used frames.
+ */
+static unsigned int l_frame_count = 0;
 
 /* ************************************************************************ */
 
 /**
- * @brief Finds empty place for new variable.
- *
- * When a variable is unset, only name is removed and array is not reallocated
- * to save some time. After that when a new variable is set there is no need
- * for array reallocation, we can just use this empty place.
- *
- * @return A pointer to empty variable.
+ * @brief Number of allocated frames.
  */
-static struct Variable *find_variable_empty()
-{
-    return find_variable("");
-}
+static unsigned int l_frame_capacity = 0;
 
 /* ************************************************************************ */
 
 /**
- * @brief Finds function object by name.
- *
- * @param name Function name.
- *
- * @return A pointer to function structure or NULL.
+ * @brief Index of current frame or -1 when there are no local variables.
  */
-static const struct Function* find_function(const char *name)
-{
-    unsigned int i;
+static int l_frame = -1;
 
-    /* Foreach whole table */
-    for (i = 0; i < l_function_count; ++i)
-    {
-        /* Check function name */
-        if (!strcmp(l_functions[i].name, name))
-            return &l_functions[i];
-    }
+/* ************************************************************************ */
 
-    /* Not found */
-    return NULL;
-}
+/**
+ * @brief Evaluation stack. It holds evaluated expressions and arguments.
+ */
+static struct SExpression *l_stack[MAX_STACK_SIZE];
 
 /* ************************************************************************ */
 
-void syntax_error(const char *err)
-{
-    fprintf(stderr, "Syntax error: %s\n", err);
-    exit(EXIT_FAILURE);
-}
+/**
+ * @brief Number of values on the evaluation stack.
+ */
+static unsigned int l_stack_count = 0;
 
 /* ************************************************************************ */
 
-void eval_file(FILE *file)
-{
-    assert(file);
+/**
+ * @brief Return point for errors.
+ */
+static jmp_buf l_error_jump;
+
+/* ************************************************************************ */
+
+/**
+ * @brief If errors return to `eval_line`.
+ */
+static int l_error_recover = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief If interpreter is initialized.
+ */
+static int l_initialized = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief If prompts and evaluated commands are printed.
+ */
+static int l_echo = 1;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Output for results (stdout if NULL).
+ */
+static FILE *l_output = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Output for errors (stderr if NULL).
+ */
+static FILE *l_errors = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of errors since the last reset.
+ */
+static unsigned int l_error_count = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief If current line is being read.
+ */
+static int l_reading = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief If syntax errors are not printed.
+ */
+static int l_quiet = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of nested parallel tasks. Global variables and functions
+ * cannot be changed in them.
+ */
+static unsigned int l_task_depth = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Handler of syntax errors in task of worker process.
+ */
+static error_func_t l_task_error = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stack of lists which are being read.
+ */
+static struct Reader *l_readers = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of allocated readers.
+ */
+static unsigned int l_reader_capacity = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stack of items waiting for resolution.
+ */
+static struct Unresolved *l_unresolved = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of items waiting for resolution.
+ */
+static unsigned int l_unresolved_count = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of allocated unresolved items.
+ */
+static unsigned int l_unresolved_capacity = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stack of pending calls.
+ */
+static struct Call *l_calls = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of pending calls.
+ */
+static unsigned int l_call_count = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of allocated calls.
+ */
+static unsigned int l_call_capacity = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum nesting depth.
+ */
+static unsigned int l_max_depth = MAX_DEPTH;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Current nesting of recursive evaluation.
+ */
+static unsigned int l_recursion = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Start of C stack used by recursive evaluation.
+ */
+static const char *l_stack_base = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Usable size of C stack, 0 if it isn't checked.
+ */
+static unsigned long l_stack_size = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Preallocated small numbers.
+ */
+static struct SExpression l_small_values[SMALL_VALUE_COUNT];
+
+/* ************************************************************************ */
+
+/**
+ * @brief The innermost block for RETURN.
+ */
+static struct Block *l_block = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Value returned from block.
+ */
+static struct SExpression *l_block_value = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Array of user defined functions.
+ */
+static struct Function *l_user_functions = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of user defined functions.
+ */
+static unsigned int l_user_function_count = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Array of supported functions.
+ */
+static const struct Function l_functions[] = {
+    {"QUIT", func_quit},
+    {"EXIT", func_quit},
+    {"SET", func_set},
+    {"IF", NULL, func_if},
+    {"DEFUN", NULL, func_defun},
+    {"LAMBDA", NULL, func_lambda},
+    {"LET", NULL, func_let},
+    {"LET*", NULL, func_let_seq},
+    {"DOTIMES", NULL, func_dotimes},
+    {"WHILE", NULL, func_while},
+    {"LOOP", NULL, func_loop},
+    {"RETURN", func_return},
+    {"+", func_add},
+    {"-", func_sub},
+    {"*", func_mult},
+    {"/", func_div},
+    {"=", func_eq},
+    {"/=", func_neq},
+    {"FLOAT", func_float},
+    {"TRUNCATE", func_truncate},
+    {"QUOTE", NULL, func_quote},
+    {"LAZY-SEQ", NULL, func_lazy_seq},
+    {"TAKE", func_take},
+    {"DROP", func_drop},
+    {"RANGE", func_range},
+    {"IOTA", func_iota},
+    {"LIST", func_list},
+    {"CAR", func_car},
+    {"CDR", func_cdr},
+    {"CONS", func_cons},
+    {"NTH", func_nth},
+    {"LENGTH", func_length},
+    {">", func_gt},
+    {">=", func_ge},
+    {"<", func_lt},
+    {"<=", func_le},
+    {"GC", func_gc},
+    {"GC-STATS", func_gc_stats},
+    {"GC-TUNE", func_gc_tune},
+    {"MAKE-HASH", func_make_hash},
+    {"GETHASH", func_gethash},
+    {"PUTHASH", func_puthash},
+    {"REMHASH", func_remhash},
+    {"HASH-COUNT", func_hash_count},
+    {"PMAP", func_pmap},
+    {"PREDUCE", func_preduce},
+    {"PFOR-EACH", func_pfor_each},
+    {"OPEN-LINES", func_open_lines},
+    {"NEXT-LINE", func_next_line},
+    {"FOR-EACH-LINE", func_for_each_line},
+    {"CLOSE-LINES", func_close_lines},
+    {"READ-CSV", func_read_csv},
+    {"SORT", func_sort},
+    {"SAVE-IMAGE", func_save_image}
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of supported functions.
+ */
+static const unsigned int l_function_count = sizeof(l_functions) / sizeof(struct Function);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Expression which is currently read and evaluated.
+ */
+static struct SExpression* l_current_expr = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Find variable object by name.
+ *
+ * @param name Variable name.
+ *
+ * @return Found variable object pointer or NULL.
+ */
+static struct Variable *find_variable(const char *name)
+{
+    unsigned int i;
+
+    /* No variables */
+    if (l_variables == NULL)
+        return NULL;
+
+    /* Foreach whole table */
+    for (i = 0; i < l_variable_count; ++i)
+    {
+        /* Check variable name */
+        if (!strcmp(l_variables[i].name, name))
+            return &l_variables[i];
+    }
+
+    /* Not found */
+    return NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Finds empty place for new variable.
+ *
+ * When a variable is unset, only value is removed and array is not reallocated
+ * to save some time. After that when a new variable is set there is no need
+ * for array reallocation, we can just use this empty place.
+ *
+ * Reused place invalidates inline caches so places are not reused when
+ * cache versions are exhausted.
+ *
+ * @return A pointer to empty variable.
+ */
+static struct Variable *find_variable_empty()
+{
+    unsigned int i;
+
+    if (l_variable_version == MAX_VARIABLE_VERSION)
+        return NULL;
+
+    for (i = 0; i < l_variable_count; ++i)
+    {
+        if (l_variables[i].value == NULL)
+        {
+            ++l_variable_version;
+            return &l_variables[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Finds function object by name.
+ *
+ * @param name Function name.
+ *
+ * @return A pointer to function structure or NULL.
+ */
+static const struct Function* find_function(const char *name)
+{
+    unsigned int i;
+
+    /* Foreach whole table */
+    for (i = 0; i < l_function_count; ++i)
+    {
+        /* Check function name */
+        if (!strcmp(l_functions[i].name, name))
+            return &l_functions[i];
+    }
+
+    /* Foreach user functions */
+    for (i = 0; i < l_user_function_count; ++i)
+    {
+        if (!strcmp(l_user_functions[i].name, name))
+            return &l_user_functions[i];
+    }
+
+    /* Not found */
+    return NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks if name is a number literal.
+ *
+ * @param name Symbol name.
+ *
+ * @return If name is number.
+ */
+static int is_number(const char *name)
+{
+    /* Sign */
+    if (name[0] == '-' || name[0] == '+')
+        ++name;
+
+    /* Fraction without integer part */
+    if (name[0] == '.')
+        ++name;
+
+    return isdigit((unsigned char) name[0]);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks if number name is a floating point number.
+ *
+ * @param name Number name.
+ *
+ * @return If name is a floating point number.
+ */
+static int is_float(const char *name)
+{
+    char *end;
+
+    /* Hexadecimal numbers are not supported by reader */
+    if (strpbrk(name, ".E") == NULL || strchr(name, 'X') != NULL)
+        return 0;
+
+    strtod(name, &end);
+
+    return *end == '\0';
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks if number name contains only digits.
+ *
+ * @param name Number name.
+ *
+ * @return If name is an integer number.
+ */
+static int is_integer(const char *name)
+{
+    if (name[0] == '-' || name[0] == '+')
+        ++name;
+
+    return name[strspn(name, "0123456789")] == '\0';
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks if item is a name. Numbers and strings store other data in
+ * place of the name text.
+ *
+ * @param item Source item.
+ *
+ * @return If item is a name.
+ */
+static int is_name(const struct SExpression *item)
+{
+    return !item->list && item->type != TYPE_VALUE &&
+        item->type != TYPE_FLOAT && item->type != TYPE_STRING;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Marks all expressions used by interpreter.
+ */
+static void mark_roots(void)
+{
+    unsigned int i;
+
+    gc_mark(l_current_expr);
+
+    /* Global variables */
+    for (i = 0; i < l_variable_count; ++i)
+    {
+        if (l_variables[i].value != NULL)
+            gc_mark(l_variables[i].value);
+    }
+
+    /* User functions */
+    for (i = 0; i < l_user_function_count; ++i)
+        gc_mark(l_user_functions[i].lambda);
+
+    /* Local variables */
+    for (i = 0; i < l_slot_count; ++i)
+        gc_mark(l_slots[i]);
+
+    /* Evaluation stack */
+    for (i = 0; i < l_stack_count; ++i)
+        gc_mark(l_stack[i]);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Marks objects referenced from data outside of the heap.
+ *
+ * @param expr Hash table, line reader, vector or string.
+ */
+static void mark_external(struct SExpression *expr)
+{
+    /* Line reader, vector and string don't reference any objects */
+    if (expr->type == TYPE_HASH)
+        hash_mark(expr);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Frees data outside of the heap.
+ *
+ * @param expr Hash table, line reader, vector or string.
+ */
+static void release_external(struct SExpression *expr)
+{
+    if (expr->type == TYPE_HASH)
+        hash_release(expr);
+    else if (expr->type == TYPE_READER)
+        reader_release(expr);
+    else if (expr->type == TYPE_STRING)
+        text_release(expr);
+    else
+        vector_release(expr);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Makes room for one more item in dynamic array.
+ *
+ * @param array    Array.
+ * @param count    Number of used items.
+ * @param capacity Number of allocated items.
+ * @param size     Size of item.
+ *
+ * @return Array.
+ */
+static void *reserve(void *array, unsigned int count, unsigned int *capacity,
+    size_t size)
+{
+    void *tmp;
+    unsigned int new_capacity;
+
+    if (count < *capacity)
+        return array;
+
+    new_capacity = *capacity ? 2 * *capacity : 64;
+    tmp = realloc(array, new_capacity * size);
+
+    if (tmp == NULL)
+    {
+        perror("Unable to allocate memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    *capacity = new_capacity;
+
+    return tmp;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Increases nesting of recursive evaluation.
+ *
+ * Special forms evaluate their parts recursively on C stack, so nesting is
+ * limited by the maximum depth and by the size of the stack.
+ */
+static void enter_recursion(void)
+{
+    char here;
+
+    if (l_recursion == l_max_depth)
+        syntax_error("Maximum recursion depth exceeded");
+
+    if (l_stack_size)
+    {
+        unsigned long used = (unsigned long) (l_stack_base > &here ?
+            l_stack_base - &here : &here - l_stack_base);
+
+        if (used > l_stack_size)
+            syntax_error("Maximum recursion depth exceeded");
+    }
+
+    ++l_recursion;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Decreases nesting of recursive evaluation.
+ */
+static void leave_recursion(void)
+{
+    assert(l_recursion > 0);
+    --l_recursion;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks if current name is the given word.
+ *
+ * @param word Upper case word.
+ *
+ * @return If name is the word (case is ignored).
+ */
+static int is_token(const char *word)
+{
+    const struct Token *token = cur_token();
+    unsigned int i;
+
+    for (i = 0; i < token->length; ++i)
+    {
+        if (toupper(token->text[i]) != word[i])
+            return 0;
+    }
+
+    return word[i] == '\0';
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores integer into number expression.
+ *
+ * @param expr  Number expression.
+ * @param value Value.
+ */
+static void store_value(struct SExpression *expr, long value)
+{
+    /* Value is stored in place of value text */
+    memcpy(expr->lvalue, &value, sizeof(value));
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates atom from current symbol name or string.
+ *
+ * @param quoted If atom is quoted.
+ *
+ * @return Atom.
+ */
+static struct SExpression *alloc_atom(int quoted)
+{
+    const struct Token *token = cur_token();
+    enum Sym sym = cur_sym();
+    char text[MAX_VALUE_LENGTH];
+    unsigned int length = token->length;
+    unsigned int i;
+    struct SExpression *expr;
+
+    /* Integer is parsed by tokenizer */
+    if (sym == SYM_NUMBER)
+    {
+        expr = alloc_sexpr(TYPE_VALUE);
+        store_value(expr, token->value);
+        return expr;
+    }
+
+    /* String text is stored outside of the heap */
+    if (sym == SYM_STRING)
+        return text_create(token->text, token->length);
+
+    /* Longer names are truncated */
+    if (length > MAX_VALUE_LENGTH - 1)
+        length = MAX_VALUE_LENGTH - 1;
+
+    /* Names are converted to upper case when they're stored */
+    for (i = 0; i < length; ++i)
+        text[i] = toupper((unsigned char) token->text[i]);
+
+    text[length] = '\0';
+
+    if (is_number(text))
+    {
+        /* Number followed by other characters */
+        if (!is_float(text) && !is_integer(text))
+            syntax_error("Invalid number");
+
+        /* Truncated number would have different value */
+        if (token->length > MAX_VALUE_LENGTH - 1)
+            syntax_error("Number is too long");
+
+        /* Integers which don't fit into long are parsed here */
+        return alloc_float(strtod(text, NULL));
+    }
+
+    if (quoted)
+        expr = alloc_sexpr(TYPE_QUOTED);
+    else
+        expr = alloc_sexpr(TYPE_SYMBOL);
+
+    memcpy(expr->lvalue, text, length + 1);
+
+    return expr;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds list into stack of read lists.
+ *
+ * @param count  Number of read lists.
+ * @param parent Source form item or NULL for data list.
+ * @param dest   Location for the first item.
+ */
+static void push_reader(unsigned int count, struct SExpression *parent,
+    struct SExpression **dest)
+{
+    if (count == l_max_depth)
+        syntax_error("Maximum nesting depth exceeded");
+
+    l_readers = reserve(l_readers, count, &l_reader_capacity, sizeof(struct Reader));
+    l_readers[count].parent = parent;
+    l_readers[count].dest = dest;
+    l_readers[count].quoted = 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Read list from current file without evaluation.
+ *
+ * Items are stored into parent nested list so the whole expression is
+ * reachable from the root during reading. Quoted lists and arguments of
+ * QUOTE are read as data (cons cells). Nested lists are kept on explicit
+ * stack instead of recursion.
+ *
+ * @param parent Parent expression.
+ */
+static void read_list(struct SExpression *parent)
+{
+    unsigned int count = 0;
+    int quoted = 0;
+
+    /* Must starts as list */
+    assert(cur_sym() == SYM_LPAREN);
+
+    push_reader(count++, parent->type == TYPE_QUOTED ? NULL : parent,
+        &parent->list);
+
+    /* Read until the outer right paren is found */
+    while (count > 0)
+    {
+        struct Reader *reader = &l_readers[count - 1];
+        struct SExpression **dest;
+        struct SExpression *item;
+        enum Sym sym = get_sym();
+
+        if (sym == SYM_EOF)
+        {
+            /* Expression is freed by garbage collector */
+            syntax_error("Missing )");
+        }
+
+        if (sym == SYM_RPAREN)
+        {
+            if (!reader->parent)
+            {
+                /* Data list terminator */
+                *reader->dest = &sexpr_nil;
+            }
+            else if (reader->parent->list == NULL)
+            {
+                /* Empty list */
+                reader->parent->type = TYPE_NIL;
+            }
+
+            --count;
+            continue;
+        }
+
+        if (sym == SYM_QUOTE)
+        {
+            quoted = 1;
+            continue;
+        }
+
+        if (sym == SYM_INV)
+            syntax_error("Invalid symbol");
+
+        if (sym != SYM_LPAREN && sym != SYM_NAME && sym != SYM_NUMBER &&
+            sym != SYM_STRING)
+            continue;
+
+        quoted = quoted || reader->quoted;
+
+        if (!reader->parent)
+        {
+            /* Data list item is stored in new cons cell */
+            item = *reader->dest = alloc_sexpr(TYPE_CONS);
+            reader->dest = &item->right;
+            dest = &item->list;
+
+            if (sym == SYM_LPAREN)
+            {
+                push_reader(count++, NULL, dest);
+            }
+            else if (sym == SYM_NAME && is_token("NIL"))
+            {
+                *dest = &sexpr_nil;
+            }
+            else
+            {
+                *dest = alloc_atom(1);
+            }
+        }
+        else if (sym == SYM_LPAREN)
+        {
+            /* Inner list */
+            item = *reader->dest = alloc_sexpr(quoted ? TYPE_QUOTED : TYPE_SEXPR);
+            reader->dest = &item->right;
+            push_reader(count++, quoted ? NULL : item, &item->list);
+        }
+        else
+        {
+            item = *reader->dest = alloc_atom(quoted);
+            reader->dest = &item->right;
+
+            /* Arguments of QUOTE are data */
+            if (reader->parent->list == item && sym == SYM_NAME &&
+                is_token("QUOTE"))
+                reader->quoted = 1;
+        }
+
+        quoted = 0;
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds variable name into scope.
+ *
+ * @param scope Scope.
+ * @param item  Name item.
+ */
+static void add_scope_name(struct Scope *scope, const struct SExpression *item)
+{
+    if (!is_name(item) || !isalpha(item->lvalue[0]))
+        syntax_error("Invalid variable name");
+
+    if (scope->count == MAX_FRAME_SIZE)
+        syntax_error("Too many local variables");
+
+    scope->names[scope->count++] = item->lvalue;
+}
+
+/* ************************************************************************ */
+
+static void compile_list(struct SExpression *expr, const struct Scope *scope);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds item into stack of items waiting for resolution.
+ *
+ * @param item  Source item.
+ * @param scope Scope of the item.
+ */
+static void push_unresolved(struct SExpression *item, const struct Scope *scope)
+{
+    l_unresolved = reserve(l_unresolved, l_unresolved_count,
+        &l_unresolved_capacity, sizeof(struct Unresolved));
+
+    l_unresolved[l_unresolved_count].item = item;
+    l_unresolved[l_unresolved_count].scope = scope;
+    ++l_unresolved_count;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Resolves symbol as local variable reference.
+ *
+ * @param item  Symbol item.
+ * @param scope Current scope.
+ */
+static void resolve_local(struct SExpression *item, const struct Scope *scope)
+{
+    unsigned int depth = 0;
+
+    /* Find variable in scopes */
+    for (; scope != NULL; scope = scope->parent, ++depth)
+    {
+        unsigned int slot = scope->count;
+
+        /* Later variable hides previous one with same name */
+        while (slot--)
+        {
+            if (!strcmp(scope->names[slot], item->lvalue))
+            {
+                item->type = TYPE_LOCAL;
+                item->depth = depth;
+                item->slot = slot;
+                return;
+            }
+        }
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Resolves local variable references in list item.
+ *
+ * Nested forms are kept on explicit stack instead of recursion.
+ *
+ * @param item  List item.
+ * @param scope Current scope.
+ */
+static void compile_item(struct SExpression *item, const struct Scope *scope)
+{
+    unsigned int base = l_unresolved_count;
+
+    push_unresolved(item, scope);
+
+    while (l_unresolved_count > base)
+    {
+        --l_unresolved_count;
+        item = l_unresolved[l_unresolved_count].item;
+        scope = l_unresolved[l_unresolved_count].scope;
+
+        /* Nested form */
+        if (item->list)
+        {
+            if (item->type == TYPE_SEXPR)
+                compile_list(item->list, scope);
+        }
+        else if (item->type == TYPE_SYMBOL)
+        {
+            resolve_local(item, scope);
+        }
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Resolves local variable references in function definition.
+ *
+ * Lambda body sees variables of enclosing scopes, their values are captured
+ * when the function object is created. DEFUN body doesn't see them.
+ *
+ * @param params Parameter list item followed by body.
+ * @param parent Enclosing scope or NULL.
+ */
+static void compile_function(struct SExpression *params,
+    const struct Scope *parent)
+{
+    struct SExpression *item;
+    struct Scope scope;
+
+    scope.parent = parent;
+    scope.count = 0;
+
+    if (!params || (!params->list && params->type != TYPE_NIL))
+        syntax_error("Missing parameter list");
+
+    /* Parameters */
+    for (item = params->list; item != NULL; item = item->right)
+        add_scope_name(&scope, item);
+
+    enter_recursion();
+
+    /* Body */
+    for (item = params->right; item != NULL; item = item->right)
+        compile_item(item, &scope);
+
+    leave_recursion();
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Resolves local variable references in LET and LET* forms.
+ *
+ * @param expr       LET form.
+ * @param scope      Current scope.
+ * @param sequential If initialization sees previous variables (LET*).
+ */
+static void compile_let(struct SExpression *expr, const struct Scope *scope,
+    int sequential)
+{
+    struct SExpression *item;
+    struct Scope inner;
+
+    inner.parent = scope;
+    inner.count = 0;
+
+    if (!expr->right || (!expr->right->list && expr->right->type != TYPE_NIL))
+        syntax_error("Missing LET bindings");
+
+    enter_recursion();
+
+    /* Bindings */
+    for (item = expr->right->list; item != NULL; item = item->right)
+    {
+        /* Variable without value */
+        if (!item->list)
+        {
+            add_scope_name(&inner, item);
+            continue;
+        }
+
+        if (item->list->right)
+        {
+            if (item->list->right->right)
+                syntax_error("Invalid LET binding");
+
+            compile_item(item->list->right, sequential ? &inner : scope);
+        }
+
+        add_scope_name(&inner, item->list);
+    }
+
+    /* Body */
+    for (item = expr->right->right; item != NULL; item = item->right)
+        compile_item(item, &inner);
+
+    leave_recursion();
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Resolves local variable references in DOTIMES form.
+ *
+ * @param expr  DOTIMES form.
+ * @param scope Current scope.
+ */
+static void compile_dotimes(struct SExpression *expr, const struct Scope *scope)
+{
+    struct SExpression *spec;
+    struct SExpression *item;
+    struct Scope inner;
+
+    inner.parent = scope;
+    inner.count = 0;
+
+    /* (var count [result]) */
+    if (!expr->right || !expr->right->list || !expr->right->list->right ||
+        (expr->right->list->right->right && expr->right->list->right->right->right))
+        syntax_error("Invalid DOTIMES specification");
+
+    spec = expr->right->list;
+
+    enter_recursion();
+
+    /* Count doesn't see the counter */
+    compile_item(spec->right, scope);
+
+    add_scope_name(&inner, spec);
+
+    /* Result */
+    if (spec->right->right)
+        compile_item(spec->right->right, &inner);
+
+    /* Body */
+    for (item = expr->right->right; item != NULL; item = item->right)
+        compile_item(item, &inner);
+
+    leave_recursion();
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Resolves local variable references in form.
+ *
+ * Every reference to local variable is replaced by frame depth and slot
+ * index so in runtime there is no lookup by name. Arguments of QUOTE are
+ * data and they are skipped.
+ *
+ * @param expr  The first list item.
+ * @param scope Current scope.
+ */
+static void compile_list(struct SExpression *expr, const struct Scope *scope)
+{
+    struct SExpression *item;
+
+    if (expr->list)
+    {
+        /* Lambda expression as function */
+        push_unresolved(expr, scope);
+    }
+    else if (!is_name(expr))
+    {
+        /* Invalid function is reported in evaluation */
+    }
+    else if (!strcmp(expr->lvalue, "QUOTE"))
+    {
+        return;
+    }
+    else if (!strcmp(expr->lvalue, "DEFUN"))
+    {
+        if (expr->right)
+            compile_function(expr->right->right, NULL);
+
+        return;
+    }
+    else if (!strcmp(expr->lvalue, "LAMBDA"))
+    {
+        compile_function(expr->right, scope);
+        return;
+    }
+    else if (!strcmp(expr->lvalue, "LET") || !strcmp(expr->lvalue, "LET*"))
+    {
+        compile_let(expr, scope, expr->lvalue[3] == '*');
+        return;
+    }
+    else if (!strcmp(expr->lvalue, "DOTIMES"))
+    {
+        compile_dotimes(expr, scope);
+        return;
+    }
+
+    /* Arguments */
+    for (item = expr->right; item != NULL; item = item->right)
+        push_unresolved(item, scope);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds a new frame on top of the frame stack.
+ *
+ * @param parent Lexically enclosing frame.
+ * @param size   Number of slots.
+ */
+static void push_frame_parent(int parent, unsigned int size)
+{
+    unsigned int i;
+
+    /* Frames needs to be reallocated */
+    if (l_frame_count == l_frame_capacity)
+    {
+        unsigned int capacity = l_frame_capacity ? 2 * l_frame_capacity : 64;
+        struct Frame *tmp = realloc(l_frames, capacity * sizeof(struct Frame));
+
+        if (tmp == NULL)
+        {
+            perror("Unable to allocate memory for frames\n");
+            exit(EXIT_FAILURE);
+        }
+
+        l_frames = tmp;
+        l_frame_capacity = capacity;
+    }
+
+    /* Slots needs to be reallocated */
+    if (l_slot_count + size > l_slot_capacity)
+    {
+        unsigned int capacity = l_slot_capacity ? 2 * l_slot_capacity : 256;
+        struct SExpression **tmp;
+
+        while (capacity < l_slot_count + size)
+            capacity *= 2;
+
+        tmp = realloc(l_slots, capacity * sizeof(struct SExpression *));
+
+        if (tmp == NULL)
+        {
+            perror("Unable to allocate memory for local variables\n");
+            exit(EXIT_FAILURE);
+        }
+
+        l_slots = tmp;
+        l_slot_capacity = capacity;
+    }
+
+    l_frames[l_frame_count].base = l_slot_count;
+    l_frames[l_frame_count].size = size;
+    l_frames[l_frame_count].parent = parent;
+    l_frame = l_frame_count++;
+
+    /* Variables without value */
+    for (i = 0; i < size; ++i)
+        l_slots[l_slot_count++] = &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Captures values of visible local variables.
+ *
+ * Frames are stored as list of value lists, the innermost frame first.
+ *
+ * @param dest Location for the list, it must be reachable.
+ */
+static void capture_frames(struct SExpression **dest)
+{
+    int frame;
+
+    /* Lexically visible frames, the innermost first */
+    for (frame = l_frame; frame >= 0; frame = l_frames[frame].parent)
+    {
+        struct SExpression *cell = alloc_sexpr(TYPE_CONS);
+        struct SExpression **value_dest = &cell->list;
+        unsigned int i;
+
+        cell->list = &sexpr_nil;
+        cell->right = &sexpr_nil;
+        *dest = cell;
+        dest = &cell->right;
+
+        for (i = 0; i < l_frames[frame].size; ++i)
+        {
+            struct SExpression *value = alloc_sexpr(TYPE_CONS);
+
+            value->list = l_slots[l_frames[frame].base + i];
+            value->right = &sexpr_nil;
+            *value_dest = value;
+            value_dest = &value->right;
+        }
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Pushes frames with captured values.
+ *
+ * @param env    Captured frames, the innermost first.
+ * @param parent Frame enclosing the outermost captured frame.
+ *
+ * @return The innermost frame or parent if nothing is captured.
+ */
+static int restore_frames(const struct SExpression *env, int parent)
+{
+    const struct SExpression *item;
+    unsigned int count = 0;
+    unsigned int i;
+
+    for (item = env; item->type == TYPE_CONS; item = item->right)
+        ++count;
+
+    /* Captured frames are restored from the outermost one */
+    while (count--)
+    {
+        const struct SExpression *values;
+        unsigned int size = 0;
+
+        for (item = env, i = 0; i < count; ++i)
+            item = item->right;
+
+        for (values = item->list; values->type == TYPE_CONS; values = values->right)
+            ++size;
+
+        push_frame_parent(parent, size);
+        parent = l_frame;
+
+        for (values = item->list, i = 0; i < size; values = values->right, ++i)
+            set_local(0, i, values->list);
+    }
+
+    return parent;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Takes sample of pending calls for profiler.
+ */
+static void take_sample(void)
+{
+    unsigned int i;
+
+    profile_begin();
+
+    for (i = 0; i < l_call_count; ++i)
+    {
+        if (l_calls[i].name)
+            profile_frame(l_calls[i].name);
+    }
+
+    profile_end();
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds a new pending call.
+ *
+ * Current frame is stored so it can be restored when an argument is
+ * evaluated or when the function returns.
+ *
+ * @param head     Function name item or NULL for return.
+ * @param function Builtin function.
+ * @param base     Index of the first argument (return value for return).
+ */
+static void push_call(struct SExpression *head, func_t function, unsigned int base)
+{
+    struct Call *call;
+
+    if (l_call_count == l_max_depth)
+        syntax_error("Maximum evaluation depth exceeded");
+
+    l_calls = reserve(l_calls, l_call_count, &l_call_capacity, sizeof(struct Call));
+
+    call = &l_calls[l_call_count++];
+    call->head = head;
+    call->arg = head ? head->right : NULL;
+    call->function = function;
+    call->name = head ? (head->list ? "LAMBDA" : head->lvalue) : NULL;
+    call->base = base;
+    call->argc = 0;
+    call->frame = l_frame;
+    call->frame_count = l_frame_count;
+    call->slot_count = l_slot_count;
+
+    /* Signal handler only requests the sample */
+    if (profile_pending)
+        take_sample();
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Removes state of aborted evaluation.
+ *
+ * Partially read and evaluated expressions are not referenced anymore so
+ * they are freed by garbage collector.
+ */
+static void recover(void)
+{
+    l_current_expr = NULL;
+    l_stack_count = 0;
+    l_call_count = 0;
+    l_frame = -1;
+    l_frame_count = 0;
+    l_slot_count = 0;
+    l_unresolved_count = 0;
+    l_recursion = 0;
+    l_block = NULL;
+    l_task_depth = 0;
+
+    /* Rest of unfinished expression is ignored */
+    if (l_reading)
+        skip_line();
+
+    l_reading = 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Initializes interpreter before the first evaluation.
+ */
+static void init(void)
+{
+    if (l_initialized)
+        return;
+
+    l_initialized = 1;
+
+    /* Register clean-up function */
+    atexit(&clean_up);
+
+    /* Register garbage collector roots */
+    gc_set_roots(&mark_roots);
+    gc_set_external(&mark_external, &release_external);
+}
+
+/* ************************************************************************ */
+
+void syntax_error(const char *err)
+{
+    /* Worker process cannot return to eval_line */
+    if (l_task_error)
+        l_task_error(err);
+
+    if (!l_quiet)
+        fprintf(l_errors ? l_errors : stderr, "Syntax error: %s\n", err);
+
+    ++l_error_count;
+
+    /* Return to eval_line */
+    if (l_error_recover)
+        longjmp(l_error_jump, 1);
+
+    exit(EXIT_FAILURE);
+}
+
+/* ************************************************************************ */
+
+void eval_file(FILE *file)
+{
+    assert(file);
+
+    init();
+
+    l_echo = 1;
+    l_output = stdout;
+    l_errors = stderr;
+
+    /* Set source file */
+    set_source(file);
+
+    /* Evaluate separate lines */
+    while (!eval_line())
+        continue;
+}
+
+/* ************************************************************************ */
+
+unsigned int eval_request(FILE *input, FILE *output)
+{
+    assert(input);
+    assert(output);
+
+    init();
+
+    l_echo = 0;
+    l_output = output;
+    l_errors = output;
+    l_error_count = 0;
+
+    /* Set source file */
+    set_source(input);
+
+    /* Evaluate all expressions */
+    while (!eval_line())
+        continue;
+
+    l_echo = 1;
+    l_output = stdout;
+    l_errors = stderr;
+
+    return l_error_count;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads and compiles list from current file.
+ *
+ * Read list is stored as current expression so it's reachable by garbage
+ * collector until it's released.
+ *
+ * @param type List type.
+ *
+ * @return Compiled list.
+ */
+static struct SExpression *read_sexpr(enum Type type)
+{
+    /* Allocate root expression and store it as current */
+    l_current_expr = alloc_sexpr(type);
+
+    /* Read whole list */
+    l_reading = 1;
+    read_list(l_current_expr);
+    l_reading = 0;
+
+    /* Resolve local variables */
+    compile_item(l_current_expr, NULL);
+
+    return l_current_expr;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads and compiles the next top-level expression from current file.
+ *
+ * @return Compiled expression or NULL if there is no more expression.
+ */
+static struct SExpression *read_form(void)
+{
+    int quoted = 0;
+
+    /* Read symbols */
+    while (1)
+    {
+        /* Get next symbol */
+        enum Sym sym = get_sym();
+
+        /* Nothing to read */
+        if (sym == SYM_EOF)
+            return NULL;
+
+        /* Quote */
+        if (sym == SYM_QUOTE)
+        {
+            quoted = 1;
+        }
+        else if (sym == SYM_INV)
+        {
+            syntax_error("Invalid symbol");
+        }
+        else if (sym == SYM_NAME || sym == SYM_NUMBER || sym == SYM_STRING)
+        {
+            /* Variable name */
+            return l_current_expr = alloc_atom(quoted);
+        }
+        else if (sym == SYM_LPAREN)
+        {
+            return read_sexpr(quoted ? TYPE_QUOTED : TYPE_SEXPR);
+        }
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Prints evaluated command (for non-stdin input) and result.
+ *
+ * @param line Evaluated command.
+ * @param expr Result or NULL if evaluation failed.
+ */
+static void print_result(const char *line, const struct SExpression *expr)
+{
+    /* Print current command for non-stdin input */
+    if (l_echo && !is_source_stdin())
+        printf("[%d]> %s", ++l_line_no, line);
+
+    if (!expr)
+        return;
+
+    /* Print result */
+    write_sexpr(l_output ? l_output : stdout, expr);
+
+    fprintf(l_output ? l_output : stdout, "\n");
+}
+
+/* ************************************************************************ */
+
+int eval_line(void)
+{
+    struct SExpression *expr;
+
+    if (l_echo && is_source_stdin())
+        printf("[%d]> ", ++l_line_no);
+
+    /* Error in evaluation */
+    if (setjmp(l_error_jump))
+    {
+        l_error_recover = 0;
+        trace_form_end();
+        recover();
+        print_result(cur_line(), NULL);
+
+        return 0;
+    }
+
+    l_error_recover = 1;
+
+    expr = read_form();
+
+    /* Nothing to read */
+    if (!expr)
+    {
+        l_error_recover = 0;
+        return 1;
+    }
+
+    trace_form_begin(cur_line(), cur_line_number());
+    expr = eval_sexpr(expr);
+    trace_form_end();
+
+    /* Source is not needed anymore */
+    l_current_expr = NULL;
+
+    assert(expr);
+
+    print_result(cur_line(), expr);
+
+    l_error_recover = 0;
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+int read_forms(FILE *file, form_func_t func, void *data)
+{
+    struct SExpression *expr;
+
+    assert(file);
+    assert(func);
+
+    init();
+
+    /* Set source file */
+    set_source(file);
+
+    /* Syntax error */
+    if (setjmp(l_error_jump))
+    {
+        l_error_recover = 0;
+        l_quiet = 0;
+        recover();
+
+        return -1;
+    }
+
+    l_error_recover = 1;
+    l_quiet = 1;
+
+    while ((expr = read_form()) != NULL)
+    {
+        func(expr, cur_line(), cur_line_number(), data);
+
+        /* Source is not needed anymore */
+        l_current_expr = NULL;
+    }
+
+    l_error_recover = 0;
+    l_quiet = 0;
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+void eval_form(struct SExpression *expr, const char *line,
+    unsigned long number)
+{
+    assert(expr);
+    assert(line);
+
+    init();
+
+    l_echo = 1;
+    l_output = stdout;
+    l_errors = stderr;
+
+    /* Error in evaluation */
+    if (setjmp(l_error_jump))
+    {
+        l_error_recover = 0;
+        trace_form_end();
+        recover();
+        print_result(line, NULL);
+
+        return;
+    }
+
+    l_error_recover = 1;
+
+    /* Source is kept by caller */
+    trace_form_begin(line, number);
+    expr = eval_sexpr(expr);
+    trace_form_end();
+
+    assert(expr);
+
+    print_result(line, expr);
+
+    l_error_recover = 0;
+}
+
+/* ************************************************************************ */
+
+void enter_block(struct Block *block)
+{
+    block->parent = l_block;
+    block->stack_count = l_stack_count;
+    block->call_count = l_call_count;
+    block->frame = l_frame;
+    block->frame_count = l_frame_count;
+    block->slot_count = l_slot_count;
+    block->recursion = l_recursion;
+
+    l_block = block;
+    l_block_value = &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *leave_block(struct Block *block)
+{
+    struct SExpression *value = l_block_value;
+
+    assert(l_block == block);
+
+    l_block = block->parent;
+    l_block_value = NULL;
+
+    return value;
+}
+
+/* ************************************************************************ */
+
+void return_from_block(struct SExpression *value)
+{
+    struct Block *block = l_block;
+
+    if (!block)
+        syntax_error("RETURN outside of loop");
+
+    /* Remove state of evaluation inside the block, value must not be
+     * released until the block returns it */
+    l_stack_count = block->stack_count;
+    l_call_count = block->call_count;
+    l_frame = block->frame;
+    l_frame_count = block->frame_count;
+    l_slot_count = block->slot_count;
+    l_recursion = block->recursion;
+    l_block_value = value;
+
+    longjmp(block->jump, 1);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *eval_list(enum Type type)
+{
+    struct SExpression *expr;
+
+    /* Evaluate parsed expression */
+    expr = eval_sexpr(read_sexpr(type));
+
+    /* Source is not needed anymore */
+    l_current_expr = NULL;
+
+    return expr;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *eval_sexpr(struct SExpression *expr)
+{
+    /* Calls pushed during evaluation are removed at the end */
+    unsigned int calls = l_call_count;
+
+    assert(expr);
+
+    enter_recursion();
+
+    /* Evaluated expression must be reachable */
+    push_value(expr);
+
+    /* Frames and values are removed when evaluation returns */
+    push_call(NULL, NULL, l_stack_count - 1);
+
+    while (1)
+    {
+        const struct Function *func = NULL;
+        struct SExpression *value = NULL;
+        struct SExpression *head;
+        struct SExpression *def = NULL;
+        struct Call *call;
+
+        if (expr->type == TYPE_LOCAL)
+        {
+            /* Local variable */
+            value = get_local(expr->depth, expr->slot);
+        }
+        else if (expr->type == TYPE_SYMBOL)
+        {
+            /* Global variable */
+            value = !strcmp(expr->lvalue, "T") ? &sexpr_true : get_global(expr);
+        }
+        else if (expr->type == TYPE_QUOTED && expr->list)
+        {
+            /* Quoted list */
+            value = expr->list;
+        }
+        else if (expr->type != TYPE_SEXPR)
+        {
+            /* Nothing to evaluate */
+            value = expr;
+        }
+        else if ((value = jit_eval(expr)) != NULL)
+        {
+            /* Evaluated by compiled code */
+        }
+        else
+        {
+            head = expr->list;
+
+            if (head->list)
+            {
+                /* Lambda expression as function */
+                def = eval_sexpr(head);
+
+                /* Function object is kept with captured values */
+                if (def->type != TYPE_LAMBDA)
+                    syntax_error("Invalid function");
+            }
+            else
+            {
+                if (!is_name(head))
+                    syntax_error("Invalid function");
+
+                /* Find function */
+                func = find_function(head->lvalue);
+
+                /* Unable to find function with given name */
+                if (!func)
+                {
+                    char tmp[200];
+
+                    /* Construct syntax error */
+                    strcpy(tmp, "Undefined function: ");
+                    strcat(tmp, head->lvalue);
+
+                    syntax_error(tmp);
+                }
+
+                /* Evaluate result of special form instead */
+                if (func->special)
+                {
+                    expr = func->special(head);
+                    push_value(expr);
+                    continue;
+                }
+
+                def = func->lambda;
+            }
+
+            /* Definition can be replaced during evaluation */
+            if (def)
+                push_value(def);
+
+            /* Arguments are evaluated one by one */
+            push_call(head, def ? NULL : func->function, l_stack_count);
+        }
+
+        /* Finish calls which have all arguments */
+        while (1)
+        {
+            unsigned int argc;
+            unsigned int base;
+            unsigned int i;
+            struct SExpression *param;
+            struct SExpression *body;
+            struct SExpression *lambda;
+            const char *name;
+
+            call = &l_calls[l_call_count - 1];
+
+            if (value)
+            {
+                /* Restore frame of the caller */
+                l_frame = call->frame;
+                l_frame_count = call->frame_count;
+                l_slot_count = call->slot_count;
+
+                /* Return from function */
+                if (!call->head)
+                {
+                    l_stack_count = call->base;
+
+                    if (--l_call_count == calls)
+                    {
+                        leave_recursion();
+                        return value;
+                    }
+
+                    continue;
+                }
+
+                /* Store argument */
+                l_stack_count = call->base + call->argc++;
+                push_value(value);
+                value = NULL;
+            }
+
+            /* Evaluate the next argument */
+            if (call->arg)
+            {
+                expr = call->arg;
+                call->arg = expr->right;
+                break;
+            }
+
+            argc = call->argc;
+            base = call->base;
+
+            /* Call builtin function */
+            if (call->function)
+            {
+                if (trace_active && trace_call_begin(call->head->lvalue, argc,
+                    l_call_count))
+                {
+                    value = call->function(argc, &l_stack[base]);
+                    trace_call_end();
+                }
+                else
+                {
+                    value = call->function(argc, &l_stack[base]);
+                }
+
+                /* Time of long builtin is counted for the builtin */
+                if (profile_pending)
+                    take_sample();
+
+                --l_call_count;
+                continue;
+            }
+
+            lambda = l_stack[base - 1];
+            def = lambda->type == TYPE_LAMBDA ? lambda->list : lambda;
+            name = call->name;
+            --l_call_count;
+
+            /* Check number of parameters */
+            for (i = 0, param = def->list; param != NULL; param = param->right)
+                ++i;
+
+            if (i != argc)
+                syntax_error("Invalid number of arguments");
+
+            /* Called from argument, return must be stored */
+            if (l_calls[l_call_count - 1].head)
+                push_call(NULL, NULL, base - 1);
+
+            call = &l_calls[l_call_count - 1];
+            call->name = name;
+
+            /* Frames of the caller are replaced in tail call */
+            l_frame_count = call->frame_count;
+            l_slot_count = call->slot_count;
+
+            /* Bind parameters, lambda sees its captured values */
+            push_frame_parent(lambda->type == TYPE_LAMBDA ?
+                restore_frames(lambda->right, -1) : -1, argc);
+
+            for (i = 0; i < argc; ++i)
+                set_local(0, i, l_stack[base + i]);
+
+            /* Only the definition must be kept */
+            l_stack[call->base] = lambda;
+            l_stack_count = call->base + 1;
+
+            body = def->right;
+
+            if (!body)
+            {
+                value = &sexpr_nil;
+                continue;
+            }
+
+            /* Evaluate body forms */
+            for (; body->right != NULL; body = body->right)
+                eval_sexpr(body);
+
+            /* The last form is evaluated in place (tail call) */
+            expr = body;
+            break;
+        }
+    }
+}
+
+/* ************************************************************************ */
+
+struct SExpression *apply_function(struct SExpression *func, unsigned int argc,
+    struct SExpression **argv)
+{
+    struct SExpression *call = alloc_sexpr(TYPE_SEXPR);
+    struct SExpression *item;
+    unsigned int i;
+
+    /* Call is reachable during allocation */
+    push_value(call);
+
+    if (func->type == TYPE_LAMBDA)
+    {
+        /* Lambda is evaluated from quoted item */
+        call->list = item = alloc_sexpr(TYPE_QUOTED);
+        item->list = func;
+    }
+    else
+    {
+        const struct Function *def;
+
+        /* Function name, special forms cannot be applied */
+        if ((func->type != TYPE_QUOTED && func->type != TYPE_SYMBOL) ||
+            func->list || (def = find_function(func->lvalue)) == NULL ||
+            def->special)
+        {
+            syntax_error("Invalid function");
+        }
+
+        call->list = item = alloc_sexpr(TYPE_SYMBOL);
+        strcpy(item->lvalue, func->lvalue);
+    }
+
+    /* Arguments are quoted so they are not evaluated again */
+    for (i = 0; i < argc; ++i)
+    {
+        item->right = alloc_sexpr(TYPE_QUOTED);
+        item = item->right;
+        item->list = argv[i];
+    }
+
+    item = eval_sexpr(call);
+    pop_values(1);
+
+    return item;
+}
+
+/* ************************************************************************ */
+
+struct Block *begin_task(error_func_t error)
+{
+    struct Block *block = l_block;
+
+    ++l_task_depth;
+
+    if (error)
+        l_task_error = error;
+
+    /* RETURN cannot leave the task */
+    l_block = NULL;
+
+    return block;
+}
+
+/* ************************************************************************ */
+
+void end_task(struct Block *block)
+{
+    assert(l_task_depth > 0);
+    --l_task_depth;
+
+    l_block = block;
+}
+
+/* ************************************************************************ */
+
+void set_function(const char *name, struct SExpression *lambda)
+{
+    unsigned int i;
+    struct Function *func = NULL;
+
+    assert(lambda);
+
+    if (l_task_depth)
+        syntax_error("Function cannot be defined in parallel task");
+
+    if (strlen(name) >= MAX_FUNCTION_NAME_LENGTH)
+        syntax_error("Function name is too long");
+
+    /* Builtin functions are not replaceable */
+    for (i = 0; i < l_function_count; ++i)
+    {
+        if (!strcmp(l_functions[i].name, name))
+            syntax_error("Unable to redefine builtin function");
+    }
+
+    /* Try to find function with given name */
+    for (i = 0; i < l_user_function_count; ++i)
+    {
+        if (!strcmp(l_user_functions[i].name, name))
+            func = &l_user_functions[i];
+    }
+
+    if (!func)
+    {
+        /* Functions needs to be reallocated */
+        struct Function* tmp = realloc(l_user_functions,
+            (l_user_function_count + 1) * sizeof(struct Function));
+
+        if (tmp == NULL)
+        {
+            perror("Unable to allocate memory for functions\n");
+            exit(EXIT_FAILURE);
+        }
+
+        l_user_functions = tmp;
+
+        /* Pointer to function structure */
+        func = &l_user_functions[l_user_function_count++];
+
+        /* Store name */
+        strcpy(func->name, name);
+        func->function = NULL;
+        func->special = NULL;
+    }
+
+    func->lambda = lambda;
+}
+
+/* ************************************************************************ */
+
+void set_max_depth(unsigned int depth)
+{
+    l_max_depth = depth;
+}
+
+/* ************************************************************************ */
+
+unsigned int get_max_depth(void)
+{
+    return l_max_depth;
+}
+
+/* ************************************************************************ */
+
+void set_stack_limit(const void *base, unsigned long size)
+{
+    l_stack_base = (const char *) base;
+    l_stack_size = size;
+}
+
+/* ************************************************************************ */
+
+void push_frame(unsigned int size)
+{
+    push_frame_parent(l_frame, size);
+}
+
+/* ************************************************************************ */
+
+struct SExpression *get_local(unsigned int depth, unsigned int slot)
+{
+    int frame = l_frame;
+
+    /* Find enclosing frame */
+    while (depth--)
+        frame = l_frames[frame].parent;
+
+    assert(frame >= 0);
+    return l_slots[l_frames[frame].base + slot];
+}
+
+/* ************************************************************************ */
+
+void set_local(unsigned int depth, unsigned int slot, struct SExpression *value)
+{
+    int frame = l_frame;
+
+    /* Find enclosing frame */
+    while (depth--)
+        frame = l_frames[frame].parent;
+
+    assert(frame >= 0);
+    l_slots[l_frames[frame].base + slot] = value;
+}
+
+/* ************************************************************************ */
 
-    /* Register clean-up function */
-    atexit(&clean_up);
+struct SExpression *make_lazy(struct SExpression *body)
+{
+    struct SExpression *lazy = alloc_sexpr(TYPE_LAZY);
 
-    /* Set source file */
-    set_source(file);
+    /* Captured values are reachable through lazy sequence */
+    lazy->list = body;
+    lazy->right = &sexpr_nil;
+    push_value(lazy);
+    capture_frames(&lazy->right);
+    pop_values(1);
 
-    /* Evaluate separate lines */
-    while (!eval_line())
-        continue;
+    return lazy;
 }
 
 /* ************************************************************************ */
 
-int eval_line(void)
+struct SExpression *make_lambda(struct SExpression *def)
 {
-    struct SExpression *expr = NULL;
-    int quoted = 0;
+    struct SExpression *lambda = alloc_sexpr(TYPE_LAMBDA);
 
-    if (is_source_stdin())
-        printf("[%d]> ", ++l_line_no);
+    /* Captured values are reachable through function object */
+    lambda->list = def;
+    lambda->right = &sexpr_nil;
+    push_value(lambda);
+    capture_frames(&lambda->right);
+    pop_values(1);
 
-    /* Read symbols */
-    while (1)
-    {
-        /* Get next symbol */
-        enum Sym sym = get_sym();
+    return lambda;
+}
 
-        /* Nothing to read */
-        if (sym == SYM_EOF)
-            return 1;
+/* ************************************************************************ */
 
-        /* Quote */
-        if (sym == SYM_QUOTE)
+struct SExpression *force(struct SExpression *expr)
+{
+    while (expr->type == TYPE_LAZY)
+    {
+        /* Not evaluated yet */
+        if (!expr->depth)
         {
-            quoted = 1;
+            int frame = l_frame;
+            unsigned int frame_count = l_frame_count;
+            unsigned int slot_count = l_slot_count;
+            struct SExpression *body;
+            struct SExpression *value = &sexpr_nil;
+
+            push_value(expr);
+            restore_frames(expr->right, l_frame);
+
+            for (body = expr->list; body != NULL; body = body->right)
+                value = eval_sexpr(body);
+
+            l_frame = frame;
+            l_frame_count = frame_count;
+            l_slot_count = slot_count;
+            pop_values(1);
+
+            /* Result is cached and captured values are released */
+            expr->list = value;
+            expr->right = NULL;
+            expr->depth = 1;
+
+            /* Lazy sequence can be loaded from image */
+            gc_changed(expr);
         }
-        else if (sym == SYM_NAME)
-        {
-            expr = alloc_sexpr(TYPE_VALUE);
-
-            /* Variable name */
-            if (isalpha(name[0]))
-            {
-                if (has_variable(name))
-                {
-                    int value = get_variable(name);
-                    sprintf(expr->lvalue, "%d", value);
-                }
-                else
-                {
-                    /* No variable */
-                    expr->type = TYPE_NIL;
-                }
-            }
-            else
-            {
-                /* Value */
-                strncpy(expr->lvalue, name, sizeof(expr->lvalue));
-            }
 
-            break;
-        }
-        else if (sym == SYM_LPAREN)
-        {
-            /* Evaluate expression */
-            expr = eval_list(quoted ? TYPE_QUOTED : TYPE_NIL);
-            break;
-        }
+        expr = expr->list;
     }
 
-    /* Print current command for non-stdin input */
-    if (!is_source_stdin())
-        printf("[%d]> %s", ++l_line_no, cur_line());
+    return expr;
+}
 
-    assert(expr);
+/* ************************************************************************ */
+
+void push_value(struct SExpression *value)
+{
+    if (l_stack_count == MAX_STACK_SIZE)
+        syntax_error("Evaluation stack overflow");
 
-    /* Print result and free it */
-    print_sexpr(expr);
-    free_sexpr(expr);
+    l_stack[l_stack_count++] = value;
+}
 
-    printf("\n");
+/* ************************************************************************ */
 
-    return 0;
+void pop_values(unsigned int count)
+{
+    assert(count <= l_stack_count);
+    l_stack_count -= count;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *eval_list(enum Type type)
+long get_value(const struct SExpression *expr)
 {
-    /* Allocate initial expression and store it as current */
-    struct SExpression *expr = l_current_expr = alloc_sexpr(type);
-    struct SExpression *rexpr = expr;
+    long value;
 
-    /* Must starts as list */
-    assert(cur_sym() == SYM_LPAREN);
+    /* Floating point number is truncated */
+    if (expr->type == TYPE_FLOAT)
+        return (long) get_float(expr);
 
-    /* Read until right paren is found */
-    while (get_sym() != SYM_RPAREN)
-    {
-        if (cur_sym() == SYM_EOF)
-        {
-            /* Free expression */
-            syntax_error("Missing )");
-        }
+    /* Only numbers have value, T is stored as text */
+    if (expr->type != TYPE_VALUE || expr->list || expr == &sexpr_true)
+        return 0;
 
-        /* Inner list */
-        if (cur_sym() == SYM_LPAREN)
-        {
-            /* Recursive evaluation */
-            rexpr->type = TYPE_SEXPR;
-            rexpr = rexpr->right = eval_list(type);
-        }
-        else if (cur_sym() == SYM_NAME)
-        {
-            if (rexpr->type == TYPE_NIL)
-                rexpr->type = TYPE_SEXPR;
+    memcpy(&value, expr->lvalue, sizeof(value));
 
-            if (strlen(rexpr->lvalue))
-            {
-                rexpr = rexpr->right = alloc_sexpr(isdigit(name[0]) ? TYPE_VALUE : type);
-            }
+    return value;
+}
 
-            strncpy(rexpr->lvalue, name, sizeof(expr->lvalue));
-        }
-    }
+/* ************************************************************************ */
 
-    /* Evaluate parsed expression */
-    expr = eval_sexpr(expr);
+double get_float(const struct SExpression *expr)
+{
+    double value;
 
-    /* After that there is no chance to error */
-    l_current_expr = NULL;
+    if (expr->type != TYPE_FLOAT)
+        return get_value(expr);
 
-    return expr;
+    memcpy(&value, expr->lvalue, sizeof(value));
+
+    return value;
 }
 
 /* ************************************************************************ */
 
-struct SExpression *eval_sexpr(struct SExpression *expr)
+struct SExpression *alloc_value(long value)
 {
-    const struct Function *func;
-
-    assert(expr);
+    struct SExpression *expr;
 
-    /* Nothing to evaluate */
-    if (expr->type == TYPE_NIL || expr->type == TYPE_QUOTED)
-        return expr;
+    if (value >= 0 && value < SMALL_VALUE_COUNT)
+    {
+        expr = &l_small_values[value];
 
-    /* Find function */
-    func = find_function(expr->lvalue);
+        /* Values are created on first use */
+        if (expr->type != TYPE_VALUE)
+        {
+            expr->type = TYPE_VALUE;
+            store_value(expr, value);
+            gc_set_permanent(expr, 1);
+        }
 
-    /* Function found */
-    if (func)
-    {
-        /* Call found function */
-        return func->function(expr);
+        return expr;
     }
 
-    /* Unable to find function with given name */
-    {
-        char tmp[200];
+    expr = alloc_sexpr(TYPE_VALUE);
+    store_value(expr, value);
 
-        /* Construct syntax error */
-        strcpy(tmp, "Undefined function: ");
-        strcat(tmp, expr->lvalue);
+    return expr;
+}
 
-        syntax_error(tmp);
-    }
+/* ************************************************************************ */
 
-    /* Get rid of no-return warning */
-    return NULL;
+struct SExpression *alloc_float(double value)
+{
+    /* Value is stored in place of value text */
+    struct SExpression *expr = alloc_sexpr(TYPE_FLOAT);
+    memcpy(expr->lvalue, &value, sizeof(value));
+
+    return expr;
 }
 
 /* ************************************************************************ */
 
-void set_variable(const char *name, int value)
+void set_variable(const char *name, struct SExpression *value)
 {
     struct Variable *var;
 
+    if (l_task_depth)
+        syntax_error("Global variable cannot be changed in parallel task");
+
     /* Try to find variable with given name */
     var = find_variable(name);
 
     /* Not found */
     if (!var)
     {
+        if (strlen(name) >= MAX_VARIABLE_NAME_LENGTH)
+            syntax_error("Variable name is too long");
+
         /* Try to find empty place */
         var = find_variable_empty();
 
@@ -431,10 +2653,10 @@ void set_variable(const char *name, int value)
 
             /* Pointer to variable structure */
             var = &l_variables[l_variable_count - 1];
-
-            /* Store name */
-            strcpy(var->name, name);
         }
+
+        /* Store name */
+        strcpy(var->name, name);
     }
 
     assert(var);
@@ -448,22 +2670,57 @@ void set_variable(const char *name, int value)
 int has_variable(const char *name)
 {
     /* Try to find variable */
-    return (find_variable(name) != NULL);
+    struct Variable *var = find_variable(name);
+
+    return (var != NULL && var->value != NULL);
 }
 
 /* ************************************************************************ */
 
-int get_variable(const char *name)
+struct SExpression *get_variable(const char *name)
 {
     /* Try to find variable */
     struct Variable *var = find_variable(name);
 
     /* Return variable value */
-    if (var)
+    if (var && var->value)
         return var->value;
 
     /* Not found */
-    return 0;
+    return &sexpr_nil;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *get_global(struct SExpression *item)
+{
+    struct Variable *var;
+
+    if (item->slot != 0 && item->depth == l_variable_version)
+    {
+        /* Place of the variable is cached */
+        var = &l_variables[item->slot - 1];
+    }
+    else
+    {
+        var = find_variable(item->lvalue);
+
+        /* Not found variables are not cached, they can be set later */
+        if (!var)
+            return &sexpr_nil;
+
+        if (var - l_variables < 0xFFFF)
+        {
+            item->slot = var - l_variables + 1;
+            item->depth = l_variable_version;
+        }
+    }
+
+    /* Unset variable */
+    if (!var->value)
+        return &sexpr_nil;
+
+    return var->value;
 }
 
 /* ************************************************************************ */
@@ -473,93 +2730,370 @@ void unset_variable(const char *name)
     /* Try to find variable */
     struct Variable *var = find_variable(name);
 
-    /* Remove variable name */
+    /* Name is kept so cached references stay valid until the place is
+     * reused */
     if (var)
-        var->name[0] = '\0';
+        var->value = NULL;
+}
+
+/* ************************************************************************ */
+
+void for_each_variable(entry_func_t func, void *data)
+{
+    unsigned int i;
+
+    for (i = 0; i < l_variable_count; ++i)
+    {
+        if (l_variables[i].value != NULL)
+            func(l_variables[i].name, l_variables[i].value, data);
+    }
+}
+
+/* ************************************************************************ */
+
+void for_each_function(entry_func_t func, void *data)
+{
+    unsigned int i;
+
+    for (i = 0; i < l_user_function_count; ++i)
+        func(l_user_functions[i].name, l_user_functions[i].lambda, data);
 }
 
 /* ************************************************************************ */
 
 void clean_up(void)
 {
-    if (l_current_expr)
-        free_sexpr(l_current_expr);
+    l_current_expr = NULL;
+
+    jit_free_all();
 
     if (l_variables)
         free(l_variables);
 
+    if (l_user_functions)
+        free(l_user_functions);
+
+    if (l_frames)
+        free(l_frames);
+
+    if (l_slots)
+        free(l_slots);
+
+    if (l_readers)
+        free(l_readers);
+
+    if (l_unresolved)
+        free(l_unresolved);
+
+    if (l_calls)
+        free(l_calls);
+
+    /* Free all expressions */
+    gc_free_all();
+
     printf("Bye.\n");
 }
 
 /* ************************************************************************ */
 
-struct SExpression *func_arithm_base(struct SExpression *expr, arithm_func_t func)
+/**
+ * @brief Checks if any argument is a floating point number or a vector of
+ * them.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return If floating point arithmetic is required.
+ */
+static int has_float(unsigned int argc, struct SExpression **argv)
 {
-    int result;
-    int* argv;
-    unsigned int argc = 0;
-    int* args_ptr;
-    struct SExpression *tmp;
-
-    assert(expr);
-    assert(func);
-
-    /* NIL */
-    if (!expr->right)
-        return expr;
+    unsigned int i;
 
-    /* Count number of arguments */
-    /* The first place is for function name */
-    for (tmp = expr->right; tmp != NULL; tmp = tmp->right)
+    for (i = 0; i < argc; ++i)
     {
-        argc++;
+        if (argv[i]->type == TYPE_FLOAT || (argv[i]->type == TYPE_VECTOR &&
+            vector_get(argv[i])->kind == VECTOR_FLOAT))
+            return 1;
     }
 
-    /* Allocate memory for arguments */
-    /* NOTE: C99 - variable-length automatic array */
-    argv = calloc(argc, sizeof(int));
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads argument values, ranges and vectors are expanded.
+ *
+ * @param argc     Number of arguments.
+ * @param argv     Array of arguments.
+ * @param index    Index of the current argument.
+ * @param position Position in the current range or vector.
+ * @param values   Output values.
+ * @param size     Maximum number of values.
+ *
+ * @return Number of values.
+ */
+static unsigned int read_values(unsigned int argc, struct SExpression **argv,
+    unsigned int *index, long *position, long *values, unsigned int size)
+{
+    unsigned int count = 0;
 
-    if (argv == NULL)
+    while (count < size && *index < argc)
     {
-        perror("Cannot allocate memory for function arguments!\n");
-        exit(EXIT_FAILURE);
+        const struct SExpression *arg = argv[*index];
+
+        if (arg->type == TYPE_RANGE)
+        {
+            struct Range range;
+            long value;
+
+            get_range(arg, &range);
+            value = range.start + *position * range.step;
+
+            for (; count < size && *position < range.length; ++*position)
+            {
+                values[count++] = value;
+                value += range.step;
+            }
+
+            if (*position < range.length)
+                break;
+
+            *position = 0;
+        }
+        else if (arg->type == TYPE_VECTOR)
+        {
+            const struct Vector *vector = vector_get(arg);
+
+            /* Vectors of floating point numbers are read by read_floats */
+            for (; count < size && (unsigned long) *position < vector->length;
+                ++*position)
+                values[count++] = vector->items[*position].integer;
+
+            if ((unsigned long) *position < vector->length)
+                break;
+
+            *position = 0;
+        }
+        else
+        {
+            values[count++] = get_value(arg);
+        }
+
+        ++*index;
     }
 
-    /* Store arguments */
-    for (tmp = expr->right, args_ptr = argv; tmp != NULL;
-        tmp = tmp->right, args_ptr++)
+    return count;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads argument values as floating point numbers, ranges and
+ * vectors are expanded.
+ *
+ * @param argc     Number of arguments.
+ * @param argv     Array of arguments.
+ * @param index    Index of the current argument.
+ * @param position Position in the current range or vector.
+ * @param values   Output values.
+ * @param size     Maximum number of values.
+ *
+ * @return Number of values.
+ */
+static unsigned int read_floats(unsigned int argc, struct SExpression **argv,
+    unsigned int *index, long *position, double *values, unsigned int size)
+{
+    unsigned int count = 0;
+
+    while (count < size && *index < argc)
     {
-        /* No empty argument */
-        assert(strlen(tmp->lvalue) > 0);
+        const struct SExpression *arg = argv[*index];
+
+        if (arg->type == TYPE_RANGE)
+        {
+            struct Range range;
+            long value;
 
-        /* Check first character for alpha */
-        if (isalpha(tmp->lvalue[0]))
+            get_range(arg, &range);
+            value = range.start + *position * range.step;
+
+            for (; count < size && *position < range.length; ++*position)
+            {
+                values[count++] = (double) value;
+                value += range.step;
+            }
+
+            if (*position < range.length)
+                break;
+
+            *position = 0;
+        }
+        else if (arg->type == TYPE_VECTOR)
         {
-            *args_ptr = get_variable(tmp->lvalue);
+            const struct Vector *vector = vector_get(arg);
+
+            for (; count < size && (unsigned long) *position < vector->length;
+                ++*position)
+            {
+                if (vector->kind == VECTOR_FLOAT)
+                    values[count++] = vector->items[*position].real;
+                else
+                    values[count++] = (double) vector->items[*position].integer;
+            }
+
+            if ((unsigned long) *position < vector->length)
+                break;
+
+            *position = 0;
         }
         else
         {
-            *args_ptr = atoi(tmp->lvalue);
+            values[count++] = get_float(arg);
         }
+
+        ++*index;
+    }
+
+    return count;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *float_arithm_base(unsigned int argc,
+    struct SExpression **argv, float_func_t func)
+{
+    double args[ARITHM_CHUNK_SIZE + 1];
+    unsigned int index = 0;
+    unsigned int count;
+    long position = 0;
+    double result;
+
+    count = read_floats(argc, argv, &index, &position, args,
+        ARITHM_CHUNK_SIZE + 1);
+    result = func(count, args);
+
+    /* Result is carried into the next chunk */
+    while ((count = read_floats(argc, argv, &index, &position, args + 1,
+        ARITHM_CHUNK_SIZE)) > 0)
+    {
+        args[0] = result;
+        result = func(count + 1, args);
+    }
+
+    return alloc_float(result);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Floating point version of func_compare_base.
+ *
+ * @param argc     Number of arguments.
+ * @param argv     Array of arguments.
+ * @param func     Comparison function pointer.
+ * @param pairwise If neighbouring values are compared.
+ *
+ * @return Result of comparison.
+ */
+static int float_compare_base(unsigned int argc, struct SExpression **argv,
+    float_func_t func, int pairwise)
+{
+    double args[ARITHM_CHUNK_SIZE + 1];
+    unsigned int index = 0;
+    unsigned int count;
+    long position = 0;
+    double result;
+    double first;
+    double last;
+
+    count = read_floats(argc, argv, &index, &position, args,
+        ARITHM_CHUNK_SIZE + 1);
+    result = func(count, args);
+
+    first = count ? args[0] : 0;
+    last = count ? args[count - 1] : 0;
+
+    while (result != 0 && (count = read_floats(argc, argv, &index, &position,
+        args + 1, ARITHM_CHUNK_SIZE)) > 0)
+    {
+        args[0] = pairwise ? last : first;
+        result = func(count + 1, args);
+        last = args[count];
     }
 
-    /* Call function to evaluate */
-    result = func(argc, argv);
+    return result != 0;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *func_arithm_base(unsigned int argc, struct SExpression **argv,
+    arithm_func_t func, float_func_t float_func)
+{
+    long args[ARITHM_CHUNK_SIZE + 1];
+    unsigned int index = 0;
+    unsigned int count;
+    long position = 0;
+    long result;
+
+    assert(func);
+    assert(float_func);
+
+    /* Integer arithmetic is used only for integers */
+    if (has_float(argc, argv))
+        return float_arithm_base(argc, argv, float_func);
 
-    /* Free arguments */
-    free(argv);
+    count = read_values(argc, argv, &index, &position, args,
+        ARITHM_CHUNK_SIZE + 1);
+    result = func(count, args);
 
-    /* Free argument expressions */
-    free_sexpr(expr->right);
-    expr->right = NULL;
+    /* Result is carried into the next chunk */
+    while ((count = read_values(argc, argv, &index, &position, args + 1,
+        ARITHM_CHUNK_SIZE)) > 0)
+    {
+        args[0] = result;
+        result = func(count + 1, args);
+    }
 
     /* Store result into expression */
-    sprintf(expr->lvalue, "%d", result);
+    return alloc_value(result);
+}
 
-    /* Result is value */
-    expr->type = TYPE_VALUE;
+/* ************************************************************************ */
 
-    return expr;
+struct SExpression *func_compare_base(unsigned int argc, struct SExpression **argv,
+    arithm_func_t func, float_func_t float_func, int pairwise)
+{
+    long args[ARITHM_CHUNK_SIZE + 1];
+    unsigned int index = 0;
+    unsigned int count;
+    long position = 0;
+    long result;
+    long first;
+    long last;
+
+    assert(func);
+    assert(float_func);
+
+    if (has_float(argc, argv))
+        return alloc_value(float_compare_base(argc, argv, float_func, pairwise));
+
+    count = read_values(argc, argv, &index, &position, args,
+        ARITHM_CHUNK_SIZE + 1);
+    result = func(count, args);
+
+    first = count ? args[0] : 0;
+    last = count ? args[count - 1] : 0;
+
+    while (result && (count = read_values(argc, argv, &index, &position,
+        args + 1, ARITHM_CHUNK_SIZE)) > 0)
+    {
+        args[0] = pairwise ? last : first;
+        result = func(count + 1, args);
+        last = args[count];
+    }
+
+    return alloc_value(result);
 }
 
 /* ************************************************************************ */
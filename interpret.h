@@ -31,20 +31,45 @@
 
 /* C library */
 #include <stdio.h>
+#include <setjmp.h>
 
 /* LISP */
 #include "desc.h"
 
+/* ************************************************************************ */
+/**
+ * @brief Maximum number of variables in one local frame (function parameters
+ * or LET bindings).
+ */
+#ifndef MAX_FRAME_SIZE
+#define MAX_FRAME_SIZE 16
+#endif
+
 /* ************************************************************************ */
 
 /**
- * @brief Function pointer type for evaluation function.
+ * @brief Function pointer type for builtin function.
  *
- * @param expr S-expression.
+ * @param argc Number of arguments.
+ * @param argv Array of evaluated arguments.
  *
  * @return Result S-expression.
  */
-typedef struct SExpression *(*func_t)(struct SExpression *expr);
+typedef struct SExpression *(*func_t)(unsigned int argc, struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Function pointer type for special form.
+ *
+ * Special form receives arguments unevaluated and returned expression is
+ * evaluated instead of the original one.
+ *
+ * @param expr Function name item followed by arguments.
+ *
+ * @return Expression for evaluation.
+ */
+typedef struct SExpression *(*special_t)(struct SExpression *expr);
 
 /* ************************************************************************ */
 
@@ -56,13 +81,94 @@ typedef struct SExpression *(*func_t)(struct SExpression *expr);
  *
  * @return Result value.
  */
-typedef int (*arithm_func_t)(unsigned int argc, int* argv);
+typedef long (*arithm_func_t)(unsigned int argc, long* argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Function pointer type for floating point arithmetic functions.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ *
+ * @return Result value.
+ */
+typedef double (*float_func_t)(unsigned int argc, double* argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Callback for enumeration of global variables and functions.
+ *
+ * @param name  Variable or function name.
+ * @param value Variable value or function definition.
+ * @param data  User data.
+ */
+typedef void (*entry_func_t)(const char *name, struct SExpression *value, void *data);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Handler of syntax error.
+ *
+ * @param err Error message.
+ */
+typedef void (*error_func_t)(const char *err);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Exit point of loop for RETURN.
+ */
+struct Block
+{
+    /** Return point. */
+    jmp_buf jump;
+
+    /** Enclosing block. */
+    struct Block *parent;
+
+    /** Number of values on the evaluation stack. */
+    unsigned int stack_count;
+
+    /** Number of pending calls. */
+    unsigned int call_count;
+
+    /** Current frame. */
+    int frame;
+
+    /** Number of frames. */
+    unsigned int frame_count;
+
+    /** Number of slots. */
+    unsigned int slot_count;
+
+    /** Nesting of recursive evaluation. */
+    unsigned int recursion;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Read top-level expression callback.
+ *
+ * @param expr   Compiled expression.
+ * @param line   Source line where expression ends.
+ * @param number Number of the source line.
+ * @param data   User data.
+ */
+typedef void (*form_func_t)(struct SExpression *expr, const char *line,
+    unsigned long number, void *data);
 
 /* ************************************************************************ */
 
 /**
  * @brief Syntax error function.
  *
+ * Error is printed to stderr. Evaluation of current line is aborted and
+ * `eval_line` returns normally, global variables and functions are kept.
+ * Outside of `eval_line` application exits.
+ *
  * @param err Error string.
  *
  * @return NORETURN
@@ -80,9 +186,28 @@ void eval_file(FILE *file);
 
 /* ************************************************************************ */
 
+/**
+ * @brief Evaluate all expressions from input and write results to output.
+ *
+ * Results are written one per line without prompts and evaluated commands.
+ * Errors are written to output too. Global variables and functions are
+ * kept between calls.
+ *
+ * @param input  Source file.
+ * @param output Output file.
+ *
+ * @return Number of errors.
+ */
+unsigned int eval_request(FILE *input, FILE *output);
+
+/* ************************************************************************ */
+
 /**
  * @brief Evaluate one "line" from current file and print result to stdout.
  *
+ * When evaluation fails, partially read and evaluated expressions are
+ * released and the line is skipped.
+ *
  * @return If there is no more expression. When line is evaluated function
  *         returns 0.
  */
@@ -90,6 +215,72 @@ int eval_line(void);
 
 /* ************************************************************************ */
 
+/**
+ * @brief Reads and compiles all expressions from file without evaluation.
+ *
+ * Expression passed to callback is released by garbage collector after
+ * the callback returns. Syntax errors are not printed.
+ *
+ * @param file Source file.
+ * @param func Callback for each top-level expression.
+ * @param data User data for callback.
+ *
+ * @return 0 on success, -1 on syntax error.
+ */
+int read_forms(FILE *file, form_func_t func, void *data);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Evaluates compiled expression and prints it like `eval_file`.
+ *
+ * @param expr   Compiled expression, it must be kept by caller.
+ * @param line   Source line printed as evaluated command.
+ * @param number Number of the source line.
+ */
+void eval_form(struct SExpression *expr, const char *line,
+    unsigned long number);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Enters block which can be left by `return_from_block`.
+ *
+ * Current evaluation state is stored into block. Caller must call
+ * `setjmp(block->jump)` and it must leave the block by `leave_block` in
+ * both cases.
+ *
+ * @param block Block.
+ */
+void enter_block(struct Block *block);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Leaves the innermost block.
+ *
+ * @param block Block.
+ *
+ * @return Value passed to `return_from_block` or NIL.
+ */
+struct SExpression *leave_block(struct Block *block);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns from the innermost block.
+ *
+ * Evaluation state is restored and execution continues from setjmp of the
+ * block.
+ *
+ * @param value Returned value.
+ *
+ * @return NORETURN
+ */
+void return_from_block(struct SExpression *value);
+
+/* ************************************************************************ */
+
 /**
  * @brief Evaluate list.
  *
@@ -102,7 +293,11 @@ struct SExpression *eval_list(enum Type quoted);
 /* ************************************************************************ */
 
 /**
- * @brief Evaluate whole S-expression.
+ * @brief Evaluate S-expression.
+ *
+ * Following expressions are ignored, expression itself is not modified.
+ * Nested function calls are kept on explicit stack, only special forms
+ * and function bodies use recursion.
  *
  * @param expr Source S-expression.
  *
@@ -112,6 +307,233 @@ struct SExpression *eval_sexpr(struct SExpression *expr);
 
 /* ************************************************************************ */
 
+/**
+ * @brief Calls function with evaluated arguments.
+ *
+ * @param func Lambda or quoted name of builtin or user function.
+ * @param argc Number of arguments.
+ * @param argv Arguments, they must be reachable by garbage collector.
+ *
+ * @return Result S-expression.
+ */
+struct SExpression *apply_function(struct SExpression *func, unsigned int argc,
+    struct SExpression **argv);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Starts parallel task.
+ *
+ * Global variables and functions cannot be changed until the task ends
+ * because changes in worker process would be lost. RETURN cannot leave
+ * the task. Syntax error ends all tasks.
+ *
+ * @param error Handler of syntax errors for task in worker process, it
+ * must not return. NULL for task in this process.
+ *
+ * @return Enclosing block which is restored by `end_task`.
+ */
+struct Block *begin_task(error_func_t error);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Ends parallel task started by `begin_task`.
+ *
+ * @param block Block returned by `begin_task`.
+ */
+void end_task(struct Block *block);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Define user function.
+ *
+ * If function with same name exists, definition is replaced. Builtin
+ * functions cannot be replaced.
+ *
+ * @param name   Function name.
+ * @param lambda Parameter list item followed by body forms.
+ */
+void set_function(const char* name, struct SExpression *lambda);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Set maximum nesting depth of read lists, pending calls and
+ * recursive evaluation.
+ *
+ * @param depth Maximum depth.
+ */
+void set_max_depth(unsigned int depth);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns maximum nesting depth.
+ *
+ * @return Maximum depth.
+ */
+unsigned int get_max_depth(void);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Sets C stack available for recursive evaluation, deeper
+ * evaluation is reported as syntax error.
+ *
+ * @param base Address at the start of the stack.
+ * @param size Usable size of the stack in bytes, 0 if it isn't checked.
+ */
+void set_stack_limit(const void *base, unsigned long size);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds a new local variables frame enclosed by current frame.
+ *
+ * Frame is removed when evaluation of current form finishes or it is
+ * replaced by frame of function called in tail position. All slots are set to NIL.
+ *
+ * @param size Number of variables.
+ */
+void push_frame(unsigned int size);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns local variable value.
+ *
+ * @param depth Number of enclosing frames to skip.
+ * @param slot  Variable slot in the frame.
+ *
+ * @return Variable value.
+ */
+struct SExpression *get_local(unsigned int depth, unsigned int slot);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Set local variable value.
+ *
+ * @param depth Number of enclosing frames to skip.
+ * @param slot  Variable slot in the frame.
+ * @param value Variable value.
+ */
+void set_local(unsigned int depth, unsigned int slot, struct SExpression *value);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Pushes value on the evaluation stack.
+ *
+ * Values on the stack are reachable by garbage collector. Stack is restored
+ * when evaluation of current form finishes.
+ *
+ * @param value S-expression.
+ */
+void push_value(struct SExpression *value);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Removes values from the evaluation stack.
+ *
+ * @param count Number of values.
+ */
+void pop_values(unsigned int count);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates lazy sequence.
+ *
+ * Values of visible local variables are captured so body can be evaluated
+ * later.
+ *
+ * @param body Body forms or NULL.
+ *
+ * @return Lazy sequence.
+ */
+struct SExpression *make_lazy(struct SExpression *body);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates function object.
+ *
+ * Values of visible local variables are captured so body can refer to them
+ * when the function is called.
+ *
+ * @param def Parameter list item followed by body.
+ *
+ * @return Function object.
+ */
+struct SExpression *make_lambda(struct SExpression *def);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Evaluates lazy sequence.
+ *
+ * Body is evaluated only once, its result is stored in the lazy sequence.
+ * Results which are lazy sequences are evaluated too.
+ *
+ * @param expr Lazy sequence or any other expression.
+ *
+ * @return Expression which is not a lazy sequence.
+ */
+struct SExpression *force(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns integer value of S-expression.
+ *
+ * @param expr S-expression.
+ *
+ * @return Integer value or 0 if expression is not a number.
+ */
+long get_value(const struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns floating point value of S-expression.
+ *
+ * @param expr S-expression.
+ *
+ * @return Value or 0 if expression is not a number.
+ */
+double get_float(const struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates number expression.
+ *
+ * Small numbers are shared preallocated expressions so integer loops and
+ * arithmetic don't allocate.
+ *
+ * @param value Number.
+ *
+ * @return Expression.
+ */
+struct SExpression *alloc_value(long value);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates floating point number expression.
+ *
+ * @param value Number.
+ *
+ * @return Expression.
+ */
+struct SExpression *alloc_float(double value);
+
+/* ************************************************************************ */
+
 /**
  * @brief Set variable value.
  *
@@ -120,7 +542,7 @@ struct SExpression *eval_sexpr(struct SExpression *expr);
  * @param name  Variable name.
  * @param value Variable value.
  */
-void set_variable(const char* name, int value);
+void set_variable(const char* name, struct SExpression *value);
 
 /* ************************************************************************ */
 
@@ -140,9 +562,24 @@ int has_variable(const char* name);
  *
  * @param name Variable name.
  *
- * @return Variable value or 0 if variable doesn't exists.
+ * @return Variable value or NIL if variable doesn't exists.
+ */
+struct SExpression *get_variable(const char* name);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns value of global variable referenced by symbol item.
+ *
+ * Place of the variable is cached in the item (slot + 1 and version in
+ * `slot` and `depth` members) so repeated evaluation doesn't search
+ * variables by name.
+ *
+ * @param item Symbol item.
+ *
+ * @return Variable value or NIL if variable doesn't exists.
  */
-int get_variable(const char* name);
+struct SExpression *get_global(struct SExpression *item);
 
 /* ************************************************************************ */
 
@@ -155,6 +592,28 @@ void unset_variable(const char* name);
 
 /* ************************************************************************ */
 
+/**
+ * @brief Calls function for all global variables.
+ *
+ * @param func Callback function.
+ * @param data User data passed to callback.
+ */
+void for_each_variable(entry_func_t func, void *data);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Calls function for all user defined functions.
+ *
+ * Definition is parameter list item followed by body forms.
+ *
+ * @param func Callback function.
+ * @param data User data passed to callback.
+ */
+void for_each_function(entry_func_t func, void *data);
+
+/* ************************************************************************ */
+
 /**
  * @brief Cleanup interpreter.
  *
@@ -167,15 +626,55 @@ void clean_up(void);
 /**
  * @brief Helper function for arithmetic operations.
  *
- * @param expr Source S-expression.
- * @param func Arithmetic function pointer.
+ * Ranges are expanded into values. Function is called for chunks of values
+ * and the result of previous chunk is passed as the first value. If any
+ * argument is a floating point number, all values are converted to double.
  *
- * @note `func` function cannot exit application because it will cause
- * memory-leak for arguments.
+ * @param argc       Number of arguments.
+ * @param argv       Array of arguments.
+ * @param func       Arithmetic function pointer.
+ * @param float_func Floating point arithmetic function pointer.
  *
  * @return Result S-expression.
  */
-struct SExpression *func_arithm_base(struct SExpression *expr, arithm_func_t func);
+struct SExpression *func_arithm_base(unsigned int argc, struct SExpression **argv,
+    arithm_func_t func, float_func_t float_func);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Floating point version of func_arithm_base, all values are
+ * converted to double.
+ *
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @param func Arithmetic function pointer.
+ *
+ * @return Result S-expression.
+ */
+struct SExpression *float_arithm_base(unsigned int argc,
+    struct SExpression **argv, float_func_t func);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Helper function for comparisons.
+ *
+ * Ranges are expanded into values. Function is called for chunks of values
+ * while the result is true, the first value of chunk is the first argument
+ * or the last value of previous chunk. If any argument is a floating point
+ * number, all values are compared as double.
+ *
+ * @param argc       Number of arguments.
+ * @param argv       Array of arguments.
+ * @param func       Comparison function pointer.
+ * @param float_func Floating point comparison function pointer.
+ * @param pairwise   If neighbouring values are compared.
+ *
+ * @return Result S-expression (1 or 0).
+ */
+struct SExpression *func_compare_base(unsigned int argc, struct SExpression **argv,
+    arithm_func_t func, float_func_t float_func, int pairwise);
 
 /* ************************************************************************ */
 
@@ -0,0 +1,748 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+/* Feature test macros */
+#define _DEFAULT_SOURCE
+
+/* Declaration */
+#include "jit.h"
+
+/* C library */
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX */
+#include <sys/mman.h>
+
+/* LISP */
+#include "interpret.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Code index of forms which cannot be compiled.
+ */
+#define JIT_NONE 0xFFFF
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum number of compiled forms.
+ */
+#define JIT_MAX_CODES (JIT_NONE - 1)
+
+/* ************************************************************************ */
+
+/**
+ * @brief Compiled function. It returns value of arithmetic form or 0/1 for
+ * comparison.
+ */
+typedef long (*jit_func_t)(void);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Compiled form.
+ */
+struct Code
+{
+    /** Function name item of the form. */
+    const struct SExpression *head;
+
+    /** If result is boolean. */
+    int boolean;
+
+    /** Compiled function. */
+    jit_func_t func;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Operator of compiled form.
+ */
+enum Op
+{
+    OP_ADD,
+    OP_SUB,
+    OP_MULT,
+    OP_DIV,
+    OP_EQ,
+    OP_NEQ,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_INVALID
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Operator names.
+ */
+static const char *const l_op_names[OP_INVALID] = {
+    "+", "-", "*", "/", "=", "/=", "<", "<=", ">", ">="
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Second byte of SETcc instruction for comparison operators.
+ */
+static const unsigned char l_setcc[OP_INVALID] = {
+    0, 0, 0, 0, 0x94, 0x95, 0x9C, 0x9E, 0x9F, 0x9D
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief If compilation is enabled.
+ */
+static int l_enabled = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of evaluations before compilation.
+ */
+static unsigned int l_threshold = JIT_THRESHOLD;
+
+/* ************************************************************************ */
+
+/**
+ * @brief If compiled code loaded a value it cannot handle.
+ */
+static int l_fallback = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Executable buffer.
+ */
+static unsigned char *l_buffer = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Used size of executable buffer.
+ */
+static size_t l_buffer_size = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Compiled forms.
+ */
+static struct Code *l_codes = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of compiled forms.
+ */
+static unsigned int l_code_count = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of allocated compiled forms.
+ */
+static unsigned int l_code_capacity = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Code which is being generated.
+ */
+struct Emitter
+{
+    /** Start of code. */
+    unsigned char *code;
+
+    /** Size of code. */
+    size_t size;
+
+    /** Maximum size of code. */
+    size_t capacity;
+
+    /** Number of 8-byte values pushed on machine stack. */
+    unsigned int depth;
+
+    /** Code doesn't fit into buffer. */
+    int overflow;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Finds operator of form.
+ *
+ * @param head Function name item.
+ *
+ * @return Operator or OP_INVALID.
+ */
+static enum Op find_op(const struct SExpression *head)
+{
+    int op;
+
+    /* Numbers and strings are not names */
+    if (head->list || head->type != TYPE_SYMBOL)
+        return OP_INVALID;
+
+    for (op = 0; op < OP_INVALID; ++op)
+    {
+        if (!strcmp(head->lvalue, l_op_names[op]))
+            return (enum Op) op;
+    }
+
+    return OP_INVALID;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns numeric value of global variable.
+ *
+ * Called from compiled code.
+ *
+ * @param item Variable reference.
+ *
+ * @return Value.
+ */
+static long load_global(struct SExpression *item)
+{
+    const struct SExpression *value = get_global(item);
+
+    /* Ranges, vectors and floating point numbers are handled by
+     * interpreter, result is thrown away */
+    if (value->type == TYPE_RANGE || value->type == TYPE_VECTOR ||
+        value->type == TYPE_FLOAT)
+    {
+        l_fallback = 1;
+        return 1;
+    }
+
+    return get_value(value);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Division with remainder or overflow is evaluated by interpreter
+ * which gives floating point number.
+ *
+ * Called from compiled code.
+ *
+ * @return Zero as the rest of thrown away result.
+ */
+static long inexact_division(void)
+{
+    l_fallback = 1;
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reports division by zero.
+ *
+ * Called from compiled code.
+ */
+static void division_by_zero(void)
+{
+    syntax_error("Division by zero");
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Checks if form can be compiled.
+ *
+ * @param expr  Form.
+ * @param depth Nesting of the form.
+ *
+ * @return If form can be compiled.
+ */
+static int is_compilable(const struct SExpression *expr, unsigned int depth)
+{
+    const struct SExpression *item;
+    enum Op op = find_op(expr->list);
+
+    if (op == OP_INVALID || depth == JIT_MAX_DEPTH)
+        return 0;
+
+    /* Nested comparison would be a number */
+    if (depth > 0 && op >= OP_EQ)
+        return 0;
+
+    for (item = expr->list->right; item != NULL; item = item->right)
+    {
+        if (item->type == TYPE_SEXPR)
+        {
+            if (!is_compilable(item, depth + 1))
+                return 0;
+        }
+        else if (item->type != TYPE_VALUE && item->type != TYPE_SYMBOL)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Appends bytes into code.
+ *
+ * @param emitter Code.
+ * @param bytes   Bytes.
+ * @param count   Number of bytes.
+ */
+static void emit(struct Emitter *emitter, const void *bytes, size_t count)
+{
+    if (emitter->size + count > emitter->capacity)
+    {
+        emitter->overflow = 1;
+        return;
+    }
+
+    memcpy(emitter->code + emitter->size, bytes, count);
+    emitter->size += count;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Appends instruction with 32-bit operand.
+ *
+ * @param emitter Code.
+ * @param opcode  Instruction bytes without operand.
+ * @param count   Number of instruction bytes.
+ * @param value   Operand.
+ */
+static void emit32(struct Emitter *emitter, const char *opcode, size_t count,
+    unsigned int value)
+{
+    unsigned char operand[4];
+
+    operand[0] = value & 0xFF;
+    operand[1] = (value >> 8) & 0xFF;
+    operand[2] = (value >> 16) & 0xFF;
+    operand[3] = (value >> 24) & 0xFF;
+
+    emit(emitter, opcode, count);
+    emit(emitter, operand, 4);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Appends instruction with 64-bit operand.
+ *
+ * @param emitter Code.
+ * @param opcode  Instruction bytes without operand.
+ * @param count   Number of instruction bytes.
+ * @param value   Operand.
+ */
+static void emit64(struct Emitter *emitter, const char *opcode, size_t count,
+    unsigned long value)
+{
+    unsigned char operand[8];
+    int i;
+
+    for (i = 0; i < 8; ++i)
+        operand[i] = (value >> (8 * i)) & 0xFF;
+
+    emit(emitter, opcode, count);
+    emit(emitter, operand, 8);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Appends instruction with [rsp + offset] operand of pushed value.
+ *
+ * @param emitter Code.
+ * @param opcode  Instruction bytes with ModRM byte (SIB follows).
+ * @param count   Number of instruction bytes.
+ * @param index   Index of pushed value from stack top.
+ */
+static void emit_stack(struct Emitter *emitter, const char *opcode, size_t count,
+    unsigned int index)
+{
+    emit(emitter, opcode, count);
+    emit32(emitter, "\x24", 1, 8 * index);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Appends call of C function with one pointer argument.
+ *
+ * @param emitter  Code.
+ * @param func     Function address.
+ * @param argument Argument.
+ */
+static void emit_call(struct Emitter *emitter, void (*func)(void), const void *argument)
+{
+    /* Stack must be aligned to 16 bytes */
+    if (emitter->depth % 2)
+        emit(emitter, "\x48\x83\xEC\x08", 4);
+
+    /* mov rdi, argument */
+    emit64(emitter, "\x48\xBF", 2, (unsigned long) argument);
+
+    /* mov rax, func; call rax */
+    emit64(emitter, "\x48\xB8", 2, (unsigned long) func);
+    emit(emitter, "\xFF\xD0", 2);
+
+    if (emitter->depth % 2)
+        emit(emitter, "\x48\x83\xC4\x08", 4);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Generates code which stores value of form into rax.
+ *
+ * Arguments are evaluated one by one and pushed on machine stack, then
+ * they are combined same way as arithmetic functions do it.
+ *
+ * @param emitter Code.
+ * @param expr    Form.
+ */
+static void emit_form(struct Emitter *emitter, const struct SExpression *expr)
+{
+    const struct SExpression *item;
+    enum Op op = find_op(expr->list);
+    unsigned int argc = 0;
+    unsigned int i;
+
+    for (item = expr->list->right; item != NULL; item = item->right)
+    {
+        if (item->type == TYPE_SEXPR)
+        {
+            emit_form(emitter, item);
+        }
+        else if (item->type == TYPE_VALUE)
+        {
+            /* mov rax, value */
+            emit64(emitter, "\x48\xB8", 2, (unsigned long) get_value(item));
+        }
+        else if (!strcmp(item->lvalue, "T"))
+        {
+            /* T is not a number */
+            emit32(emitter, "\xB8", 1, 0);
+        }
+        else
+        {
+            emit_call(emitter, (void (*)(void)) load_global, item);
+        }
+
+        /* push rax */
+        emit(emitter, "\x50", 1);
+        ++emitter->depth;
+        ++argc;
+    }
+
+    /* Argument i is at [rsp + 8 * (argc - 1 - i)] */
+    if (argc == 0)
+    {
+        emit32(emitter, "\xB8", 1, (op == OP_MULT || op >= OP_EQ) ? 1 : 0);
+        return;
+    }
+
+    if (op == OP_DIV)
+    {
+        for (i = 1; i < argc; ++i)
+        {
+            /* Size of call with alignment */
+            unsigned char skip = 22 + (emitter->depth % 2) * 8;
+
+            /* cmp qword [rsp + offset], 0; jne over the call */
+            emit_stack(emitter, "\x48\x83\xBC", 3, argc - 1 - i);
+            emit(emitter, "\x00", 1);
+            emit(emitter, "\x75", 1);
+            emit(emitter, &skip, 1);
+            emit_call(emitter, division_by_zero, NULL);
+        }
+    }
+
+    if (op < OP_EQ)
+    {
+        /* mov rax, [rsp + offset] */
+        emit_stack(emitter, "\x48\x8B\x84", 3, argc - 1);
+
+        for (i = 1; i < argc; ++i)
+        {
+            if (op == OP_ADD)
+            {
+                /* add rax, [rsp + offset] */
+                emit_stack(emitter, "\x48\x03\x84", 3, argc - 1 - i);
+            }
+            else if (op == OP_SUB)
+            {
+                /* sub rax, [rsp + offset] */
+                emit_stack(emitter, "\x48\x2B\x84", 3, argc - 1 - i);
+            }
+            else if (op == OP_MULT)
+            {
+                /* imul rax, [rsp + offset] */
+                emit_stack(emitter, "\x48\x0F\xAF\x84", 4, argc - 1 - i);
+            }
+            else
+            {
+                /* Size of call with alignment */
+                unsigned char skip = 22 + (emitter->depth % 2) * 8;
+                unsigned char negate = 7 + skip;
+                unsigned char divide = 15 + skip;
+
+                /* Division by -1 is negation, LONG_MIN overflows */
+
+                /* cmp qword [rsp + offset], -1; jne over the negation */
+                emit_stack(emitter, "\x48\x83\xBC", 3, argc - 1 - i);
+                emit(emitter, "\xFF\x75", 2);
+                emit(emitter, &negate, 1);
+
+                /* neg rax; jno over the call */
+                emit(emitter, "\x48\xF7\xD8\x71", 4);
+                emit(emitter, &skip, 1);
+                emit_call(emitter, (void (*)(void)) inexact_division, NULL);
+
+                /* jmp over the division */
+                emit(emitter, "\xEB", 1);
+                emit(emitter, &divide, 1);
+
+                /* cqo; idiv qword [rsp + offset] */
+                emit(emitter, "\x48\x99", 2);
+                emit_stack(emitter, "\x48\xF7\xBC", 3, argc - 1 - i);
+
+                /* test rdx, rdx; je over the call */
+                emit(emitter, "\x48\x85\xD2\x74", 4);
+                emit(emitter, &skip, 1);
+                emit_call(emitter, (void (*)(void)) inexact_division, NULL);
+            }
+        }
+    }
+    else
+    {
+        /* mov esi, 1 */
+        emit32(emitter, "\xBE", 1, 1);
+
+        for (i = 1; i < argc; ++i)
+        {
+            unsigned char setcc[3];
+
+            setcc[0] = 0x0F;
+            setcc[1] = l_setcc[op];
+            setcc[2] = 0xC1;
+
+            /* Equality compares with the first argument, ordering with
+             * the previous one */
+            if (op == OP_EQ || op == OP_NEQ)
+                emit_stack(emitter, "\x48\x8B\x8C", 3, argc - 1);
+            else
+                emit_stack(emitter, "\x48\x8B\x8C", 3, argc - i);
+
+            /* cmp rcx, [rsp + offset]; setcc cl; movzx ecx, cl; and esi, ecx */
+            emit_stack(emitter, "\x48\x3B\x8C", 3, argc - 1 - i);
+            emit(emitter, setcc, 3);
+            emit(emitter, "\x0F\xB6\xC9\x21\xCE", 5);
+        }
+
+        /* mov eax, esi */
+        emit(emitter, "\x89\xF0", 2);
+    }
+
+    /* add rsp, 8 * argc */
+    emit32(emitter, "\x48\x81\xC4", 3, 8 * argc);
+    emitter->depth -= argc;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Compiles form into executable buffer.
+ *
+ * @param expr Form.
+ *
+ * @return Code index + 1 or JIT_NONE.
+ */
+static unsigned short compile(const struct SExpression *expr)
+{
+    struct Emitter emitter;
+    struct Code *code;
+
+    if (!is_compilable(expr, 0) || l_code_count == JIT_MAX_CODES)
+        return JIT_NONE;
+
+    /* Buffer is allocated on first compilation */
+    if (l_buffer == NULL)
+    {
+        void *buffer = mmap(NULL, JIT_BUFFER_SIZE, PROT_READ | PROT_EXEC,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (buffer == MAP_FAILED)
+        {
+            l_enabled = 0;
+            return JIT_NONE;
+        }
+
+        l_buffer = buffer;
+    }
+
+    if (l_code_count == l_code_capacity)
+    {
+        unsigned int capacity = l_code_capacity ? 2 * l_code_capacity : 64;
+        struct Code *tmp = realloc(l_codes, capacity * sizeof(struct Code));
+
+        if (tmp == NULL)
+            return JIT_NONE;
+
+        l_codes = tmp;
+        l_code_capacity = capacity;
+    }
+
+    /* Buffer is never writable and executable at once */
+    if (mprotect(l_buffer, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE))
+        return JIT_NONE;
+
+    emitter.code = l_buffer + l_buffer_size;
+    emitter.size = 0;
+    emitter.capacity = JIT_BUFFER_SIZE - l_buffer_size;
+    emitter.depth = 0;
+    emitter.overflow = 0;
+
+    /* push rbp; mov rbp, rsp */
+    emit(&emitter, "\x55\x48\x89\xE5", 4);
+
+    emit_form(&emitter, expr);
+
+    /* pop rbp; ret */
+    emit(&emitter, "\x5D\xC3", 2);
+
+    mprotect(l_buffer, JIT_BUFFER_SIZE, PROT_READ | PROT_EXEC);
+
+    if (emitter.overflow)
+        return JIT_NONE;
+
+    code = &l_codes[l_code_count];
+    code->head = expr->list;
+    code->boolean = find_op(expr->list) >= OP_EQ;
+    code->func = (jit_func_t) (void *) emitter.code;
+
+    /* Functions start at 16 bytes */
+    l_buffer_size += (emitter.size + 15) & ~(size_t) 15;
+
+    return ++l_code_count;
+}
+
+/* ************************************************************************ */
+
+int jit_enable(unsigned int threshold)
+{
+#if defined(__x86_64__) && !defined(_WIN32)
+    l_enabled = 1;
+    l_threshold = threshold;
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/* ************************************************************************ */
+
+struct SExpression *jit_eval(struct SExpression *expr)
+{
+    struct SExpression *head = expr->list;
+    const struct Code *code;
+    long result;
+
+    if (!l_enabled || head->slot == JIT_NONE || head->list)
+        return NULL;
+
+    /* Count evaluations */
+    if (head->slot == 0)
+    {
+        if (++head->depth < l_threshold)
+            return NULL;
+
+        head->slot = compile(expr);
+
+        if (head->slot == JIT_NONE)
+            return NULL;
+    }
+
+    /* Code index from image of another process */
+    if (head->slot > l_code_count || l_codes[head->slot - 1].head != head)
+    {
+        head->slot = 0;
+        head->depth = 0;
+        return NULL;
+    }
+
+    code = &l_codes[head->slot - 1];
+
+    l_fallback = 0;
+    result = code->func();
+
+    /* Form is evaluated by interpreter from now on */
+    if (l_fallback)
+    {
+        head->slot = JIT_NONE;
+        return NULL;
+    }
+
+    if (code->boolean)
+        return result ? &sexpr_true : &sexpr_nil;
+
+    return alloc_value(result);
+}
+
+/* ************************************************************************ */
+
+void jit_free_all(void)
+{
+    if (l_buffer)
+        munmap(l_buffer, JIT_BUFFER_SIZE);
+
+    free(l_codes);
+
+    l_buffer = NULL;
+    l_buffer_size = 0;
+    l_codes = NULL;
+    l_code_count = 0;
+    l_code_capacity = 0;
+    l_enabled = 0;
+}
+
+/* ************************************************************************ */
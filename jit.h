@@ -0,0 +1,103 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+
+#ifndef JIT_H_
+#define JIT_H_
+
+/* ************************************************************************ */
+
+/* LISP */
+#include "desc.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Default number of evaluations of a form before it's compiled.
+ */
+#ifndef JIT_THRESHOLD
+#define JIT_THRESHOLD 100
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Size of executable buffer for compiled code.
+ */
+#ifndef JIT_BUFFER_SIZE
+#define JIT_BUFFER_SIZE (4 * 1024 * 1024)
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum nesting of compiled arithmetic forms.
+ */
+#ifndef JIT_MAX_DEPTH
+#define JIT_MAX_DEPTH 64
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Enables compilation of arithmetic forms into native code.
+ *
+ * Forms made only of `+ - * / = /= < <= > >=` with number literals, global
+ * variables and nested arithmetic forms as arguments are compiled when
+ * they are evaluated `threshold` times. Other forms are interpreted.
+ *
+ * @param threshold Number of evaluations before compilation (1 - 65535).
+ *
+ * @return 0 on success, -1 if compilation is not supported.
+ */
+int jit_enable(unsigned int threshold);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Evaluates form by compiled code.
+ *
+ * Form is counted and compiled when it reaches threshold.
+ *
+ * @param expr Form (TYPE_SEXPR).
+ *
+ * @return Result or NULL if form must be interpreted.
+ */
+struct SExpression *jit_eval(struct SExpression *expr);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Releases compiled code.
+ */
+void jit_free_all(void);
+
+/* ************************************************************************ */
+
+#endif /* JIT_H_ */
+
+/* ************************************************************************ */
@@ -24,14 +24,83 @@
 /*                                                                          */
 /* ************************************************************************ */
 
+/* Feature test macros */
+#define _POSIX_C_SOURCE 200809L
+
 /* C library */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <signal.h>
 
+/* POSIX */
+#include <pthread.h>
+#include <sys/resource.h>
+
 /* LISP */
 #include "tokenizer.h"
 #include "interpret.h"
+#include "server.h"
+#include "image.h"
+#include "jit.h"
+#include "trace.h"
+#include "profile.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Default number of server worker processes.
+ */
+#ifndef DEFAULT_WORKERS
+#define DEFAULT_WORKERS 4
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief C stack reserved for one level of recursive evaluation.
+ */
+#ifndef STACK_SIZE_PER_DEPTH
+#define STACK_SIZE_PER_DEPTH 1024
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief C stack which isn't used by recursive evaluation.
+ */
+#ifndef STACK_RESERVE
+#define STACK_RESERVE (1024 * 1024)
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief What is evaluated.
+ */
+struct Options
+{
+    /** Source file or NULL. */
+    const char *source;
+
+    /** Server socket or NULL. */
+    const char *socket_path;
+
+    /** Image or NULL. */
+    const char *image;
+
+    /** If the source is compiled into cache. */
+    int cache;
+
+    /** Number of server workers. */
+    int workers;
+
+    /** Size of C stack for recursive evaluation. */
+    unsigned long stack_size;
+
+    /** Exit status. */
+    int status;
+};
 
 /* ************************************************************************ */
 
@@ -49,26 +118,36 @@ static void exit_handler(void)
 /* ************************************************************************ */
 
 /**
- * @brief Main function.
+ * @brief Loads image and evaluates the source or serves requests.
  *
- * @param argc Argument count.
- * @param argv Argument values.
+ * @param options What is evaluated.
+ *
+ * @return Exit status.
  */
-int main(int argc, char **argv)
+static int evaluate(const struct Options *options)
 {
-#ifndef NDEBUG
-    atexit(exit_handler);
-#endif
+    /* Restore saved state */
+    if (options->image && load_image(options->image))
+        return EXIT_FAILURE;
 
     /* Source file as argument */
-    if (argc > 1)
+    if (options->source && options->cache)
+    {
+        /* Evaluate compiled file */
+        if (eval_cached(options->source))
+        {
+            perror(options->source);
+            return EXIT_FAILURE;
+        }
+    }
+    else if (options->source)
     {
         /* Open source file */
-        FILE *f = fopen(argv[1], "r");
+        FILE *f = fopen(options->source, "r");
 
         if (f == NULL)
         {
-            perror(argv[1]);
+            perror(options->source);
             return EXIT_FAILURE;
         }
 
@@ -78,13 +157,278 @@ int main(int argc, char **argv)
         /* Close file */
         fclose(f);
     }
-    else
+    else if (!options->socket_path)
     {
         /* Input from standard input */
         eval_file(stdin);
     }
 
+    /* Serve requests */
+    if (options->socket_path)
+        return serve(options->socket_path, options->workers) ?
+            EXIT_FAILURE : EXIT_SUCCESS;
+
     return EXIT_SUCCESS;
 }
 
 /* ************************************************************************ */
+
+/**
+ * @brief Body of evaluation thread.
+ *
+ * @param data Options.
+ *
+ * @return NULL.
+ */
+static void *evaluation_thread(void *data)
+{
+    struct Options *options = (struct Options *) data;
+    char base;
+
+    set_stack_limit(&base, options->stack_size);
+    options->status = evaluate(options);
+
+    return NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Evaluates on a thread whose stack fits the maximum depth of
+ * recursive evaluation. If the thread cannot be created, the current stack
+ * is used up to its limit.
+ *
+ * @param options What is evaluated.
+ *
+ * @return Exit status.
+ */
+static int run(struct Options *options)
+{
+    unsigned int depth = get_max_depth();
+    pthread_attr_t attr;
+    pthread_t thread;
+    struct rlimit limit;
+    char base;
+
+    options->stack_size = (unsigned long) depth * STACK_SIZE_PER_DEPTH;
+
+    /* Thread isn't used when size of its stack would overflow */
+    if (depth < ((size_t) -1 - STACK_RESERVE) / STACK_SIZE_PER_DEPTH &&
+        !pthread_attr_init(&attr))
+    {
+        size_t size = STACK_RESERVE + (size_t) depth * STACK_SIZE_PER_DEPTH;
+        int created = !pthread_attr_setstacksize(&attr, size) &&
+            !pthread_create(&thread, &attr, &evaluation_thread, options);
+
+        pthread_attr_destroy(&attr);
+
+        if (created)
+        {
+            sigset_t mask;
+
+            /* Signals for the process are received by evaluation thread */
+            sigfillset(&mask);
+            pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+            pthread_join(thread, NULL);
+            return options->status;
+        }
+    }
+
+    if (!getrlimit(RLIMIT_STACK, &limit) && limit.rlim_cur != RLIM_INFINITY &&
+        limit.rlim_cur > STACK_RESERVE)
+        set_stack_limit(&base, (unsigned long) (limit.rlim_cur - STACK_RESERVE));
+
+    return evaluate(options);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Main function.
+ *
+ * Usage: lisp [--max-depth N] [--image image] [--no-cache]
+ *             [--jit] [--jit-threshold N]
+ *             [--trace file [--trace-rate N] [--trace-depth N]]
+ *             [--sample-profile file [--sample-rate N]]
+ *             [--serve socket [--workers N]] [file]
+ *
+ * `--max-depth` limits nesting of read lists, pending calls and recursive
+ * evaluation, which runs on a thread with stack of matching size.
+ * Image is loaded before the file is evaluated. The file is compiled into
+ * "file.lispc" unless `--no-cache` is given. With `--jit` arithmetic forms
+ * are compiled into native code after N evaluations (`--jit-threshold`).
+ * With `--trace` top-level forms and builtin calls are written in Chrome
+ * trace-event format. Every N-th form is traced (`--trace-rate`) and calls
+ * deeper than N are left out (`--trace-depth`).
+ * With `--sample-profile` Lisp call stacks are sampled N times per second
+ * of CPU time (`--sample-rate`) and written as folded stacks at exit.
+ * In server mode the file is evaluated before workers are started.
+ *
+ * @param argc Argument count.
+ * @param argv Argument values.
+ */
+int main(int argc, char **argv)
+{
+    const char *source = NULL;
+    const char *socket_path = NULL;
+    const char *image = NULL;
+    int cache = 1;
+    int jit = 0;
+    int jit_threshold = JIT_THRESHOLD;
+    int workers = DEFAULT_WORKERS;
+    const char *trace = NULL;
+    int trace_rate = 1;
+    int trace_depth = 0;
+    const char *profile = NULL;
+    int profile_rate = PROFILE_DEFAULT_RATE;
+    struct Options options;
+    int i;
+
+#ifndef NDEBUG
+    atexit(exit_handler);
+#endif
+
+    /* Options */
+    for (i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--max-depth"))
+        {
+            if (i + 1 == argc || atoi(argv[i + 1]) <= 0)
+            {
+                fprintf(stderr, "Invalid maximum depth\n");
+                return EXIT_FAILURE;
+            }
+
+            set_max_depth(atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--serve"))
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "Missing socket path\n");
+                return EXIT_FAILURE;
+            }
+
+            socket_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--image"))
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "Missing image path\n");
+                return EXIT_FAILURE;
+            }
+
+            image = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--no-cache"))
+        {
+            cache = 0;
+        }
+        else if (!strcmp(argv[i], "--jit"))
+        {
+            jit = 1;
+        }
+        else if (!strcmp(argv[i], "--jit-threshold"))
+        {
+            if (i + 1 == argc || atoi(argv[i + 1]) <= 0 || atoi(argv[i + 1]) > 65535)
+            {
+                fprintf(stderr, "Invalid JIT threshold\n");
+                return EXIT_FAILURE;
+            }
+
+            jit = 1;
+            jit_threshold = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--trace"))
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "Missing trace path\n");
+                return EXIT_FAILURE;
+            }
+
+            trace = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--trace-rate"))
+        {
+            if (i + 1 == argc || atoi(argv[i + 1]) <= 0)
+            {
+                fprintf(stderr, "Invalid trace rate\n");
+                return EXIT_FAILURE;
+            }
+
+            trace_rate = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--trace-depth"))
+        {
+            if (i + 1 == argc || atoi(argv[i + 1]) <= 0)
+            {
+                fprintf(stderr, "Invalid trace depth\n");
+                return EXIT_FAILURE;
+            }
+
+            trace_depth = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--sample-profile"))
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "Missing profile path\n");
+                return EXIT_FAILURE;
+            }
+
+            profile = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--sample-rate"))
+        {
+            if (i + 1 == argc || atoi(argv[i + 1]) <= 0)
+            {
+                fprintf(stderr, "Invalid sample rate\n");
+                return EXIT_FAILURE;
+            }
+
+            profile_rate = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--workers"))
+        {
+            if (i + 1 == argc || atoi(argv[i + 1]) <= 0)
+            {
+                fprintf(stderr, "Invalid number of workers\n");
+                return EXIT_FAILURE;
+            }
+
+            workers = atoi(argv[++i]);
+        }
+        else
+        {
+            source = argv[i];
+        }
+    }
+
+    if (jit && jit_enable(jit_threshold))
+        fprintf(stderr, "JIT is not supported on this platform\n");
+
+    if (trace && trace_open(trace, trace_rate, trace_depth))
+    {
+        perror(trace);
+        return EXIT_FAILURE;
+    }
+
+    if (profile && profile_open(profile, (unsigned int) profile_rate))
+    {
+        perror(profile);
+        return EXIT_FAILURE;
+    }
+
+    options.source = source;
+    options.socket_path = socket_path;
+    options.image = image;
+    options.cache = cache;
+    options.workers = workers;
+
+    return run(&options);
+}
+
+/* ************************************************************************ */
@@ -0,0 +1,444 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+/* Feature test macros */
+#define _DEFAULT_SOURCE
+
+/* Declaration */
+#include "pool.h"
+
+/* C library */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX */
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* LISP */
+#include "image.h"
+#include "interpret.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum number of tasks.
+ */
+#define POOL_MAX_TASKS (POOL_MAX_WORKERS * POOL_TASKS_PER_WORKER)
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum length of error message passed from worker process.
+ */
+#define POOL_MAX_ERROR 256
+
+/* ************************************************************************ */
+
+/**
+ * @brief If current process is a worker.
+ */
+static int l_worker = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief File for results of worker process.
+ */
+static FILE *l_output = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Index of task running in worker process.
+ */
+static unsigned long l_task = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of tasks, error records have index after the last task.
+ */
+static unsigned long l_tasks = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns number of worker processes.
+ *
+ * Tasks are taken by atomic increment which needs GCC builtin, without
+ * it tasks run in this process.
+ *
+ * @return Number of processors, 1 if tasks run in this process.
+ */
+static unsigned int worker_count(void)
+{
+#if defined(__GNUC__)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (count < 1)
+        return 1;
+
+    if (count > POOL_MAX_WORKERS)
+        return POOL_MAX_WORKERS;
+
+    return (unsigned int) count;
+#else
+    return 1;
+#endif
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates list with one item.
+ *
+ * @param value Item, it's reachable during allocation.
+ *
+ * @return List.
+ */
+static struct SExpression *make_list(struct SExpression *value)
+{
+    struct SExpression *res;
+
+    push_value(value);
+    res = alloc_sexpr(TYPE_CONS);
+    res->list = value;
+    res->right = &sexpr_nil;
+    pop_values(1);
+
+    return res;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Runs all items as one task in this process.
+ *
+ * @param count Number of items.
+ * @param task  Task.
+ * @param data  Task data.
+ *
+ * @return List with task result.
+ */
+static struct SExpression *run_here(unsigned long count, pool_task_t task,
+    void *data)
+{
+    struct Block *block = begin_task(NULL);
+    struct SExpression *res = task(0, count, data);
+
+    end_task(block);
+
+    return make_list(res);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Takes index of the next task.
+ *
+ * @param counter Index of the next task in shared memory.
+ *
+ * @return Task index.
+ */
+static unsigned long take_task(unsigned long *counter)
+{
+#if defined(__GNUC__)
+    return __sync_fetch_and_add(counter, 1);
+#else
+    /* Only one worker is used without atomic operations */
+    return (*counter)++;
+#endif
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores syntax error of task and terminates worker process.
+ *
+ * @param err Error message.
+ */
+static void worker_error(const char *err)
+{
+    unsigned long index = l_tasks + l_task;
+    unsigned long length = (unsigned long) strlen(err);
+
+    if (length >= POOL_MAX_ERROR)
+        length = POOL_MAX_ERROR - 1;
+
+    fwrite(&index, sizeof(index), 1, l_output);
+    fwrite(&length, sizeof(length), 1, l_output);
+    fwrite(err, 1, length, l_output);
+    fflush(l_output);
+
+    /* Parent's clean-up handlers are not called */
+    fflush(stdout);
+    _exit(EXIT_FAILURE);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Body of worker process. Results are written with task indices.
+ *
+ * @param count   Number of items.
+ * @param tasks   Number of tasks.
+ * @param counter Index of the next task in shared memory.
+ * @param task    Task.
+ * @param data    Task data.
+ * @param output  File for results.
+ */
+static void worker(unsigned long count, unsigned long tasks,
+    unsigned long *counter, pool_task_t task, void *data, FILE *output)
+{
+    unsigned long i;
+
+    l_worker = 1;
+    l_output = output;
+    l_tasks = tasks;
+    begin_task(&worker_error);
+
+    while ((i = take_task(counter)) < tasks)
+    {
+        struct SExpression *res;
+        long offset;
+
+        l_task = i;
+        res = task(i * count / tasks, (i + 1) * count / tasks, data);
+        offset = ftell(output);
+
+        if (fwrite(&i, sizeof(i), 1, output) != 1 ||
+            write_object(output, res))
+        {
+            /* Error record replaces incomplete result */
+            fseek(output, offset, SEEK_SET);
+            syntax_error("Result of parallel task cannot be stored");
+        }
+    }
+
+    if (fflush(output))
+        syntax_error("Result of parallel task cannot be stored");
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads results written by worker process.
+ *
+ * Results are pushed on evaluation stack. Error of task with lower index
+ * than `*failed` replaces the error message.
+ *
+ * @param input   File with results.
+ * @param results Results by task index.
+ * @param tasks   Number of tasks.
+ * @param pushed  Number of pushed results.
+ * @param failed  Index of the first failed task, `tasks` if none.
+ * @param err     Buffer for error message of the first failed task.
+ *
+ * @return 0 on success.
+ */
+static int read_results(FILE *input, struct SExpression **results,
+    unsigned long tasks, unsigned int *pushed, unsigned long *failed,
+    char *err)
+{
+    unsigned long i;
+
+    rewind(input);
+
+    while (fread(&i, sizeof(i), 1, input) == 1)
+    {
+        struct SExpression *res;
+
+        if (i >= tasks && i < 2 * tasks)
+        {
+            char text[POOL_MAX_ERROR];
+            unsigned long length;
+
+            if (fread(&length, sizeof(length), 1, input) != 1 ||
+                length >= POOL_MAX_ERROR ||
+                fread(text, 1, length, input) != length)
+                return -1;
+
+            if (i - tasks < *failed)
+            {
+                *failed = i - tasks;
+                memcpy(err, text, length);
+                err[length] = '\0';
+            }
+
+            /* The worker terminated after the error */
+            return 0;
+        }
+
+        if (i >= tasks || results[i] || (res = read_object(input)) == NULL)
+            return -1;
+
+        results[i] = res;
+        push_value(res);
+        ++*pushed;
+    }
+
+    return ferror(input) ? -1 : 0;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *pool_run(unsigned long count, pool_task_t task, void *data)
+{
+    struct SExpression *results[POOL_MAX_TASKS];
+    struct SExpression *res = &sexpr_nil;
+    FILE *files[POOL_MAX_WORKERS];
+    pid_t pids[POOL_MAX_WORKERS];
+    unsigned int workers = worker_count();
+    unsigned int started;
+    unsigned int pushed = 0;
+    unsigned long *counter;
+    unsigned long tasks;
+    unsigned long failed;
+    unsigned long i;
+    char err[POOL_MAX_ERROR];
+    int broken = 0;
+
+    assert(task);
+
+    /* Nested tasks and small work are not distributed */
+    if (workers == 1 || count < 2 || l_worker)
+        return run_here(count, task, data);
+
+    tasks = workers * POOL_TASKS_PER_WORKER;
+
+    if (tasks > count)
+        tasks = count;
+
+    if (workers > tasks)
+        workers = (unsigned int) tasks;
+
+    counter = mmap(NULL, sizeof(unsigned long), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (counter == MAP_FAILED)
+        return run_here(count, task, data);
+
+    *counter = 0;
+
+    /* Buffered output would be written by both processes */
+    fflush(stdout);
+    fflush(stderr);
+
+    for (started = 0; started < workers; ++started)
+    {
+        if ((files[started] = tmpfile()) == NULL)
+            break;
+
+        pids[started] = fork();
+
+        if (pids[started] == 0)
+        {
+            worker(count, tasks, counter, task, data, files[started]);
+
+            /* Parent's clean-up handlers are not called */
+            fflush(stdout);
+            _exit(EXIT_SUCCESS);
+        }
+
+        if (pids[started] < 0)
+        {
+            fclose(files[started]);
+            break;
+        }
+    }
+
+    /* Started workers take all tasks, failed one stores its error */
+    for (i = 0; i < started; ++i)
+    {
+        int status;
+
+        if (waitpid(pids[i], &status, 0) != pids[i] || !WIFEXITED(status))
+            broken = 1;
+    }
+
+    munmap(counter, sizeof(unsigned long));
+
+    if (started == 0)
+        return run_here(count, task, data);
+
+    for (i = 0; i < tasks; ++i)
+        results[i] = NULL;
+
+    failed = tasks;
+
+    for (i = 0; i < started; ++i)
+    {
+        if (!broken && read_results(files[i], results, tasks, &pushed,
+            &failed, err))
+            broken = 1;
+
+        fclose(files[i]);
+    }
+
+    /* The same error as if tasks run in order */
+    if (!broken && failed < tasks)
+    {
+        pop_values(pushed);
+        syntax_error(err);
+    }
+
+    for (i = 0; i < tasks && !broken; ++i)
+    {
+        if (results[i] == NULL)
+            broken = 1;
+    }
+
+    if (broken)
+    {
+        pop_values(pushed);
+        syntax_error("Parallel task failed");
+    }
+
+    /* Results are reachable from the stack */
+    for (i = tasks; i > 0; --i)
+    {
+        struct SExpression *cell;
+
+        push_value(res);
+        cell = alloc_sexpr(TYPE_CONS);
+        pop_values(1);
+
+        cell->list = results[i - 1];
+        cell->right = res;
+        res = cell;
+    }
+
+    pop_values(pushed);
+
+    return res;
+}
+
+/* ************************************************************************ */
@@ -0,0 +1,96 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+#ifndef POOL_H_
+#define POOL_H_
+
+/* ************************************************************************ */
+
+/* LISP */
+#include "desc.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum number of worker processes.
+ */
+#ifndef POOL_MAX_WORKERS
+#define POOL_MAX_WORKERS 16
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of tasks per worker process. More smaller tasks balance
+ * items which take different time.
+ */
+#ifndef POOL_TASKS_PER_WORKER
+#define POOL_TASKS_PER_WORKER 4
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Task which processes a part of items.
+ *
+ * @param begin The first item.
+ * @param end   Item after the last one.
+ * @param data  Task data.
+ *
+ * @return Result of the part.
+ */
+typedef struct SExpression *(*pool_task_t)(unsigned long begin,
+    unsigned long end, void *data);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Processes items by tasks running in worker processes.
+ *
+ * Items are split into consecutive parts. Worker processes are forked from
+ * the interpreter, so they see all its data. Idle worker takes the next part
+ * from counter in shared memory and results are copied back into the heap.
+ * Tasks run in this process when there is only one processor or when
+ * called from a task.
+ *
+ * Tasks cannot change global variables and functions (see `begin_task`),
+ * other changes made by worker processes are not visible. Syntax error of
+ * the first failed part is raised again in this process.
+ *
+ * @param count Number of items.
+ * @param task  Task.
+ * @param data  Task data.
+ *
+ * @return List of part results in order of items.
+ */
+struct SExpression *pool_run(unsigned long count, pool_task_t task, void *data);
+
+/* ************************************************************************ */
+
+#endif /* POOL_H_ */
+
+/* ************************************************************************ */
@@ -0,0 +1,393 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+/* Feature test macros */
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+/* Declaration */
+#include "profile.h"
+
+/* C library */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX */
+#include <pthread.h>
+#include <sys/time.h>
+
+/* ************************************************************************ */
+
+/**
+ * @brief Name of sample without any call.
+ */
+#define PROFILE_TOP_LEVEL "(top-level)"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Counted call stack.
+ */
+struct Stack
+{
+    /** Folded stack, function names separated by semicolons. */
+    char *names;
+
+    /** Number of samples. */
+    unsigned long count;
+};
+
+/* ************************************************************************ */
+
+volatile sig_atomic_t profile_pending = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Output file, NULL when samples are not written.
+ */
+static FILE *l_file = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Folded stack of current sample.
+ */
+static char l_names[PROFILE_MAX_STACK_LENGTH + 1];
+
+/* ************************************************************************ */
+
+/**
+ * @brief Length of current sample.
+ */
+static size_t l_length = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of timer ticks, it's changed only by the signal handler.
+ */
+static volatile sig_atomic_t l_ticks = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of ticks counted in samples.
+ */
+static sig_atomic_t l_counted = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of ticks of current sample.
+ */
+static unsigned long l_weight = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Hash table of stacks with open addressing.
+ */
+static struct Stack *l_stacks = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of stacks.
+ */
+static unsigned long l_stack_count = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Size of hash table, power of two.
+ */
+static unsigned long l_stack_capacity = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Only counts the tick and sets the flag, the interpreter state
+ * isn't consistent during the signal.
+ *
+ * @param sig Signal number.
+ */
+static void on_timer(int sig)
+{
+    (void) sig;
+    ++l_ticks;
+    profile_pending = 1;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Calculates FNV-1a hash of the string.
+ *
+ * @param str String.
+ *
+ * @return Hash.
+ */
+static unsigned long hash_string(const char *str)
+{
+    unsigned long hash = 2166136261UL;
+
+    while (*str)
+    {
+        hash ^= (unsigned char) *str++;
+        hash *= 16777619UL;
+    }
+
+    return hash;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Finds slot of the stack in hash table.
+ *
+ * @param stacks   Hash table.
+ * @param capacity Size of hash table.
+ * @param names    Folded stack.
+ *
+ * @return The slot with the stack or an empty one.
+ */
+static struct Stack *find_stack(struct Stack *stacks, unsigned long capacity,
+    const char *names)
+{
+    unsigned long i = hash_string(names) & (capacity - 1);
+
+    while (stacks[i].names && strcmp(stacks[i].names, names))
+        i = (i + 1) & (capacity - 1);
+
+    return &stacks[i];
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Doubles size of hash table.
+ */
+static void grow_stacks(void)
+{
+    unsigned long capacity = l_stack_capacity ? 2 * l_stack_capacity : 256;
+    struct Stack *stacks = calloc(capacity, sizeof(struct Stack));
+    unsigned long i;
+
+    if (stacks == NULL)
+    {
+        perror("Unable to allocate memory");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < l_stack_capacity; ++i)
+    {
+        if (l_stacks[i].names)
+            *find_stack(stacks, capacity, l_stacks[i].names) = l_stacks[i];
+    }
+
+    free(l_stacks);
+    l_stacks = stacks;
+    l_stack_capacity = capacity;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stops sampling and writes counted stacks when the process exits.
+ */
+static void close_profile(void)
+{
+    struct itimerval timer;
+    unsigned long i;
+
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+
+    for (i = 0; i < l_stack_capacity; ++i)
+    {
+        if (!l_stacks[i].names)
+            continue;
+
+        if (l_file)
+            fprintf(l_file, "%s %lu\n", l_stacks[i].names, l_stacks[i].count);
+
+        free(l_stacks[i].names);
+    }
+
+    free(l_stacks);
+    l_stacks = NULL;
+    l_stack_count = 0;
+    l_stack_capacity = 0;
+
+    if (l_file && fclose(l_file))
+        perror("Unable to write profile");
+
+    l_file = NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stops sampling in child process, samples are written only by the
+ * parent. Timers aren't inherited.
+ */
+static void stop_child(void)
+{
+    l_file = NULL;
+    profile_pending = 0;
+    l_counted = l_ticks;
+}
+
+/* ************************************************************************ */
+
+int profile_open(const char *path, unsigned int rate)
+{
+    struct sigaction action;
+    struct itimerval timer;
+    long interval;
+
+    assert(path);
+
+    if (l_file)
+        return -1;
+
+    if ((l_file = fopen(path, "w")) == NULL)
+        return -1;
+
+    if (rate == 0)
+        rate = PROFILE_DEFAULT_RATE;
+
+    interval = 1000000L / (long) rate;
+
+    if (interval < 1)
+        interval = 1;
+
+    /* System calls are restarted after the signal */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &on_timer;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    timer.it_interval.tv_sec = interval / 1000000L;
+    timer.it_interval.tv_usec = interval % 1000000L;
+    timer.it_value = timer.it_interval;
+
+    if (sigaction(SIGPROF, &action, NULL) ||
+        setitimer(ITIMER_PROF, &timer, NULL))
+    {
+        fclose(l_file);
+        l_file = NULL;
+        return -1;
+    }
+
+    atexit(&close_profile);
+    pthread_atfork(NULL, NULL, &stop_child);
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+void profile_begin(void)
+{
+    sig_atomic_t ticks;
+
+    /* Ticks since the last sample, the flag is cleared first so a later
+     * tick requests the next sample */
+    profile_pending = 0;
+    ticks = l_ticks;
+    l_weight = (unsigned long) (ticks - l_counted);
+    l_counted = ticks;
+    l_length = 0;
+}
+
+/* ************************************************************************ */
+
+void profile_frame(const char *name)
+{
+    size_t length;
+    size_t i;
+
+    assert(name);
+
+    length = strlen(name);
+
+    /* Deeper calls are left out */
+    if (l_length + length + 1 > PROFILE_MAX_STACK_LENGTH)
+        return;
+
+    if (l_length)
+        l_names[l_length++] = ';';
+
+    /* Separators of folded format are replaced */
+    for (i = 0; i < length; ++i)
+    {
+        char c = name[i];
+        l_names[l_length++] = (c == ';' || c == ' ' || c == '\n') ? '_' : c;
+    }
+}
+
+/* ************************************************************************ */
+
+void profile_end(void)
+{
+    struct Stack *stack;
+
+    /* Ticks were counted by the previous sample */
+    if (!l_file || !l_weight)
+        return;
+
+    if (!l_length)
+        profile_frame(PROFILE_TOP_LEVEL);
+
+    l_names[l_length] = '\0';
+
+    /* Load factor is kept under 1/2 */
+    if (2 * (l_stack_count + 1) > l_stack_capacity)
+        grow_stacks();
+
+    stack = find_stack(l_stacks, l_stack_capacity, l_names);
+
+    if (!stack->names)
+    {
+        if ((stack->names = malloc(l_length + 1)) == NULL)
+        {
+            perror("Unable to allocate memory");
+            exit(EXIT_FAILURE);
+        }
+
+        memcpy(stack->names, l_names, l_length + 1);
+        ++l_stack_count;
+    }
+
+    stack->count += l_weight;
+}
+
+/* ************************************************************************ */
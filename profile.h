@@ -0,0 +1,105 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+/* ************************************************************************ */
+
+/* C library */
+#include <signal.h>
+
+/* ************************************************************************ */
+
+/**
+ * @brief Default number of samples per second of CPU time.
+ */
+#ifndef PROFILE_DEFAULT_RATE
+#define PROFILE_DEFAULT_RATE 100
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum length of folded stack, outer calls are kept.
+ */
+#ifndef PROFILE_MAX_STACK_LENGTH
+#define PROFILE_MAX_STACK_LENGTH 4096
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Set by the timer signal, the sample is taken by the interpreter
+ * at the next call. All ticks since the previous sample are counted for it.
+ */
+extern volatile sig_atomic_t profile_pending;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Starts sampling Lisp call stacks on SIGPROF.
+ *
+ * Samples are written as folded stacks when the process exits. Child
+ * processes are not sampled.
+ *
+ * @param path Output file.
+ * @param rate Number of samples per second of CPU time.
+ *
+ * @return 0 on success.
+ */
+int profile_open(const char *path, unsigned int rate);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Begins a sample and clears `profile_pending`. The sample counts
+ * timer ticks since the previous one.
+ */
+void profile_begin(void);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds function to the sample, the outermost call is the first.
+ *
+ * @param name Function name.
+ */
+void profile_frame(const char *name);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Ends the sample and counts its stack.
+ */
+void profile_end(void);
+
+/* ************************************************************************ */
+
+#endif /* PROFILE_H_ */
+
+/* ************************************************************************ */
@@ -0,0 +1,455 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+/* Feature test macros */
+#define _DEFAULT_SOURCE
+
+/* Declaration */
+#include "reader.h"
+
+/* C library */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* POSIX */
+#include <pthread.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/* ************************************************************************ */
+
+/**
+ * @brief Line reader data.
+ *
+ * Buffers are filled in turn by the background thread. Buffer is full when
+ * it's filled and its lines are not returned yet, empty full buffer means
+ * end of file.
+ */
+struct LineReader
+{
+    /** Read file, NULL when closed. */
+    FILE *file;
+
+    /** Process which opened the file, the thread doesn't exist in its
+     * child processes. */
+    pid_t owner;
+
+    /** Read-ahead buffers. */
+    char *buffers[2];
+
+    /** Number of characters in buffers. */
+    size_t sizes[2];
+
+    /** If buffers are full. */
+    int full[2];
+
+    /** Buffer of returned lines. */
+    unsigned int current;
+
+    /** If current buffer is known to be full, so waiting isn't needed. */
+    int held;
+
+    /** Position of the next line in current buffer. */
+    size_t position;
+
+    /** Line which continues in the next buffer. */
+    char line[READER_MAX_LINE_LENGTH];
+
+    /** If background thread is running. */
+    int threaded;
+
+    /** If background thread should stop. */
+    int stop;
+
+    /** Background thread. */
+    pthread_t thread;
+
+    /** Lock of buffer flags. */
+    pthread_mutex_t lock;
+
+    /** Signals change of buffer flags. */
+    pthread_cond_t changed;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Current process, it's updated in child process after fork.
+ */
+static pid_t l_process = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Updates current process in child process.
+ */
+static void update_process(void)
+{
+    l_process = getpid();
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns reader data of object.
+ *
+ * @param reader Line reader object.
+ *
+ * @return Data.
+ */
+static struct LineReader *get_data(const struct SExpression *reader)
+{
+    struct LineReader *data;
+
+    assert(reader->type == TYPE_READER);
+
+    memcpy(&data, reader->lvalue, sizeof(data));
+
+    return data;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Body of background thread, fills buffers in turn.
+ *
+ * @param arg Reader data.
+ *
+ * @return NULL.
+ */
+static void *read_ahead(void *arg)
+{
+    struct LineReader *data = arg;
+    unsigned int index = 0;
+
+    while (1)
+    {
+        size_t size;
+
+        pthread_mutex_lock(&data->lock);
+
+        while (data->full[index] && !data->stop)
+            pthread_cond_wait(&data->changed, &data->lock);
+
+        if (data->stop)
+        {
+            pthread_mutex_unlock(&data->lock);
+            break;
+        }
+
+        pthread_mutex_unlock(&data->lock);
+
+        /* Buffer which is not full isn't used by the reader */
+        size = fread(data->buffers[index], 1, READER_BUFFER_SIZE, data->file);
+
+        pthread_mutex_lock(&data->lock);
+        data->sizes[index] = size;
+        data->full[index] = 1;
+        pthread_cond_broadcast(&data->changed);
+        pthread_mutex_unlock(&data->lock);
+
+        if (size == 0)
+            break;
+
+        index ^= 1;
+    }
+
+    return NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Waits until current buffer is full.
+ *
+ * @param data Reader data.
+ */
+static void wait_buffer(struct LineReader *data)
+{
+    unsigned int index = data->current;
+
+    if (!data->threaded)
+    {
+        /* Closed reader or the thread cannot be started */
+        if (!data->full[index])
+        {
+            data->sizes[index] = data->file ? fread(data->buffers[index], 1,
+                READER_BUFFER_SIZE, data->file) : 0;
+            data->full[index] = 1;
+        }
+
+        return;
+    }
+
+    pthread_mutex_lock(&data->lock);
+
+    while (!data->full[index])
+        pthread_cond_wait(&data->changed, &data->lock);
+
+    pthread_mutex_unlock(&data->lock);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns current buffer to the background thread and switches to
+ * the other one.
+ *
+ * @param data Reader data.
+ */
+static void next_buffer(struct LineReader *data)
+{
+    unsigned int index = data->current;
+
+    if (data->threaded)
+    {
+        pthread_mutex_lock(&data->lock);
+        data->full[index] = 0;
+        pthread_cond_broadcast(&data->changed);
+        pthread_mutex_unlock(&data->lock);
+    }
+    else
+    {
+        data->full[index] = 0;
+    }
+
+    data->current = index ^ 1;
+    data->position = 0;
+    data->held = 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stops background thread.
+ *
+ * @param data Reader data.
+ */
+static void stop_thread(struct LineReader *data)
+{
+    if (!data->threaded)
+        return;
+
+    pthread_mutex_lock(&data->lock);
+    data->stop = 1;
+    pthread_cond_broadcast(&data->changed);
+    pthread_mutex_unlock(&data->lock);
+
+    pthread_join(data->thread, NULL);
+    pthread_mutex_destroy(&data->lock);
+    pthread_cond_destroy(&data->changed);
+    data->threaded = 0;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *reader_open(const char *name)
+{
+    struct SExpression *reader;
+    struct LineReader *data;
+    FILE *file;
+
+    assert(name);
+
+    if ((file = fopen(name, "rb")) == NULL)
+        return NULL;
+
+    /* Getting process identifier for each line would be slow */
+    if (l_process == 0)
+    {
+        l_process = getpid();
+        pthread_atfork(NULL, NULL, &update_process);
+    }
+
+    data = calloc(1, sizeof(struct LineReader));
+
+    if (data == NULL || (data->buffers[0] = malloc(READER_BUFFER_SIZE)) ==
+        NULL || (data->buffers[1] = malloc(READER_BUFFER_SIZE)) == NULL)
+    {
+        perror("Unable to allocate memory for line reader");
+        exit(EXIT_FAILURE);
+    }
+
+    data->file = file;
+    data->owner = l_process;
+
+    /* Without the thread buffers are filled when they are needed */
+    if (pthread_mutex_init(&data->lock, NULL) == 0)
+    {
+        if (pthread_cond_init(&data->changed, NULL) == 0)
+        {
+            data->threaded = !pthread_create(&data->thread, NULL, &read_ahead,
+                data);
+
+            if (!data->threaded)
+                pthread_cond_destroy(&data->changed);
+        }
+
+        if (!data->threaded)
+            pthread_mutex_destroy(&data->lock);
+    }
+
+    /* Pointer is stored in place of value text */
+    reader = alloc_sexpr(TYPE_READER);
+    memcpy(reader->lvalue, &data, sizeof(data));
+
+    return reader;
+}
+
+/* ************************************************************************ */
+
+int reader_next(struct SExpression *reader, const char **line,
+    size_t *length)
+{
+    struct LineReader *data = get_data(reader);
+    size_t copied = 0;
+    size_t total = 0;
+    int partial = 0;
+    char last = '\0';
+
+    assert(line);
+    assert(length);
+
+    /* Lines read by child process would be read again by parent */
+    if (data->owner != l_process)
+        return -1;
+
+    while (1)
+    {
+        const char *text;
+        const char *end;
+        size_t size;
+        size_t count;
+
+        if (data->held && data->position == data->sizes[data->current] &&
+            data->sizes[data->current] > 0)
+            next_buffer(data);
+
+        if (!data->held)
+        {
+            wait_buffer(data);
+            data->held = 1;
+        }
+
+        size = data->sizes[data->current];
+
+        /* End of file, the last line may be without line end */
+        if (size == 0)
+        {
+            if (!partial)
+                return 0;
+
+            *line = data->line;
+            *length = copied;
+            break;
+        }
+
+        text = data->buffers[data->current] + data->position;
+        end = memchr(text, '\n', size - data->position);
+        count = end ? (size_t) (end - text) : size - data->position;
+        data->position += end ? count + 1 : count;
+
+        total += count;
+
+        if (count > 0)
+            last = text[count - 1];
+
+        /* Line in one buffer is not copied */
+        if (end && !partial)
+        {
+            *line = text;
+            *length = count;
+            break;
+        }
+
+        if (count > READER_MAX_LINE_LENGTH - copied)
+            count = READER_MAX_LINE_LENGTH - copied;
+
+        memcpy(data->line + copied, text, count);
+        copied += count;
+        partial = 1;
+
+        if (end)
+        {
+            *line = data->line;
+            *length = copied;
+            break;
+        }
+    }
+
+    /* Line end of DOS text file */
+    if (total > 0 && last == '\r')
+    {
+        --total;
+        --*length;
+    }
+
+    /* Rest of the line is already skipped */
+    if (total > READER_MAX_LINE_LENGTH)
+        return -2;
+
+    return 1;
+}
+
+/* ************************************************************************ */
+
+void reader_close(struct SExpression *reader)
+{
+    struct LineReader *data = get_data(reader);
+
+    if (data->file == NULL || data->owner != l_process)
+        return;
+
+    stop_thread(data);
+    fclose(data->file);
+    data->file = NULL;
+
+    /* Lines in full buffers are not returned */
+    data->full[0] = data->full[1] = 0;
+    data->sizes[0] = data->sizes[1] = 0;
+    data->position = 0;
+    data->held = 0;
+}
+
+/* ************************************************************************ */
+
+void reader_release(struct SExpression *reader)
+{
+    struct LineReader *data = get_data(reader);
+
+    /* Child process doesn't have the thread and it exits soon */
+    if (data->owner != l_process)
+        return;
+
+    reader_close(reader);
+    free(data->buffers[0]);
+    free(data->buffers[1]);
+    free(data);
+}
+
+/* ************************************************************************ */
@@ -0,0 +1,110 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+#ifndef READER_H_
+#define READER_H_
+
+/* ************************************************************************ */
+
+/* C library */
+#include <stddef.h>
+
+/* LISP */
+#include "desc.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Size of one read-ahead buffer, two buffers are used.
+ */
+#ifndef READER_BUFFER_SIZE
+#define READER_BUFFER_SIZE (1024 * 1024)
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum length of line, longer line is reported and skipped.
+ */
+#ifndef READER_MAX_LINE_LENGTH
+#define READER_MAX_LINE_LENGTH 4096
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Opens file for reading by lines.
+ *
+ * Background thread reads the next buffer while lines of the current one
+ * are returned. Reader data are stored outside of the heap and they are
+ * released by garbage collector (see gc_set_external).
+ *
+ * @param name File name.
+ *
+ * @return Line reader object or NULL if file cannot be opened.
+ */
+struct SExpression *reader_open(const char *name);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns the next line without line end.
+ *
+ * @param reader Line reader.
+ * @param line   Line text, it's valid until the next call.
+ * @param length Line length.
+ *
+ * @return 1 if line is returned, 0 at end of file or for closed reader,
+ * -1 if reader is used by other process than the one which opened it,
+ * -2 if line is longer than READER_MAX_LINE_LENGTH and it was skipped.
+ */
+int reader_next(struct SExpression *reader, const char **line,
+    size_t *length);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stops reading and closes file. Closed reader has no more lines.
+ *
+ * @param reader Line reader.
+ */
+void reader_close(struct SExpression *reader);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Frees reader data, it's called by garbage collector.
+ *
+ * @param reader Line reader.
+ */
+void reader_release(struct SExpression *reader);
+
+/* ************************************************************************ */
+
+#endif /* READER_H_ */
+
+/* ************************************************************************ */
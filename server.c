@@ -0,0 +1,725 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+
+/* Feature test macros */
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+/* Declaration */
+#include "server.h"
+
+/* C library */
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* LISP */
+#include "interpret.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Latency histogram of one worker.
+ */
+struct Histogram
+{
+    /** Number of requests in buckets. */
+    unsigned long buckets[HISTOGRAM_SIZE];
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief If server should stop.
+ */
+static volatile sig_atomic_t l_stop = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Signal mask used by worker while it waits for input.
+ */
+static sigset_t l_wait_mask;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Signal handler which requests stop.
+ *
+ * @param sig Signal number.
+ */
+static void stop_handler(int sig)
+{
+    (void) sig;
+    l_stop = 1;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Signal handler which only interrupts waiting.
+ *
+ * @param sig Signal number.
+ */
+static void child_handler(int sig)
+{
+    (void) sig;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Installs signal handler without restarting of system calls.
+ *
+ * @param sig     Signal number.
+ * @param handler Signal handler.
+ */
+static void set_handler(int sig, void (*handler)(int))
+{
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handler;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(sig, &action, NULL);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Waits until file descriptor is readable.
+ *
+ * Stop signal is received only during waiting so it can't be lost.
+ *
+ * @param fd File descriptor.
+ *
+ * @return 0 if descriptor is readable, -1 if stop is requested or on error.
+ */
+static int wait_readable(int fd)
+{
+    fd_set fds;
+    int res;
+
+    /* Other signals (end of session) only interrupt waiting */
+    do
+    {
+        if (l_stop)
+            return -1;
+
+        FD_ZERO(&fds);
+        FD_SET(fd, &fds);
+
+        res = pselect(fd + 1, &fds, NULL, NULL, NULL, &l_wait_mask);
+    }
+    while (res < 0 && errno == EINTR);
+
+    if (res < 0)
+        return -1;
+
+    return l_stop ? -1 : 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads exactly given number of bytes.
+ *
+ * @param fd   File descriptor.
+ * @param buf  Destination buffer.
+ * @param size Number of bytes.
+ *
+ * @return 0 on success, -1 on error or end of file.
+ */
+static int read_full(int fd, void *buf, size_t size)
+{
+    char *ptr = buf;
+
+    while (size > 0)
+    {
+        ssize_t res = read(fd, ptr, size);
+
+        if (res <= 0)
+            return -1;
+
+        ptr += res;
+        size -= res;
+    }
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Writes exactly given number of bytes.
+ *
+ * @param fd   File descriptor.
+ * @param buf  Source buffer.
+ * @param size Number of bytes.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int write_full(int fd, const void *buf, size_t size)
+{
+    const char *ptr = buf;
+
+    while (size > 0)
+    {
+        ssize_t res = write(fd, ptr, size);
+
+        if (res < 0 && errno == EINTR)
+            continue;
+
+        if (res <= 0)
+            return -1;
+
+        ptr += res;
+        size -= res;
+    }
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores 32 bit number in big-endian order.
+ *
+ * @param buf   Destination buffer.
+ * @param value Number.
+ */
+static void put_uint32(unsigned char *buf, unsigned long value)
+{
+    buf[0] = (value >> 24) & 0xFF;
+    buf[1] = (value >> 16) & 0xFF;
+    buf[2] = (value >> 8) & 0xFF;
+    buf[3] = value & 0xFF;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Loads 32 bit number stored in big-endian order.
+ *
+ * @param buf Source buffer.
+ *
+ * @return Number.
+ */
+static unsigned long get_uint32(const unsigned char *buf)
+{
+    return ((unsigned long) buf[0] << 24) | ((unsigned long) buf[1] << 16) |
+        ((unsigned long) buf[2] << 8) | buf[3];
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns monotonic time in microseconds.
+ *
+ * @return Time.
+ */
+static unsigned long now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Evaluates request source.
+ *
+ * @param source Source text.
+ * @param size   Source length.
+ * @param result Output text, must be freed by caller.
+ * @param length Output length.
+ *
+ * @return Number of errors.
+ */
+static unsigned int evaluate(char *source, size_t size, char **result,
+    size_t *length)
+{
+    unsigned int errors = 0;
+    FILE *input;
+    FILE *output;
+
+    *result = NULL;
+    *length = 0;
+
+    output = open_memstream(result, length);
+
+    if (output == NULL)
+        return 1;
+
+    /* Empty request */
+    if (size > 0)
+    {
+        input = fmemopen(source, size, "r");
+
+        if (input == NULL)
+        {
+            fprintf(output, "Unable to read request\n");
+            errors = 1;
+        }
+        else
+        {
+            errors = eval_request(input, output);
+            fclose(input);
+        }
+    }
+
+    fclose(output);
+
+    return errors;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Handles requests from one connection until it's closed.
+ *
+ * @param conn      Connection socket.
+ * @param histogram Latency histogram of current worker.
+ */
+static void handle_connection(int conn, struct Histogram *histogram)
+{
+    while (!l_stop)
+    {
+        unsigned char header[8];
+        unsigned long start;
+        unsigned long elapsed;
+        unsigned long size;
+        unsigned int errors;
+        unsigned int bucket;
+        char *source;
+        char *result;
+        size_t length;
+        int failed;
+
+        /* Request header */
+        if (wait_readable(conn) || read_full(conn, header, 4))
+            return;
+
+        size = get_uint32(header);
+
+        if (size > MAX_REQUEST_SIZE)
+            return;
+
+        source = malloc(size + 1);
+
+        if (source == NULL)
+            return;
+
+        if (read_full(conn, source, size))
+        {
+            free(source);
+            return;
+        }
+
+        source[size] = '\0';
+
+        /* Evaluate request */
+        start = now_us();
+        errors = evaluate(source, size, &result, &length);
+        elapsed = now_us() - start;
+
+        free(source);
+
+        /* Store latency */
+        for (bucket = 0; bucket < HISTOGRAM_SIZE - 1; ++bucket)
+        {
+            if (elapsed < (1UL << bucket))
+                break;
+        }
+
+        histogram->buckets[bucket]++;
+
+        /* Send response */
+        put_uint32(header, length);
+        put_uint32(header + 4, errors);
+
+        failed = write_full(conn, header, 8) ||
+            (length > 0 && write_full(conn, result, length));
+
+        free(result);
+
+        if (failed)
+            return;
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Handles connection in a session process so changes of global
+ * state made by requests are dropped when the connection is closed.
+ *
+ * @param sock      Listening socket.
+ * @param conn      Connection socket.
+ * @param histogram Latency histogram of current worker.
+ */
+static void run_session(int sock, int conn, struct Histogram *histogram)
+{
+    int stopped = 0;
+    pid_t pid;
+
+    /* Buffered output would be written by both processes */
+    fflush(stdout);
+    fflush(stderr);
+
+    pid = fork();
+
+    if (pid == 0)
+    {
+        /* Parallel tasks of requests wait for their own processes */
+        signal(SIGCHLD, SIG_DFL);
+        close(sock);
+        handle_connection(conn, histogram);
+        close(conn);
+
+        /* Parent's clean-up handlers are not called */
+        fflush(stdout);
+        _exit(EXIT_SUCCESS);
+    }
+
+    if (pid < 0)
+    {
+        perror("fork");
+        return;
+    }
+
+    /* Stop request is passed to the session which finishes current
+     * request, SIGTERM and SIGCHLD are received only while waiting */
+    while (waitpid(pid, NULL, WNOHANG) == 0)
+    {
+        if (l_stop && !stopped)
+        {
+            kill(pid, SIGTERM);
+            stopped = 1;
+        }
+
+        sigsuspend(&l_wait_mask);
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Worker process main loop.
+ *
+ * @param sock      Listening socket.
+ * @param histogram Latency histogram of worker.
+ */
+static void worker(int sock, struct Histogram *histogram)
+{
+    /* Stopped by parent, SIGTERM stays blocked outside of waiting */
+    set_handler(SIGTERM, stop_handler);
+    signal(SIGINT, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    set_handler(SIGCHLD, child_handler);
+
+    sigemptyset(&l_wait_mask);
+
+    while (wait_readable(sock) == 0)
+    {
+        int conn = accept(sock, NULL, NULL);
+
+        /* Connection is accepted by another worker */
+        if (conn < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK &&
+                errno != EINTR && errno != ECONNABORTED)
+            {
+                perror("accept");
+            }
+
+            continue;
+        }
+
+        /* Requests are read by blocking calls */
+        fcntl(conn, F_SETFL, fcntl(conn, F_GETFL) & ~O_NONBLOCK);
+
+        run_session(sock, conn, histogram);
+        close(conn);
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Starts worker process.
+ *
+ * @param sock      Listening socket.
+ * @param histogram Latency histogram of worker.
+ *
+ * @return Process ID or -1.
+ */
+static pid_t start_worker(int sock, struct Histogram *histogram)
+{
+    pid_t pid;
+
+    /* Buffered output would be written by both processes */
+    fflush(stdout);
+    fflush(stderr);
+
+    pid = fork();
+
+    if (pid == 0)
+    {
+        worker(sock, histogram);
+
+        /* Parent's clean-up handlers are not called */
+        fflush(stdout);
+        _exit(EXIT_SUCCESS);
+    }
+
+    if (pid < 0)
+        perror("fork");
+
+    return pid;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Prints latency histogram of all workers.
+ *
+ * @param histograms Histograms of workers.
+ * @param workers    Number of workers.
+ */
+static void print_histogram(const struct Histogram *histograms,
+    unsigned int workers)
+{
+    unsigned long buckets[HISTOGRAM_SIZE];
+    unsigned long total = 0;
+    unsigned long sum = 0;
+    unsigned int i;
+    unsigned int j;
+
+    memset(buckets, 0, sizeof(buckets));
+
+    for (i = 0; i < workers; ++i)
+    {
+        for (j = 0; j < HISTOGRAM_SIZE; ++j)
+            buckets[j] += histograms[i].buckets[j];
+    }
+
+    for (j = 0; j < HISTOGRAM_SIZE; ++j)
+        total += buckets[j];
+
+    fprintf(stderr, "Requests: %lu\n", total);
+
+    if (total == 0)
+        return;
+
+    fprintf(stderr, "Latency (us):\n");
+
+    for (j = 0; j < HISTOGRAM_SIZE; ++j)
+    {
+        if (buckets[j] == 0)
+            continue;
+
+        sum += buckets[j];
+
+        fprintf(stderr, "  < %10lu: %10lu %6.2f%%\n", 1UL << j, buckets[j],
+            100.0 * sum / total);
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates listening socket.
+ *
+ * @param path Socket path.
+ *
+ * @return Socket or -1.
+ */
+static int create_socket(const char *path)
+{
+    struct sockaddr_un addr;
+    struct stat info;
+    int sock;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Socket path is too long\n");
+        return -1;
+    }
+
+    /* Remove stale socket, other files are never replaced */
+    if (lstat(path, &info) == 0)
+    {
+        if (!S_ISSOCK(info.st_mode))
+        {
+            fprintf(stderr, "%s: Address in use\n", path);
+            return -1;
+        }
+
+        unlink(path);
+    }
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (sock < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    /* All workers wait for the same socket */
+    if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+        listen(sock, SOMAXCONN) < 0 ||
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK) < 0)
+    {
+        perror(path);
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+/* ************************************************************************ */
+
+int serve(const char *path, unsigned int workers)
+{
+    struct Histogram *histograms;
+    pid_t *pids;
+    sigset_t mask;
+    sigset_t old_mask;
+    unsigned int i;
+    int sock;
+
+    assert(path);
+    assert(workers > 0);
+
+    sock = create_socket(path);
+
+    if (sock < 0)
+        return -1;
+
+    /* Histograms are written by workers */
+    histograms = mmap(NULL, workers * sizeof(struct Histogram),
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    pids = calloc(workers, sizeof(pid_t));
+
+    if (histograms == MAP_FAILED || pids == NULL)
+    {
+        perror("Unable to allocate memory for workers");
+        close(sock);
+        unlink(path);
+        return -1;
+    }
+
+    memset(histograms, 0, workers * sizeof(struct Histogram));
+
+    /* Signals are received only while waiting */
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+
+    set_handler(SIGINT, stop_handler);
+    set_handler(SIGTERM, stop_handler);
+    set_handler(SIGCHLD, child_handler);
+
+    for (i = 0; i < workers; ++i)
+        pids[i] = start_worker(sock, &histograms[i]);
+
+    fprintf(stderr, "Listening on %s with %u workers\n", path, workers);
+
+    while (!l_stop)
+    {
+        pid_t pid;
+        int status;
+
+        /* Replace finished workers */
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+        {
+            for (i = 0; i < workers; ++i)
+            {
+                if (pids[i] == pid)
+                    pids[i] = start_worker(sock, &histograms[i]);
+            }
+        }
+
+        sigsuspend(&old_mask);
+    }
+
+    /* Workers finish current requests */
+    for (i = 0; i < workers; ++i)
+    {
+        if (pids[i] > 0)
+            kill(pids[i], SIGTERM);
+    }
+
+    for (i = 0; i < workers; ++i)
+    {
+        if (pids[i] > 0)
+            waitpid(pids[i], NULL, 0);
+    }
+
+    close(sock);
+    unlink(path);
+
+    print_histogram(histograms, workers);
+
+    munmap(histograms, workers * sizeof(struct Histogram));
+    free(pids);
+
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+
+    return 0;
+}
+
+/* ************************************************************************ */
@@ -0,0 +1,83 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum size of request source in bytes.
+ */
+#ifndef MAX_REQUEST_SIZE
+#define MAX_REQUEST_SIZE 1048576
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of latency histogram buckets. Bucket `i` counts requests
+ * which took less than 2^i microseconds.
+ */
+#ifndef HISTOGRAM_SIZE
+#define HISTOGRAM_SIZE 32
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Serves evaluation requests on Unix domain socket.
+ *
+ * Current interpreter state (e.g. preloaded source file) is shared by
+ * pre-forked worker processes which accept connections from the same
+ * socket. Every connection is handled by a session process forked from
+ * the worker, so global variables and functions defined by a request are
+ * visible to next requests of the same connection only and every
+ * connection starts with the preloaded state. Worker which dies is
+ * replaced by a new one.
+ *
+ * Request is a 4 byte big-endian length followed by source text. Response
+ * is a 4 byte big-endian length, a 4 byte big-endian number of errors and
+ * the output text: one result or error message per line. More requests
+ * can be sent over one connection.
+ *
+ * SIGINT or SIGTERM stops the server gracefully: workers finish current
+ * requests, latency histogram is printed to stderr and socket is removed.
+ *
+ * @param path    Socket path.
+ * @param workers Number of worker processes.
+ *
+ * @return 0 on success.
+ */
+int serve(const char *path, unsigned int workers);
+
+/* ************************************************************************ */
+
+#endif /* SERVER_H_ */
+
+/* ************************************************************************ */
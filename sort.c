@@ -0,0 +1,436 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+/* Declaration */
+#include "sort.h"
+
+/* C library */
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of buckets of one radix sort pass.
+ */
+#define SORT_RADIX_SIZE (1UL << SORT_RADIX_BITS)
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of radix sort passes.
+ */
+#define SORT_PASSES ((sizeof(unsigned long) * CHAR_BIT + SORT_RADIX_BITS - 1) / \
+    SORT_RADIX_BITS)
+
+/* ************************************************************************ */
+
+/**
+ * @brief The highest bit of key.
+ */
+#define SORT_SIGN_BIT (~0UL ^ (~0UL >> 1))
+
+/* ************************************************************************ */
+
+/**
+ * @brief Length of runs sorted by insertion sort.
+ */
+#define SORT_RUN_LENGTH 16
+
+/* ************************************************************************ */
+
+/**
+ * @brief Buffer returned by `sort_buffer`.
+ */
+static union VectorItem *l_items = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Capacity of `l_items`.
+ */
+static unsigned long l_item_capacity = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Radix sort keys followed by scratch space.
+ */
+static unsigned long *l_keys = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Capacity of `l_keys`.
+ */
+static unsigned long l_key_capacity = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Merge sort items followed by scratch space, NULL while it's used.
+ */
+static struct SExpression **l_objects = NULL;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Capacity of `l_objects`.
+ */
+static unsigned long l_object_capacity = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Makes buffer big enough, content is not kept.
+ *
+ * @param buffer   Buffer.
+ * @param capacity Number of allocated items.
+ * @param count    Required number of items.
+ * @param size     Size of item.
+ *
+ * @return Buffer.
+ */
+static void *reserve(void *buffer, unsigned long *capacity, unsigned long count,
+    size_t size)
+{
+    if (count <= *capacity)
+        return buffer;
+
+    free(buffer);
+
+    *capacity = (count > 2 * *capacity) ? count : 2 * *capacity;
+
+    if ((buffer = malloc(*capacity * size)) == NULL)
+    {
+        perror("Unable to allocate memory for sorting");
+        exit(EXIT_FAILURE);
+    }
+
+    return buffer;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Converts number into key with the same order.
+ *
+ * @param item Number.
+ * @param kind Type of number.
+ *
+ * @return Key.
+ */
+static unsigned long item_key(const union VectorItem *item,
+    enum VectorKind kind)
+{
+    unsigned long bits;
+
+    if (kind == VECTOR_INTEGER)
+        return (unsigned long) item->integer ^ SORT_SIGN_BIT;
+
+    /* Negative numbers have reversed order */
+    memcpy(&bits, &item->real, sizeof(bits));
+
+    return (bits & SORT_SIGN_BIT) ? ~bits : bits | SORT_SIGN_BIT;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Converts key back into number.
+ *
+ * @param key  Key.
+ * @param kind Type of number.
+ * @param item Number.
+ */
+static void key_item(unsigned long key, enum VectorKind kind,
+    union VectorItem *item)
+{
+    if (kind == VECTOR_INTEGER)
+    {
+        key ^= SORT_SIGN_BIT;
+        item->integer = (key <= LONG_MAX) ? (long) key :
+            -(long) (ULONG_MAX - key) - 1;
+        return;
+    }
+
+    key = (key & SORT_SIGN_BIT) ? key & ~SORT_SIGN_BIT : ~key;
+    memcpy(&item->real, &key, sizeof(key));
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Compares floating point numbers for `qsort`.
+ *
+ * @param first  The first number.
+ * @param second The second number.
+ *
+ * @return Difference sign.
+ */
+static int compare_reals(const void *first, const void *second)
+{
+    double a = ((const union VectorItem *) first)->real;
+    double b = ((const union VectorItem *) second)->real;
+
+    return (a > b) - (a < b);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Sorts keys by LSD radix sort.
+ *
+ * Digits of all passes are counted at once and pass is skipped when all
+ * keys have the same digit.
+ *
+ * @param keys    Keys.
+ * @param scratch Space for count keys.
+ * @param count   Number of keys.
+ */
+static void radix_sort(unsigned long *keys, unsigned long *scratch,
+    unsigned long count)
+{
+    unsigned long counts[SORT_PASSES][SORT_RADIX_SIZE];
+    unsigned long *source = keys;
+    unsigned long *target = scratch;
+    unsigned long i;
+    unsigned int pass;
+
+    memset(counts, 0, sizeof(counts));
+
+    for (i = 0; i < count; ++i)
+    {
+        for (pass = 0; pass < SORT_PASSES; ++pass)
+            ++counts[pass][(keys[i] >> (pass * SORT_RADIX_BITS)) &
+                (SORT_RADIX_SIZE - 1)];
+    }
+
+    for (pass = 0; pass < SORT_PASSES; ++pass)
+    {
+        unsigned long *offsets = counts[pass];
+        unsigned int shift = pass * SORT_RADIX_BITS;
+        unsigned long offset = 0;
+        unsigned long *tmp;
+
+        if (offsets[(source[0] >> shift) & (SORT_RADIX_SIZE - 1)] == count)
+            continue;
+
+        for (i = 0; i < SORT_RADIX_SIZE; ++i)
+        {
+            unsigned long size = offsets[i];
+
+            offsets[i] = offset;
+            offset += size;
+        }
+
+        for (i = 0; i < count; ++i)
+            target[offsets[(source[i] >> shift) & (SORT_RADIX_SIZE - 1)]++] =
+                source[i];
+
+        tmp = source;
+        source = target;
+        target = tmp;
+    }
+
+    if (source != keys)
+        memcpy(keys, source, count * sizeof(unsigned long));
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Sorts short part of items by insertion sort.
+ *
+ * @param items Items.
+ * @param count Number of items.
+ * @param less  Compare function.
+ * @param data  Data for compare function.
+ */
+static void insertion_sort(struct SExpression **items, unsigned long count,
+    sort_less_t less, void *data)
+{
+    unsigned long i;
+
+    for (i = 1; i < count; ++i)
+    {
+        struct SExpression *item = items[i];
+        unsigned long j;
+
+        for (j = i; j > 0 && less(item, items[j - 1], data); --j)
+            items[j] = items[j - 1];
+
+        items[j] = item;
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Sorts items by bottom-up merge sort.
+ *
+ * @param items   Items.
+ * @param scratch Space for count items.
+ * @param count   Number of items.
+ * @param less    Compare function.
+ * @param data    Data for compare function.
+ */
+static void merge_sort(struct SExpression **items, struct SExpression **scratch,
+    unsigned long count, sort_less_t less, void *data)
+{
+    struct SExpression **source = items;
+    struct SExpression **target = scratch;
+    unsigned long width;
+    unsigned long i;
+
+    for (i = 0; i < count; i += SORT_RUN_LENGTH)
+        insertion_sort(items + i, (count - i < SORT_RUN_LENGTH) ? count - i :
+            SORT_RUN_LENGTH, less, data);
+
+    for (width = SORT_RUN_LENGTH; width < count; width *= 2)
+    {
+        struct SExpression **tmp;
+
+        for (i = 0; i < count; i += 2 * width)
+        {
+            unsigned long middle = (count - i < width) ? count : i + width;
+            unsigned long end = (count - i < 2 * width) ? count : i + 2 * width;
+            unsigned long left = i;
+            unsigned long right = middle;
+            unsigned long k = i;
+
+            /* The left item goes first when items are equal */
+            while (left < middle && right < end)
+            {
+                if (less(source[right], source[left], data))
+                    target[k++] = source[right++];
+                else
+                    target[k++] = source[left++];
+            }
+
+            while (left < middle)
+                target[k++] = source[left++];
+
+            while (right < end)
+                target[k++] = source[right++];
+        }
+
+        tmp = source;
+        source = target;
+        target = tmp;
+    }
+
+    if (source != items)
+        memcpy(items, source, count * sizeof(struct SExpression *));
+}
+
+/* ************************************************************************ */
+
+union VectorItem *sort_buffer(unsigned long count)
+{
+    l_items = reserve(l_items, &l_item_capacity, count ? count : 1,
+        sizeof(union VectorItem));
+
+    return l_items;
+}
+
+/* ************************************************************************ */
+
+void sort_items(union VectorItem *items, unsigned long count,
+    enum VectorKind kind)
+{
+    unsigned long i;
+
+    assert(items);
+
+    if (count < 2)
+        return;
+
+    /* Floating point number doesn't fit into key */
+    if (kind == VECTOR_FLOAT && sizeof(double) != sizeof(unsigned long))
+    {
+        qsort(items, count, sizeof(union VectorItem), &compare_reals);
+        return;
+    }
+
+    l_keys = reserve(l_keys, &l_key_capacity, 2 * count,
+        sizeof(unsigned long));
+
+    for (i = 0; i < count; ++i)
+        l_keys[i] = item_key(&items[i], kind);
+
+    radix_sort(l_keys, l_keys + count, count);
+
+    for (i = 0; i < count; ++i)
+        key_item(l_keys[i], kind, &items[i]);
+}
+
+/* ************************************************************************ */
+
+void sort_list(struct SExpression *list, unsigned long count,
+    sort_less_t less, void *data)
+{
+    struct SExpression **items = l_objects;
+    unsigned long capacity = l_object_capacity;
+    struct SExpression *cell;
+    unsigned long i;
+
+    assert(less);
+
+    if (count < 2)
+        return;
+
+    /* Compare function can sort too, so the buffer is taken. It's not
+     * returned when syntax error leaves the compare function. */
+    l_objects = NULL;
+    l_object_capacity = 0;
+    items = reserve(items, &capacity, 2 * count, sizeof(struct SExpression *));
+
+    for (i = 0, cell = list; i < count; ++i, cell = cell->right)
+        items[i] = cell->list;
+
+    merge_sort(items, items + count, count, less, data);
+
+    for (i = 0, cell = list; i < count; ++i, cell = cell->right)
+        cell->list = items[i];
+
+    /* The bigger buffer is kept */
+    if (capacity > l_object_capacity)
+    {
+        free(l_objects);
+        l_objects = items;
+        l_object_capacity = capacity;
+    }
+    else
+    {
+        free(items);
+    }
+}
+
+/* ************************************************************************ */
@@ -0,0 +1,105 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+#ifndef SORT_H_
+#define SORT_H_
+
+/* ************************************************************************ */
+
+/* LISP */
+#include "desc.h"
+#include "vector.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of bits sorted by one pass of radix sort.
+ */
+#ifndef SORT_RADIX_BITS
+#define SORT_RADIX_BITS 8
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Function which compares two objects.
+ *
+ * @param first  The first object.
+ * @param second The second object.
+ * @param data   Data passed to sort function.
+ *
+ * @return If the first object goes before the second one.
+ */
+typedef int (*sort_less_t)(struct SExpression *first,
+    struct SExpression *second, void *data);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns buffer for numbers sorted by `sort_items`.
+ *
+ * The buffer is reused by the following calls.
+ *
+ * @param count Number of items.
+ *
+ * @return Buffer.
+ */
+union VectorItem *sort_buffer(unsigned long count);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Sorts numbers into ascending order by LSD radix sort.
+ *
+ * @param items Numbers.
+ * @param count Number of items.
+ * @param kind  Type of numbers.
+ */
+void sort_items(union VectorItem *items, unsigned long count,
+    enum VectorKind kind);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Sorts items of list by stable merge sort.
+ *
+ * Items are reordered in the list, cons cells stay in place. The list must
+ * be reachable by garbage collector, compare function can evaluate code.
+ *
+ * @param list  List.
+ * @param count Number of items.
+ * @param less  Compare function.
+ * @param data  Data for compare function.
+ */
+void sort_list(struct SExpression *list, unsigned long count,
+    sort_less_t less, void *data);
+
+/* ************************************************************************ */
+
+#endif /* SORT_H_ */
+
+/* ************************************************************************ */
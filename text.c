@@ -0,0 +1,98 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+/* Declaration */
+#include "text.h"
+
+/* C library */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* LISP */
+#include "interpret.h"
+
+/* ************************************************************************ */
+
+struct SExpression *text_create(const char *text, size_t length)
+{
+    struct SExpression *string = alloc_sexpr(TYPE_STRING);
+
+    text_init(string, text, length);
+
+    return string;
+}
+
+/* ************************************************************************ */
+
+void text_init(struct SExpression *string, const char *text, size_t length)
+{
+    char *data = malloc(length + 1);
+
+    if (data == NULL)
+    {
+        perror("Unable to allocate memory for string");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(data, text, length);
+    data[length] = '\0';
+
+    text_attach(string, data);
+}
+
+/* ************************************************************************ */
+
+void text_attach(struct SExpression *string, const char *text)
+{
+    assert(string->type == TYPE_STRING);
+
+    /* Pointer is stored in place of value text */
+    memcpy(string->lvalue, &text, sizeof(text));
+}
+
+/* ************************************************************************ */
+
+const char *text_get(const struct SExpression *string)
+{
+    const char *text;
+
+    assert(string->type == TYPE_STRING);
+
+    memcpy(&text, string->lvalue, sizeof(text));
+
+    return text;
+}
+
+/* ************************************************************************ */
+
+void text_release(struct SExpression *string)
+{
+    free((void *) text_get(string));
+}
+
+/* ************************************************************************ */
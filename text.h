@@ -0,0 +1,100 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+#ifndef TEXT_H_
+#define TEXT_H_
+
+/* ************************************************************************ */
+
+/* C library */
+#include <stddef.h>
+
+/* LISP */
+#include "desc.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates a new string.
+ *
+ * String text is stored outside of the heap and it's released by garbage
+ * collector (see gc_set_external).
+ *
+ * @param text   Characters, they don't need to be terminated.
+ * @param length Number of characters.
+ *
+ * @return String object.
+ */
+struct SExpression *text_create(const char *text, size_t length);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores copy of text into string object.
+ *
+ * @param string String object without text.
+ * @param text   Characters, they don't need to be terminated.
+ * @param length Number of characters.
+ */
+void text_init(struct SExpression *string, const char *text, size_t length);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stores text which is owned by caller into string object. It's
+ * used for permanent objects which are never released.
+ *
+ * @param string String object without text.
+ * @param text   Terminated text.
+ */
+void text_attach(struct SExpression *string, const char *text);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns string text.
+ *
+ * @param string String object.
+ *
+ * @return Terminated text.
+ */
+const char *text_get(const struct SExpression *string);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Frees string text, it's called by garbage collector.
+ *
+ * @param string String object.
+ */
+void text_release(struct SExpression *string);
+
+/* ************************************************************************ */
+
+#endif /* TEXT_H_ */
+
+/* ************************************************************************ */
@@ -24,37 +24,225 @@
 /*                                                                          */
 /* ************************************************************************ */
 
+/* Feature test macros */
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
 /* Declaration */
 #include "tokenizer.h"
 
 /* C library */
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 
+/* POSIX */
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Vector instructions */
+#if defined(__GNUC__) && defined(__AVX2__)
+#define SCAN_AVX2
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__SSE2__)
+#define SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
 /* ************************************************************************ */
 
-/** Current file. */
-static FILE* l_file = NULL;
+/**
+ * @brief Number of bytes after the end of line buffer which can be read
+ * by vector scanning (one vector).
+ */
+#define SCAN_PADDING 32
 
 /* ************************************************************************ */
 
-/** Current symbol. */
-static enum Sym l_symbol = SYM_INV;
+/**
+ * @brief Tokenizer state.
+ *
+ * The main tokenizer reads source file, tokenizers of worker threads read
+ * parts of mapped source file.
+ */
+struct Lexer
+{
+    /** Source file, NULL for text in memory. */
+    FILE* file;
+
+    /** Rest of source text in memory. */
+    const char *text;
+
+    /** End of source text in memory. */
+    const char *end;
+
+    /** Source text of loaded part of line. */
+    const char *part;
+
+    /** Current symbol. */
+    enum Sym symbol;
+
+    /** Line buffer. */
+    char line[MAX_LINE_LENGTH + SCAN_PADDING];
+
+    /** Current character. */
+    const char *current;
+
+    /** If the next get_char returns current character again. */
+    int pushback;
+
+    /** Number of current line of source file, 0 before the first one. */
+    unsigned long line_number;
+
+    /** If loaded part of line ends with new line character. */
+    int line_end;
+
+    /** Buffer for symbol text which cannot be taken from line buffer. */
+    char name[MAX_NAME_LENGTH];
+
+    /** Buffer for string which cannot be taken from line buffer. */
+    char string[MAX_STRING_LENGTH];
+
+    /** Current token. */
+    struct Token token;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Token read by worker thread.
+ */
+struct Lexeme
+{
+    /** Text in source, the character for new line symbol. NULL when text
+     * is stored in chunk pool. */
+    const char *text;
+
+    /** Part of line loaded after the token, it's echoed with the form. */
+    const char *part;
+
+    /** Value of integer number symbol. */
+    long value;
+
+    /** Text length. */
+    unsigned int length;
+
+    /** Symbol. */
+    unsigned char symbol;
+
+    /** New line character was read as the last character of token. */
+    unsigned char eol;
+};
 
 /* ************************************************************************ */
 
-/** Line buffer. */
-static char l_line[MAX_LINE_LENGTH] = {'\0'};
+/**
+ * @brief Part of source text tokenized by one worker thread.
+ */
+struct Chunk
+{
+    /** The first character, it starts a line. */
+    const char *begin;
+
+    /** End of text, it's after new line. */
+    const char *end;
+
+    /** Read tokens. */
+    struct Lexeme *lexemes;
+
+    /** Number of read tokens. */
+    size_t count;
+
+    /** Capacity of tokens array. */
+    size_t capacity;
+
+    /** Texts which are not in source as they are. */
+    char *pool;
+
+    /** Used size of pool. */
+    size_t pool_size;
+
+    /** Capacity of pool. */
+    size_t pool_capacity;
+
+    /** Worker thread. */
+    pthread_t thread;
+
+    /** If the worker thread is running or not joined. */
+    int running;
+};
 
 /* ************************************************************************ */
 
-/** Current character */
-static const char* l_current = l_line;
+/**
+ * @brief Parallel tokenization of large source file.
+ *
+ * While one batch of chunks is replayed by the main tokenizer, worker threads
+ * tokenize the next one.
+ */
+struct Parallel
+{
+    /** Mapped source file, NULL when not used. */
+    char *map;
+
+    /** Size of mapping. */
+    size_t size;
+
+    /** Text which is not assigned to any chunk. */
+    const char *rest;
+
+    /** End of source text. */
+    const char *end;
+
+    /** Start of current line. */
+    const char *line;
+
+    /** Part of line loaded after current token, NULL before the first
+     * token. */
+    const char *part;
+
+    /** Number of worker threads. */
+    unsigned int threads;
+
+    /** Two batches of chunks. */
+    struct Chunk chunks[2][PARALLEL_MAX_THREADS];
+
+    /** Number of chunks in batches. */
+    unsigned int count[2];
+
+    /** Replayed batch. */
+    unsigned int batch;
+
+    /** Replayed chunk. */
+    unsigned int chunk;
+
+    /** The next replayed token in chunk. */
+    size_t position;
+
+    /** Current token ends current line. */
+    int eol;
+
+    /** Number of current line. */
+    unsigned long line_number;
+};
 
 /* ************************************************************************ */
 
-char name[MAX_NAME_LENGTH];
+/**
+ * @brief Main tokenizer.
+ */
+static struct Lexer l_lexer;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Parallel tokenization of current file.
+ */
+static struct Parallel l_parallel;
 
 /* ************************************************************************ */
 
@@ -65,85 +253,439 @@ static int is_symbol_name(int c)
 
 /* ************************************************************************ */
 
-void set_source(FILE* file)
+/**
+ * @brief Finds the first character which ends name or string.
+ *
+ * Name ends with space, parenthesis or end of loaded line. String ends with
+ * quote, backslash, new line or end of loaded line. Text is scanned 32 or
+ * 16 bytes at once when vector instructions are available, so it can read
+ * up to SCAN_PADDING bytes after the end of line.
+ *
+ * @param text   Text in line buffer.
+ * @param string If string is scanned.
+ *
+ * @return Pointer to the end character.
+ */
+static const char *scan(const char *text, int string)
 {
-    l_file = file;
+#if defined(SCAN_AVX2)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i first = _mm256_set1_epi8(string ? '"' : '(');
+    const __m256i second = _mm256_set1_epi8(string ? '\\' : ')');
+    const __m256i third = _mm256_set1_epi8(string ? '\n' : ' ');
+    const __m256i control = _mm256_set1_epi8('\t');
+    const __m256i range = _mm256_set1_epi8(string ? 0 : '\r' - '\t');
+
+    while (1)
+    {
+        __m256i chars = _mm256_loadu_si256((const __m256i *) text);
+        __m256i shifted = _mm256_sub_epi8(chars, control);
+        __m256i found = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chars, zero),
+                _mm256_cmpeq_epi8(chars, first)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chars, second),
+                _mm256_cmpeq_epi8(chars, third)));
+        unsigned int mask;
+
+        /* Control characters \t - \r end name */
+        if (!string)
+        {
+            found = _mm256_or_si256(found, _mm256_cmpeq_epi8(
+                _mm256_min_epu8(shifted, range), shifted));
+        }
+
+        mask = (unsigned int) _mm256_movemask_epi8(found);
+
+        if (mask)
+            return text + __builtin_ctz(mask);
+
+        text += 32;
+    }
+#elif defined(SCAN_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i first = _mm_set1_epi8(string ? '"' : '(');
+    const __m128i second = _mm_set1_epi8(string ? '\\' : ')');
+    const __m128i third = _mm_set1_epi8(string ? '\n' : ' ');
+    const __m128i control = _mm_set1_epi8('\t');
+    const __m128i range = _mm_set1_epi8(string ? 0 : '\r' - '\t');
+
+    while (1)
+    {
+        __m128i chars = _mm_loadu_si128((const __m128i *) text);
+        __m128i shifted = _mm_sub_epi8(chars, control);
+        __m128i found = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chars, zero),
+                _mm_cmpeq_epi8(chars, first)),
+            _mm_or_si128(_mm_cmpeq_epi8(chars, second),
+                _mm_cmpeq_epi8(chars, third)));
+        unsigned int mask;
+
+        /* Control characters \t - \r end name */
+        if (!string)
+        {
+            found = _mm_or_si128(found, _mm_cmpeq_epi8(
+                _mm_min_epu8(shifted, range), shifted));
+        }
+
+        mask = (unsigned int) _mm_movemask_epi8(found);
+
+        if (mask)
+            return text + __builtin_ctz(mask);
+
+        text += 16;
+    }
+#else
+    if (string)
+    {
+        while (*text != '"' && *text != '\\' && *text != '\n' && *text != '\0')
+            ++text;
+    }
+    else
+    {
+        while (*text != '\0' && is_symbol_name((unsigned char) *text))
+            ++text;
+    }
+
+    return text;
+#endif
 }
 
 /* ************************************************************************ */
 
-int is_source_stdin(void)
+/**
+ * @brief Reads the next part of line from memory like fgets does.
+ *
+ * @param lexer Tokenizer.
+ *
+ * @return 0 on success or EOF at the end of text.
+ */
+static int load_text(struct Lexer *lexer)
 {
-    return l_file == stdin;
+    const char *text = lexer->text;
+    const char *eol;
+    size_t length = lexer->end - text;
+
+    if (length == 0)
+        return EOF;
+
+    if (length > MAX_LINE_LENGTH - 1)
+        length = MAX_LINE_LENGTH - 1;
+
+    eol = memchr(text, '\n', length);
+
+    if (eol)
+        length = eol - text + 1;
+
+    memcpy(lexer->line, text, length);
+    lexer->line[length] = '\0';
+
+    lexer->part = text;
+    lexer->text = text + length;
+
+    return 0;
 }
 
 /* ************************************************************************ */
 
-int load_line(void)
+/**
+ * @brief Reads the next line into line buffer.
+ *
+ * @param lexer Tokenizer.
+ *
+ * @return 0 on success or EOF at the end of source.
+ */
+static int lexer_load_line(struct Lexer *lexer)
 {
-    assert(l_file);
+    if (lexer->file)
+    {
+        /* Reads line into buffer */
+        if (!fgets(lexer->line, MAX_LINE_LENGTH, lexer->file))
+            return EOF;
+
+        /* Long line is loaded in more parts */
+        if (lexer->line_end)
+            ++lexer->line_number;
 
-    /* Reads line into buffer */
-    if (!fgets(l_line, MAX_LINE_LENGTH, l_file))
+        lexer->line_end = (strchr(lexer->line, '\n') != NULL);
+    }
+    else if (load_text(lexer) == EOF)
     {
         return EOF;
     }
 
     /* Set current character pointer */
-    l_current = l_line;
+    lexer->current = lexer->line;
 
     return 0;
 }
 
 /* ************************************************************************ */
 
-const char* cur_line(void)
+/**
+ * @brief Returns current character.
+ *
+ * @param lexer Tokenizer.
+ *
+ * @return Current character.
+ */
+static int lexer_cur_char(struct Lexer *lexer)
 {
-    return l_line;
+    assert(lexer->current);
+
+    /* Last line can be read together with end of file */
+    if (*lexer->current == '\0')
+        return EOF;
+
+    return *lexer->current;
 }
 
 /* ************************************************************************ */
 
-int get_char(void)
+/**
+ * @brief Reads the next character.
+ *
+ * @param lexer Tokenizer.
+ *
+ * @return The obtained character on success or EOF on failure.
+ */
+static int lexer_get_char(struct Lexer *lexer)
 {
-    assert(l_file);
-    assert(l_current);
+    assert(lexer->current);
+
+    /* Current character is returned back */
+    if (lexer->pushback)
+    {
+        lexer->pushback = 0;
+        return lexer_cur_char(lexer);
+    }
 
     /* Next character */
-    if (*l_current != '\0')
-        ++l_current;
+    if (*lexer->current != '\0')
+        ++lexer->current;
 
     /* All characters are read */
-    while (*l_current == '\0')
+    while (*lexer->current == '\0')
     {
         /* Load next line */
-        if (load_line() == EOF)
+        if (lexer_load_line(lexer) == EOF)
             return EOF;
     }
 
     /* Return current character */
-    return cur_char();
+    return lexer_cur_char(lexer);
 }
 
 /* ************************************************************************ */
 
-int cur_char(void)
+/**
+ * @brief Sets token without text.
+ *
+ * @param lexer  Tokenizer.
+ * @param symbol Symbol.
+ */
+static void set_symbol(struct Lexer *lexer, enum Sym symbol)
 {
-    assert(l_file);
+    lexer->symbol = symbol;
+    lexer->token.text = lexer->name;
+    lexer->token.length = 0;
+    lexer->name[0] = '\0';
+}
 
-    if (feof(l_file))
-        return EOF;
+/* ************************************************************************ */
 
-    assert(l_current);
-    return *l_current;
+/**
+ * @brief Reads rest of name which continues in the next loaded part of line.
+ *
+ * @param lexer  Tokenizer.
+ * @param length Number of characters already stored in name buffer.
+ */
+static void read_long_name(struct Lexer *lexer, unsigned int length)
+{
+    int c;
+
+    while ((c = lexer_get_char(lexer)) != EOF && is_symbol_name(c))
+    {
+        /* Longer names are truncated */
+        if (length < MAX_NAME_LENGTH - 1)
+            lexer->name[length++] = c;
+    }
+
+    /* Character after name is read again */
+    if (c != EOF)
+        lexer->pushback = 1;
+
+    lexer->token.text = lexer->name;
+    lexer->token.length = length;
 }
 
 /* ************************************************************************ */
 
-enum Sym get_sym(void)
+/**
+ * @brief Reads name starting at current character.
+ *
+ * @param lexer Tokenizer.
+ */
+static void read_name(struct Lexer *lexer)
+{
+    const char *start = lexer->current;
+
+    /* Name is usually whole in line buffer */
+    lexer->current = scan(lexer->current + 1, 0) - 1;
+
+    if (lexer->current[1] == '\0')
+    {
+        unsigned int length = lexer->current - start + 1;
+
+        if (length > MAX_NAME_LENGTH - 1)
+            length = MAX_NAME_LENGTH - 1;
+
+        /* Buffer is reloaded so the text is copied */
+        memcpy(lexer->name, start, length);
+        read_long_name(lexer, length);
+    }
+    else
+    {
+        /* Character after name is read again */
+        ++lexer->current;
+        lexer->pushback = 1;
+
+        lexer->token.text = start;
+        lexer->token.length = lexer->current - start;
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Parses current name as integer number.
+ *
+ * @param lexer Tokenizer.
+ *
+ * @return If name is integer number which fits into long.
+ */
+static int parse_number(struct Lexer *lexer)
+{
+    const char *text = lexer->token.text;
+    const char *end = text + lexer->token.length;
+    unsigned long limit = LONG_MAX;
+    unsigned long value = 0;
+    int negative = 0;
+
+    if (text < end && (*text == '-' || *text == '+'))
+        negative = (*text++ == '-');
+
+    if (negative)
+        limit = (unsigned long) LONG_MAX + 1;
+
+    /* Sign itself is a name */
+    if (text == end)
+        return 0;
+
+    for (; text < end; ++text)
+    {
+        /* Too big numbers are read as floating point numbers */
+        if (!isdigit((unsigned char) *text) ||
+            value > (limit - (*text - '0')) / 10)
+            return 0;
+
+        value = 10 * value + (*text - '0');
+    }
+
+    lexer->token.value = negative ? -(long) (value - 1) - 1 : (long) value;
+
+    return 1;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads string with escaped characters or a string continuing in the
+ * next loaded part of line.
+ *
+ * @param lexer  Tokenizer.
+ * @param start  The first character of string.
+ * @param length Number of characters before current character.
+ */
+static void read_long_string(struct Lexer *lexer, const char *start,
+    unsigned int length)
+{
+    int truncated = 0;
+    int c;
+
+    if (length > MAX_STRING_LENGTH - 1)
+    {
+        length = MAX_STRING_LENGTH - 1;
+        truncated = 1;
+    }
+
+    memcpy(lexer->string, start, length);
+
+    /* Escaped characters are stored without backslash */
+    while ((c = lexer_get_char(lexer)) != '"')
+    {
+        if (c == '\\')
+            c = lexer_get_char(lexer);
+
+        if (c == EOF || c == '\n')
+            break;
+
+        if (length < MAX_STRING_LENGTH - 1)
+            lexer->string[length++] = c;
+        else
+            truncated = 1;
+    }
+
+    lexer->token.text = lexer->string;
+    lexer->token.length = length;
+
+    /* Unterminated or too long string */
+    lexer->symbol = (c == '"' && !truncated) ? SYM_STRING : SYM_INV;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads string after quote.
+ *
+ * @param lexer Tokenizer.
+ */
+static void read_string(struct Lexer *lexer)
+{
+    const char *start = lexer->current + 1;
+
+    /* String without escapes is usually whole in line buffer */
+    const char *end = scan(start, 1);
+
+    if (*end != '"')
+    {
+        /* Characters before end are taken as they are */
+        lexer->current = end - 1;
+        read_long_string(lexer, start, end - start);
+        return;
+    }
+
+    lexer->current = end;
+    lexer->token.text = start;
+    lexer->token.length = end - start;
+
+    /* Too long string */
+    lexer->symbol = (lexer->token.length < MAX_STRING_LENGTH)
+        ? SYM_STRING : SYM_INV;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads the next symbol.
+ *
+ * @param lexer Tokenizer.
+ *
+ * @return The obtained symbol on success or SYM_EOF on failure.
+ */
+static enum Sym lexer_get_sym(struct Lexer *lexer)
 {
     /* Read the next character */
-    int c = get_char();
+    int c = lexer_get_char(lexer);
 
     /* Nothing more */
     if (c == EOF)
@@ -155,76 +697,569 @@ enum Sym get_sym(void)
         /* Control characters are not supported */
         if (iscntrl(c))
         {
-            l_symbol = SYM_INV;
+            set_symbol(lexer, SYM_INV);
         }
         else
         {
-            const char *ptmp = l_current;
-            char *pname = name;
-
-            /* Read all characters that match name */
-            while (is_symbol_name(get_char()))
-                continue;
-
-            /* Store name as upper case */
-            /*strncpy(name, start, current - start);*/
-            for (; ptmp < l_current; ptmp++, pname++)
-            {
-                /* TODO: Longer names than buffer? */
-                *pname = toupper(*ptmp);
-            }
+            read_name(lexer);
 
-            /* Terminate character */
-            *pname = '\0';
-
-            --l_current;
-
-            /* Name symbol */
-            l_symbol = SYM_NAME;
+            /* Integer is parsed only once */
+            lexer->symbol = parse_number(lexer) ? SYM_NUMBER : SYM_NAME;
         }
         break;
 
     case '\n':
     case '\r':
         /* New line symbol */
-        l_symbol = SYM_EOL;
-        name[0] = '\0';
+        set_symbol(lexer, SYM_EOL);
         break;
 
     case ' ':
     case '\t':
-        /* Space symbol */
-        l_symbol = SYM_SPACE;
-        name[0] = '\0';
+        /* Space symbol, indentation is skipped at once */
+        while (lexer->current[1] == ' ' || lexer->current[1] == '\t')
+            ++lexer->current;
+
+        set_symbol(lexer, SYM_SPACE);
         break;
 
     case '(':
         /* Left parenthesis symbol */
-        l_symbol = SYM_LPAREN;
-        name[0] = '\0';
+        set_symbol(lexer, SYM_LPAREN);
         break;
 
     case ')':
         /* Right parenthesis symbol */
-        l_symbol = SYM_RPAREN;
-        name[0] = '\0';
+        set_symbol(lexer, SYM_RPAREN);
         break;
 
     case '\'':
         /* Quote symbol */
-        l_symbol = SYM_QUOTE;
-        name[0] = '\0';
+        set_symbol(lexer, SYM_QUOTE);
+        break;
+
+    case '"':
+        read_string(lexer);
         break;
     }
 
-    return cur_sym();
+    return lexer->symbol;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns pointer into source text for pointer into line buffer.
+ *
+ * @param lexer Tokenizer reading text in memory.
+ * @param text  Pointer into line buffer.
+ *
+ * @return Pointer into source text or NULL.
+ */
+static const char *source_text(const struct Lexer *lexer, const char *text)
+{
+    if (text < lexer->line || text >= lexer->line + MAX_LINE_LENGTH)
+        return NULL;
+
+    return lexer->part + (text - lexer->line);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Appends current token of worker tokenizer to chunk.
+ *
+ * @param chunk Chunk.
+ * @param lexer Tokenizer.
+ */
+static void add_lexeme(struct Chunk *chunk, const struct Lexer *lexer)
+{
+    struct Lexeme *lexeme;
+
+    if (chunk->count == chunk->capacity)
+    {
+        size_t capacity = chunk->capacity ? 2 * chunk->capacity : 4096;
+        struct Lexeme *lexemes = (struct Lexeme *) realloc(chunk->lexemes,
+            capacity * sizeof(struct Lexeme));
+
+        if (lexemes == NULL)
+        {
+            perror("Unable to allocate memory for tokens");
+            exit(EXIT_FAILURE);
+        }
+
+        chunk->lexemes = lexemes;
+        chunk->capacity = capacity;
+    }
+
+    lexeme = &chunk->lexemes[chunk->count++];
+    lexeme->symbol = (unsigned char) lexer->symbol;
+    lexeme->length = lexer->token.length;
+    lexeme->value = lexer->token.value;
+    lexeme->part = lexer->part;
+
+    /* Unterminated string ends with new line character */
+    lexeme->eol = (*lexer->current == '\n' && !lexer->pushback);
+
+    /* New line character tells where the next line starts */
+    if (lexer->symbol == SYM_EOL)
+    {
+        lexeme->text = source_text(lexer, lexer->current);
+        return;
+    }
+
+    lexeme->text = source_text(lexer, lexer->token.text);
+
+    if (lexeme->text || lexeme->length == 0)
+        return;
+
+    /* Text from name buffer is stored in pool */
+    if (chunk->pool_size + lexeme->length > chunk->pool_capacity)
+    {
+        size_t capacity = chunk->pool_capacity ? 2 * chunk->pool_capacity
+            : 1024;
+        char *pool;
+
+        /* String can be longer than the pool */
+        while (chunk->pool_size + lexeme->length > capacity)
+            capacity *= 2;
+
+        pool = (char *) realloc(chunk->pool, capacity);
+
+        if (pool == NULL)
+        {
+            perror("Unable to allocate memory for tokens");
+            exit(EXIT_FAILURE);
+        }
+
+        chunk->pool = pool;
+        chunk->pool_capacity = capacity;
+    }
+
+    memcpy(chunk->pool + chunk->pool_size, lexer->token.text, lexeme->length);
+    chunk->pool_size += lexeme->length;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Worker thread which tokenizes chunk.
+ *
+ * @param data Chunk.
+ *
+ * @return NULL.
+ */
+static void *tokenize_chunk(void *data)
+{
+    struct Chunk *chunk = (struct Chunk *) data;
+    struct Lexer lexer;
+    size_t offset = 0;
+    size_t i;
+
+    memset(&lexer, 0, sizeof(lexer));
+    lexer.text = chunk->begin;
+    lexer.end = chunk->end;
+    lexer.current = lexer.line;
+
+    while (lexer_get_sym(&lexer) != SYM_EOF)
+        add_lexeme(chunk, &lexer);
+
+    /* Pool doesn't move any more, texts are stored in order */
+    for (i = 0; i < chunk->count; ++i)
+    {
+        struct Lexeme *lexeme = &chunk->lexemes[i];
+
+        if (lexeme->text == NULL && lexeme->length > 0)
+        {
+            lexeme->text = chunk->pool + offset;
+            offset += lexeme->length;
+        }
+    }
+
+    return NULL;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Starts tokenizing of the next chunks of source text.
+ *
+ * Chunks end at the end of line, tokens never continue on the next line.
+ *
+ * @param batch Batch which is filled with chunks.
+ */
+static void start_batch(unsigned int batch)
+{
+    unsigned int i;
+
+    for (i = 0; i < l_parallel.threads && l_parallel.rest < l_parallel.end;
+        ++i)
+    {
+        struct Chunk *chunk = &l_parallel.chunks[batch][i];
+        const char *end = l_parallel.end;
+
+        if ((size_t) (end - l_parallel.rest) > PARALLEL_CHUNK_SIZE)
+        {
+            const char *eol = memchr(l_parallel.rest + PARALLEL_CHUNK_SIZE,
+                '\n', end - l_parallel.rest - PARALLEL_CHUNK_SIZE);
+
+            if (eol)
+                end = eol + 1;
+        }
+
+        chunk->begin = l_parallel.rest;
+        chunk->end = end;
+        chunk->count = 0;
+        chunk->pool_size = 0;
+        l_parallel.rest = end;
+
+        /* Without thread the chunk is tokenized immediately */
+        chunk->running = (pthread_create(&chunk->thread, NULL,
+            &tokenize_chunk, chunk) == 0);
+
+        if (!chunk->running)
+            tokenize_chunk(chunk);
+    }
+
+    l_parallel.count[batch] = i;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Waits until all chunks of batch are tokenized.
+ *
+ * @param batch Batch.
+ */
+static void join_batch(unsigned int batch)
+{
+    unsigned int i;
+
+    for (i = 0; i < l_parallel.count[batch]; ++i)
+    {
+        struct Chunk *chunk = &l_parallel.chunks[batch][i];
+
+        if (chunk->running)
+        {
+            pthread_join(chunk->thread, NULL);
+            chunk->running = 0;
+        }
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Waits for worker threads and releases tokenized chunks.
+ */
+static void release_chunks(void)
+{
+    unsigned int batch;
+    unsigned int i;
+
+    for (batch = 0; batch < 2; ++batch)
+    {
+        join_batch(batch);
+
+        for (i = 0; i < PARALLEL_MAX_THREADS; ++i)
+        {
+            struct Chunk *chunk = &l_parallel.chunks[batch][i];
+
+            free(chunk->lexemes);
+            free(chunk->pool);
+            memset(chunk, 0, sizeof(*chunk));
+        }
+
+        l_parallel.count[batch] = 0;
+    }
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stops parallel tokenization and releases its memory.
+ */
+static void stop_parallel(void)
+{
+    if (l_parallel.map == NULL)
+        return;
+
+    release_chunks();
+
+    munmap(l_parallel.map, l_parallel.size);
+    memset(&l_parallel, 0, sizeof(l_parallel));
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Starts parallel tokenization of large regular file.
+ *
+ * @param file Source file.
+ */
+static void start_parallel(FILE* file)
+{
+    struct stat info;
+    long offset;
+    long threads;
+    void *map;
+
+    /* Interactive input is read by lines */
+    if (file == stdin || fstat(fileno(file), &info) != 0 ||
+        !S_ISREG(info.st_mode))
+    {
+        return;
+    }
+
+    offset = ftell(file);
+
+    if (offset < 0 || info.st_size - offset < PARALLEL_MIN_SIZE)
+        return;
+
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* Single processor would only wait for worker threads */
+    if (threads < 2)
+        return;
+
+    if (threads > PARALLEL_MAX_THREADS)
+        threads = PARALLEL_MAX_THREADS;
+
+    map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+
+    if (map == MAP_FAILED)
+        return;
+
+    madvise(map, info.st_size, MADV_SEQUENTIAL);
+
+    /* File is read from the mapping */
+    fseek(file, 0, SEEK_END);
+
+    l_parallel.map = (char *) map;
+    l_parallel.size = info.st_size;
+    l_parallel.rest = l_parallel.map + offset;
+    l_parallel.end = l_parallel.map + info.st_size;
+    l_parallel.line = l_parallel.rest;
+    l_parallel.part = NULL;
+    l_parallel.eol = 0;
+    l_parallel.line_number = 1;
+    l_parallel.threads = (unsigned int) threads;
+
+    /* The first batch is needed now, the second one is prepared */
+    start_batch(0);
+    join_batch(0);
+    start_batch(1);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Moves to the next tokenized chunk.
+ *
+ * @return If there is a chunk.
+ */
+static int next_chunk(void)
+{
+    l_parallel.position = 0;
+
+    if (++l_parallel.chunk < l_parallel.count[l_parallel.batch])
+        return 1;
+
+    /* Replayed batch is reused for the batch after the next one */
+    join_batch(1 - l_parallel.batch);
+    start_batch(l_parallel.batch);
+
+    l_parallel.batch = 1 - l_parallel.batch;
+    l_parallel.chunk = 0;
+
+    return l_parallel.count[l_parallel.batch] > 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Reads the next symbol tokenized by worker threads.
+ *
+ * @return The obtained symbol on success or SYM_EOF on failure.
+ */
+static enum Sym replay_sym(void)
+{
+    const struct Chunk *chunk;
+    const struct Lexeme *lexeme;
+
+    chunk = &l_parallel.chunks[l_parallel.batch][l_parallel.chunk];
+
+    while (l_parallel.position == chunk->count)
+    {
+        if (!next_chunk())
+        {
+            /* Mapping stays for current token and line */
+            release_chunks();
+            return SYM_EOF;
+        }
+
+        chunk = &l_parallel.chunks[l_parallel.batch][l_parallel.chunk];
+    }
+
+    lexeme = &chunk->lexemes[l_parallel.position++];
+
+    /* The next line starts after new line character, the last line stays */
+    if (l_parallel.eol)
+    {
+        const char *eol = l_lexer.token.text;
+
+        /* Text of unterminated string isn't in source and the string ends
+         * with the first new line character of its line */
+        if (l_lexer.symbol != SYM_EOL)
+            eol = memchr(l_parallel.line, '\n', l_parallel.end - l_parallel.line);
+
+        l_parallel.line = eol + 1;
+        ++l_parallel.line_number;
+    }
+
+    l_parallel.eol = lexeme->eol;
+    l_parallel.part = lexeme->part;
+    l_lexer.symbol = (enum Sym) lexeme->symbol;
+    l_lexer.token.text = lexeme->text ? lexeme->text : "";
+    l_lexer.token.length = lexeme->length;
+    l_lexer.token.value = lexeme->value;
+
+    return l_lexer.symbol;
+}
+
+/* ************************************************************************ */
+
+void set_source(FILE* file)
+{
+    stop_parallel();
+
+    l_lexer.file = file;
+
+    /* Nothing is loaded from new file */
+    l_lexer.line[0] = '\0';
+    l_lexer.current = l_lexer.line;
+    l_lexer.pushback = 0;
+    l_lexer.symbol = SYM_INV;
+    l_lexer.line_number = 0;
+    l_lexer.line_end = 1;
+
+    /* Large file is tokenized in parallel */
+    if (file)
+        start_parallel(file);
+}
+
+/* ************************************************************************ */
+
+int is_source_stdin(void)
+{
+    return l_lexer.file == stdin;
+}
+
+/* ************************************************************************ */
+
+int load_line(void)
+{
+    assert(l_lexer.file);
+
+    return lexer_load_line(&l_lexer);
+}
+
+/* ************************************************************************ */
+
+void skip_line(void)
+{
+    if (l_parallel.map)
+    {
+        /* Tokens are skipped up to new line character, it can be the last
+         * character of unterminated string like in sequential reading */
+        while (!l_parallel.eol)
+        {
+            if (replay_sym() == SYM_EOF)
+                break;
+        }
+
+        return;
+    }
+
+    /* Long line is loaded in more parts */
+    while (strchr(l_lexer.current, '\n') == NULL)
+    {
+        if (lexer_load_line(&l_lexer) == EOF)
+            break;
+    }
+
+    /* The next character is read from the next line */
+    l_lexer.current = l_lexer.line + strlen(l_lexer.line);
+    l_lexer.pushback = 0;
+}
+
+/* ************************************************************************ */
+
+const char* cur_line(void)
+{
+    if (l_parallel.map)
+    {
+        /* Part of long line is copied like it would be loaded */
+        l_lexer.text = l_parallel.part ? l_parallel.part : l_parallel.line;
+        l_lexer.end = l_parallel.end;
+
+        if (load_text(&l_lexer) == EOF)
+            l_lexer.line[0] = '\0';
+    }
+
+    return l_lexer.line;
+}
+
+/* ************************************************************************ */
+
+unsigned long cur_line_number(void)
+{
+    if (l_parallel.map)
+        return l_parallel.line_number;
+
+    return l_lexer.line_number;
+}
+
+/* ************************************************************************ */
+
+int get_char(void)
+{
+    assert(l_lexer.file);
+
+    return lexer_get_char(&l_lexer);
+}
+
+/* ************************************************************************ */
+
+int cur_char(void)
+{
+    assert(l_lexer.file);
+
+    return lexer_cur_char(&l_lexer);
+}
+
+/* ************************************************************************ */
+
+enum Sym get_sym(void)
+{
+    if (l_parallel.map)
+        return replay_sym();
+
+    return lexer_get_sym(&l_lexer);
 }
 
 /* ************************************************************************ */
 
 enum Sym cur_sym(void)
 {
-    return l_symbol;
+    return l_lexer.symbol;
+}
+
+/* ************************************************************************ */
+
+const struct Token *cur_token(void)
+{
+    return &l_lexer.token;
 }
 
 /* ************************************************************************ */
@@ -43,6 +43,15 @@
 
 /* ************************************************************************ */
 
+/**
+ * @brief Maximum string length
+ */
+#ifndef MAX_STRING_LENGTH
+#define MAX_STRING_LENGTH 4096
+#endif
+
+/* ************************************************************************ */
+
 /**
  * @brief Maximum line length.
  */
@@ -52,6 +61,34 @@
 
 /* ************************************************************************ */
 
+/**
+ * @brief Minimum remaining size of source file which is tokenized by worker
+ * threads.
+ */
+#ifndef PARALLEL_MIN_SIZE
+#define PARALLEL_MIN_SIZE (1024 * 1024)
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Size of source text tokenized by one worker thread at once.
+ */
+#ifndef PARALLEL_CHUNK_SIZE
+#define PARALLEL_CHUNK_SIZE (256 * 1024)
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum number of tokenizer worker threads.
+ */
+#ifndef PARALLEL_MAX_THREADS
+#define PARALLEL_MAX_THREADS 8
+#endif
+
+/* ************************************************************************ */
+
 /**
  * @brief List of tokenizer symbols
  */
@@ -67,6 +104,10 @@ enum Sym
     SYM_QUOTE,
     /** Name symbol */
     SYM_NAME,
+    /** Integer number symbol */
+    SYM_NUMBER,
+    /** String symbol */
+    SYM_STRING,
     /** Space symbol */
     SYM_SPACE,
     /** New line symbol */
@@ -78,15 +119,30 @@ enum Sym
 /* ************************************************************************ */
 
 /**
- * @brief Variable for storing current symbol name.
+ * @brief Text of current symbol.
  */
-extern char name[MAX_NAME_LENGTH];
+struct Token
+{
+    /** Text, it isn't terminated by zero. It points into input buffer and
+     * it's valid until the next symbol is read. */
+    const char *text;
+
+    /** Text length. */
+    unsigned int length;
+
+    /** Value of integer number symbol. */
+    long value;
+};
 
 /* ************************************************************************ */
 
 /**
  * @brief Set source file.
  *
+ * Large regular file is mapped into memory and split into chunks at line
+ * ends. Chunks are tokenized by worker threads in advance and the tokens
+ * are returned in original order.
+ *
  * @param file A pointer to source file.
  */
 void set_source(FILE* file);
@@ -111,6 +167,13 @@ int load_line(void);
 
 /* ************************************************************************ */
 
+/**
+ * @brief Skips rest of current loaded line.
+ */
+void skip_line(void);
+
+/* ************************************************************************ */
+
 /**
  * @brief Returns a pointer to current loaded line.
  *
@@ -122,6 +185,17 @@ const char* cur_line(void);
 
 /* ************************************************************************ */
 
+/**
+ * @brief Returns number of current line.
+ *
+ * Lines are counted from the position of source file when it was set.
+ *
+ * @return Line number, 0 before the first line is loaded.
+ */
+unsigned long cur_line_number(void);
+
+/* ************************************************************************ */
+
 /**
  * @brief Reads the next character from input.
  *
@@ -158,6 +232,17 @@ enum Sym cur_sym(void);
 
 /* ************************************************************************ */
 
+/**
+ * @brief Returns text of current symbol.
+ *
+ * Names are not converted to upper case, strings are without quotes.
+ *
+ * @return Current token.
+ */
+const struct Token *cur_token(void);
+
+/* ************************************************************************ */
+
 #endif /* TOKENIZER_H_ */
 
 /* ************************************************************************ */
@@ -0,0 +1,413 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+/* Feature test macros */
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+
+/* Declaration */
+#include "trace.h"
+
+/* C library */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* POSIX */
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum length of one event.
+ */
+#define TRACE_MAX_EVENT_LENGTH (TRACE_MAX_SOURCE_LENGTH * 6 + 256)
+
+/* ************************************************************************ */
+
+int trace_active = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Output file, -1 when events are not written.
+ */
+static int l_fd = -1;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Events which are not written. Stdio isn't used because its buffer
+ * would be written again by child process.
+ */
+static char l_buffer[TRACE_BUFFER_SIZE];
+
+/* ************************************************************************ */
+
+/**
+ * @brief Length of buffered events.
+ */
+static size_t l_length = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief If no event was written, events are separated by commas.
+ */
+static int l_first = 1;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Every rate-th top-level form is recorded.
+ */
+static unsigned int l_rate = 1;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum call depth of recorded builtin calls, 0 for any.
+ */
+static unsigned int l_depth = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of top-level forms.
+ */
+static unsigned long l_form_count = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Source line number of current top-level form.
+ */
+static unsigned long l_form_line = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief If begin event of top-level form is written.
+ */
+static int l_form_open = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Number of builtin calls with begin event only.
+ */
+static unsigned int l_open_calls = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Process identifier used in events.
+ */
+static long l_pid = 0;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Writes buffered events. Tracing stops on write error.
+ */
+static void flush_events(void)
+{
+    size_t written = 0;
+
+    while (l_fd >= 0 && written < l_length)
+    {
+        ssize_t count = write(l_fd, l_buffer + written, l_length - written);
+
+        if (count <= 0)
+        {
+            perror("Unable to write trace");
+            close(l_fd);
+            l_fd = -1;
+            trace_active = 0;
+        }
+        else
+        {
+            written += (size_t) count;
+        }
+    }
+
+    l_length = 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds text into buffer.
+ *
+ * @param text Text.
+ */
+static void append(const char *text)
+{
+    size_t length = strlen(text);
+
+    assert(length <= TRACE_BUFFER_SIZE);
+
+    if (l_length + length > TRACE_BUFFER_SIZE)
+        flush_events();
+
+    memcpy(l_buffer + l_length, text, length);
+    l_length += length;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns time of event.
+ *
+ * @return Time in microseconds.
+ */
+static double timestamp(void)
+{
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (double) time.tv_sec * 1e6 + (double) time.tv_nsec / 1e3;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds event into buffer.
+ *
+ * @param event Event object.
+ */
+static void add_event(const char *event)
+{
+    if (!l_first)
+        append(",\n");
+
+    append(event);
+    l_first = 0;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Adds end event.
+ */
+static void add_end(void)
+{
+    char event[TRACE_MAX_EVENT_LENGTH];
+
+    sprintf(event, "{\"ph\":\"E\",\"ts\":%.3f,\"pid\":%ld,\"tid\":%ld}",
+        timestamp(), l_pid, l_pid);
+    add_event(event);
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Escapes source line for JSON string.
+ *
+ * White space is shortened to one space and long source is cut.
+ *
+ * @param source Source line.
+ * @param text   Buffer with space for escaped text.
+ */
+static void escape_source(const char *source, char *text)
+{
+    unsigned int length = 0;
+
+    while (*source == ' ' || *source == '\t')
+        ++source;
+
+    for (; *source && length < TRACE_MAX_SOURCE_LENGTH; ++source, ++length)
+    {
+        unsigned char c = (unsigned char) *source;
+
+        if (c == '"' || c == '\\')
+        {
+            *text++ = '\\';
+            *text++ = (char) c;
+        }
+        else if (c == '\n' || c == '\r')
+        {
+            /* Line end is not a part of name */
+            break;
+        }
+        else if (c < 0x20)
+        {
+            sprintf(text, "\\u%04x", c);
+            text += 6;
+        }
+        else
+        {
+            *text++ = (char) c;
+        }
+    }
+
+    *text = '\0';
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Finishes trace when the process exits.
+ */
+static void close_trace(void)
+{
+    if (l_fd < 0)
+        return;
+
+    trace_form_end();
+    append("\n]\n");
+    flush_events();
+
+    if (l_fd >= 0)
+        close(l_fd);
+
+    l_fd = -1;
+}
+
+/* ************************************************************************ */
+
+/**
+ * @brief Stops tracing in child process, events of parent are written only
+ * by the parent.
+ */
+static void stop_child(void)
+{
+    l_fd = -1;
+    l_length = 0;
+    trace_active = 0;
+}
+
+/* ************************************************************************ */
+
+int trace_open(const char *path, unsigned int rate, unsigned int depth)
+{
+    assert(path);
+
+    if (l_fd >= 0)
+        return -1;
+
+    if ((l_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+        return -1;
+
+    l_rate = rate ? rate : 1;
+    l_depth = depth;
+    l_pid = (long) getpid();
+
+    /* Array format, the end is written at exit */
+    append("[\n");
+
+    atexit(&close_trace);
+    pthread_atfork(NULL, NULL, &stop_child);
+
+    return 0;
+}
+
+/* ************************************************************************ */
+
+void trace_form_begin(const char *source, unsigned long line)
+{
+    char event[TRACE_MAX_EVENT_LENGTH];
+    char text[TRACE_MAX_SOURCE_LENGTH * 6 + 1];
+
+    assert(source);
+
+    ++l_form_count;
+
+    if (l_fd < 0 || l_form_open)
+        return;
+
+    /* Forms are sampled, so their calls are complete */
+    trace_active = ((l_form_count - 1) % l_rate == 0);
+
+    if (!trace_active)
+        return;
+
+    l_form_line = line;
+
+    escape_source(source, text);
+    sprintf(event, "{\"name\":\"%s\",\"cat\":\"form\",\"ph\":\"B\","
+        "\"ts\":%.3f,\"pid\":%ld,\"tid\":%ld,\"args\":{\"form\":%lu,"
+        "\"line\":%lu}}", text, timestamp(), l_pid, l_pid, l_form_count,
+        l_form_line);
+    add_event(event);
+    l_form_open = 1;
+}
+
+/* ************************************************************************ */
+
+void trace_form_end(void)
+{
+    if (!l_form_open)
+        return;
+
+    /* Calls left by syntax error */
+    for (; l_open_calls > 0; --l_open_calls)
+        add_end();
+
+    add_end();
+    l_form_open = 0;
+    trace_active = 0;
+}
+
+/* ************************************************************************ */
+
+int trace_call_begin(const char *name, unsigned int argc, unsigned int depth)
+{
+    char event[TRACE_MAX_EVENT_LENGTH];
+
+    assert(name);
+
+    if (!l_form_open || (l_depth && depth > l_depth) ||
+        strlen(name) > TRACE_MAX_SOURCE_LENGTH)
+        return 0;
+
+    sprintf(event, "{\"name\":\"%s\",\"cat\":\"builtin\",\"ph\":\"B\","
+        "\"ts\":%.3f,\"pid\":%ld,\"tid\":%ld,\"args\":{\"argc\":%u,"
+        "\"depth\":%u,\"form\":%lu,\"line\":%lu}}", name, timestamp(), l_pid,
+        l_pid, argc, depth, l_form_count, l_form_line);
+    add_event(event);
+    ++l_open_calls;
+
+    return 1;
+}
+
+/* ************************************************************************ */
+
+void trace_call_end(void)
+{
+    if (l_open_calls == 0)
+        return;
+
+    add_end();
+    --l_open_calls;
+}
+
+/* ************************************************************************ */
@@ -0,0 +1,114 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+/* ************************************************************************ */
+
+/**
+ * @brief Size of buffer for trace events.
+ */
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE (64 * 1024)
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief Maximum length of form source stored in trace.
+ */
+#ifndef TRACE_MAX_SOURCE_LENGTH
+#define TRACE_MAX_SOURCE_LENGTH 80
+#endif
+
+/* ************************************************************************ */
+
+/**
+ * @brief If events of current top-level form are recorded.
+ */
+extern int trace_active;
+
+/* ************************************************************************ */
+
+/**
+ * @brief Starts writing trace events in Chrome trace-event format.
+ *
+ * Events of child processes are not written. The trace is finished when
+ * the process exits.
+ *
+ * @param path  Output file.
+ * @param rate  Every rate-th top-level form is recorded.
+ * @param depth Maximum call depth of recorded builtin calls, 0 for any.
+ *
+ * @return 0 on success.
+ */
+int trace_open(const char *path, unsigned int rate, unsigned int depth);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Begins top-level form. It sets `trace_active` when the form is
+ * sampled.
+ *
+ * @param source Source line of the form.
+ * @param line   Number of the source line, 0 when it's unknown.
+ */
+void trace_form_begin(const char *source, unsigned long line);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Ends top-level form and builtin calls left by syntax error.
+ */
+void trace_form_end(void);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Begins builtin function call.
+ *
+ * @param name  Function name.
+ * @param argc  Number of arguments.
+ * @param depth Call depth.
+ *
+ * @return If the call is recorded and `trace_call_end` must be called.
+ */
+int trace_call_begin(const char *name, unsigned int argc, unsigned int depth);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Ends builtin function call.
+ */
+void trace_call_end(void);
+
+/* ************************************************************************ */
+
+#endif /* TRACE_H_ */
+
+/* ************************************************************************ */
@@ -0,0 +1,134 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+/* Declaration */
+#include "vector.h"
+
+/* C library */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* LISP */
+#include "interpret.h"
+
+/* ************************************************************************ */
+
+struct SExpression *vector_create(enum VectorKind kind, unsigned long length)
+{
+    struct SExpression *vector;
+    struct Vector *data = calloc(1, sizeof(struct Vector));
+
+    /* Empty vector has one item, so NULL means failure */
+    if (data == NULL || (data->items = malloc((length ? length : 1) *
+        sizeof(union VectorItem))) == NULL)
+    {
+        perror("Unable to allocate memory for vector");
+        exit(EXIT_FAILURE);
+    }
+
+    data->length = length;
+    data->kind = kind;
+    data->block = data->items;
+
+    /* Pointer is stored in place of value text */
+    vector = alloc_sexpr(TYPE_VECTOR);
+    memcpy(vector->lvalue, &data, sizeof(data));
+
+    return vector;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *vector_view(struct SExpression *vector,
+    unsigned long offset, unsigned long length)
+{
+    const struct Vector *base = vector_get(vector);
+    struct SExpression *view;
+    struct Vector *data = malloc(sizeof(struct Vector));
+
+    assert(offset <= base->length && length <= base->length - offset);
+
+    if (data == NULL)
+    {
+        perror("Unable to allocate memory for vector");
+        exit(EXIT_FAILURE);
+    }
+
+    data->items = base->items + offset;
+    data->length = length;
+    data->kind = base->kind;
+    data->block = NULL;
+
+    view = alloc_sexpr(TYPE_VECTOR);
+    memcpy(view->lvalue, &data, sizeof(data));
+
+    /* View of view refers directly to the owner */
+    view->list = base->block ? vector : vector->list;
+
+    return view;
+}
+
+/* ************************************************************************ */
+
+struct Vector *vector_get(const struct SExpression *vector)
+{
+    struct Vector *data;
+
+    assert(vector->type == TYPE_VECTOR);
+
+    memcpy(&data, vector->lvalue, sizeof(data));
+
+    return data;
+}
+
+/* ************************************************************************ */
+
+struct SExpression *vector_item(const struct SExpression *vector,
+    unsigned long index)
+{
+    struct Vector *data = vector_get(vector);
+
+    assert(index < data->length);
+
+    if (data->kind == VECTOR_FLOAT)
+        return alloc_float(data->items[index].real);
+
+    return alloc_value(data->items[index].integer);
+}
+
+/* ************************************************************************ */
+
+void vector_release(struct SExpression *vector)
+{
+    struct Vector *data = vector_get(vector);
+
+    free(data->block);
+    free(data);
+}
+
+/* ************************************************************************ */
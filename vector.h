@@ -0,0 +1,151 @@
+/* ************************************************************************ */
+/*                                                                          */
+/* The MIT License (MIT)                                                    */
+/* Copyright (c) 2016 Jiří Fatka <ntsfka@gmail.com>                         */
+/*                                                                          */
+/* Permission is hereby granted, free of charge, to any person obtaining    */
+/* a copy of this software and associated documentation files (the          */
+/* "Software"), to deal in the Software without restriction, including      */
+/* without limitation the rights to use, copy, modify, merge, publish,      */
+/* distribute, sublicense, and/or sell copies of the Software, and to       */
+/* permit persons to whom the Software is furnished to do so, subject to    */
+/* the following conditions:                                                */
+/*                                                                          */
+/* The above copyright notice and this permission notice shall be           */
+/* included in all copies or substantial portions of the Software.          */
+/*                                                                          */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,          */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF       */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                    */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE   */
+/* LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION   */
+/* OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION    */
+/* WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.          */
+/*                                                                          */
+/* ************************************************************************ */
+
+
+#ifndef VECTOR_H_
+#define VECTOR_H_
+
+/* ************************************************************************ */
+
+/* LISP */
+#include "desc.h"
+
+/* ************************************************************************ */
+
+/**
+ * @brief Type of vector items.
+ */
+enum VectorKind
+{
+    VECTOR_INTEGER,
+    VECTOR_FLOAT
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Vector item, integer or floating point number by vector kind.
+ */
+union VectorItem
+{
+    /** Integer. */
+    long integer;
+
+    /** Floating point number. */
+    double real;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Numeric vector data.
+ */
+struct Vector
+{
+    /** Contiguous items. */
+    union VectorItem *items;
+
+    /** Number of items. */
+    unsigned long length;
+
+    /** Type of items. */
+    enum VectorKind kind;
+
+    /** Allocated items, NULL when items belong to other vector. */
+    union VectorItem *block;
+};
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates a new vector with uninitialized items.
+ *
+ * Vector data are stored outside of the heap and they are released by
+ * garbage collector (see gc_set_external).
+ *
+ * @param kind   Type of items.
+ * @param length Number of items.
+ *
+ * @return Vector object.
+ */
+struct SExpression *vector_create(enum VectorKind kind, unsigned long length);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates vector which shares part of items with other vector.
+ *
+ * Vector which owns the items is referenced by list pointer of the view so
+ * it isn't released while the view is used.
+ *
+ * @param vector Vector, it must be reachable by garbage collector.
+ * @param offset Index of the first item.
+ * @param length Number of items, offset + length must not exceed length of
+ *               the vector.
+ *
+ * @return Vector object.
+ */
+struct SExpression *vector_view(struct SExpression *vector,
+    unsigned long offset, unsigned long length);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Returns vector data.
+ *
+ * @param vector Vector object.
+ *
+ * @return Data.
+ */
+struct Vector *vector_get(const struct SExpression *vector);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Creates number for vector item.
+ *
+ * @param vector Vector object.
+ * @param index  Item index, it must be less than length.
+ *
+ * @return Number.
+ */
+struct SExpression *vector_item(const struct SExpression *vector,
+    unsigned long index);
+
+/* ************************************************************************ */
+
+/**
+ * @brief Frees vector data, it's called by garbage collector.
+ *
+ * @param vector Vector object.
+ */
+void vector_release(struct SExpression *vector);
+
+/* ************************************************************************ */
+
+#endif /* VECTOR_H_ */
+
+/* ************************************************************************ */